@@ -4,5 +4,8 @@ TEMPLATE = subdirs
 
 SUBDIRS += \
     src \
-    unittests
+    unittests \
+    benchmarks
+
+benchmarks.depends = unittests
 OTHER_FILES += .qmake.conf
@@ -0,0 +1,83 @@
+include(../../coverage.pri)
+
+TARGET = bench_aalcameraservice
+
+QT += concurrent multimedia opengl gui sensors
+
+CONFIG += link_pkgconfig
+PKGCONFIG += exiv2 libturbojpeg libqtubuntu-media-signals
+
+LIBS += -L../../unittests/mocks/aal -laal
+INCLUDEPATH += ../../src
+INCLUDEPATH += ../../unittests/mocks/aal
+INCLUDEPATH += ../../unittests/stubs/
+
+HEADERS += \
+    ../../src/aalaudioencodersettingscontrol.h \
+    ../../src/aalcameracontrol.h \
+    ../../src/aalcameraflashcontrol.h \
+    ../../src/aalcamerafocuscontrol.h \
+    ../../src/aalcameraservice.h \
+    ../../src/aalcamerazoomcontrol.h \
+    ../../src/aalimagecapturecontrol.h \
+    ../../src/aalimageencodercontrol.h \
+    ../../src/aalmediarecordercontrol.h \
+    ../../src/aalmetadatawritercontrol.h \
+    ../../src/aalvideodeviceselectorcontrol.h \
+    ../../src/aalvideoencodersettingscontrol.h \
+    ../../src/aalvideorenderercontrol.h \
+    ../../src/aalviewfindersettingscontrol.h \
+    ../../src/aalcamerainfocontrol.h \
+    ../../src/audiocapture.h \
+    ../../src/audiolevelmeter.h \
+    ../../src/audiopipewriter.h \
+    ../../src/audioringbuffer.h \
+    ../../src/bitratepolicy.h \
+    ../../src/devicequirks.h \
+    ../../src/haleventqueue.h \
+    ../../src/halrecorder.h \
+    ../../src/haltrace.h \
+    ../../src/replaybuffer.h \
+    ../../src/aalcameraexposurecontrol.h \
+    ../../src/storagemanager.h \
+    ../../src/rotationhandler.h \
+    ../../unittests/stubs/qcamerainfodata.h
+
+# The microphone is stubbed, the benchmark measures the camera paths
+SOURCES += bench_aalcameraservice.cpp \
+    ../../src/aalaudioencodersettingscontrol.cpp \
+    ../../src/aalcameracontrol.cpp \
+    ../../src/aalcameraflashcontrol.cpp \
+    ../../src/aalcamerafocuscontrol.cpp \
+    ../../src/aalcameraservice.cpp \
+    ../../src/aalcamerazoomcontrol.cpp \
+    ../../src/aalimagecapturecontrol.cpp \
+    ../../src/aalimageencodercontrol.cpp \
+    ../../src/aalmediarecordercontrol.cpp \
+    ../../src/aalmetadatawritercontrol.cpp \
+    ../../src/aalvideodeviceselectorcontrol.cpp \
+    ../../src/aalvideoencodersettingscontrol.cpp \
+    ../../src/aalvideorenderercontrol.cpp \
+    ../../src/aalviewfindersettingscontrol.cpp \
+    ../../src/aalcamerainfocontrol.cpp \
+    ../../src/audiolevelmeter.cpp \
+    ../../src/audiopipewriter.cpp \
+    ../../src/audioringbuffer.cpp \
+    ../../src/bitratepolicy.cpp \
+    ../../src/devicequirks.cpp \
+    ../../src/haleventqueue.cpp \
+    ../../src/halrecorder.cpp \
+    ../../src/haltrace.cpp \
+    ../../src/replaybuffer.cpp \
+    ../../src/aalcameraexposurecontrol.cpp \
+    ../../src/storagemanager.cpp \
+    ../../src/rotationhandler.cpp \
+    ../../unittests/stubs/audiocapture_stub.cpp \
+    ../../unittests/stubs/qcamerainfo_stub.cpp \
+    ../../unittests/stubs/qcamerainfodata.cpp
+
+OTHER_FILES += latencies.txt
+
+benchmark.depends = $${TARGET}
+benchmark.commands = ./$${TARGET} --latencies $$PWD/latencies.txt -o results.json
+QMAKE_EXTRA_TARGETS += benchmark
@@ -0,0 +1,329 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "aalcameracontrol.h"
+#include "aalcameraservice.h"
+#include "aalimagecapturecontrol.h"
+#include "aalmediarecordercontrol.h"
+#include "aalvideodeviceselectorcontrol.h"
+#include "aalvideorenderercontrol.h"
+#include "halsimulation.h"
+#include "qcamerainfodata.h"
+
+#include <qtubuntu_media_signals.h>
+
+#include <QAbstractVideoSurface>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QTemporaryDir>
+#include <QTimer>
+#include <QUrl>
+
+#include <algorithm>
+#include <cstdio>
+
+/*
+ * Drives AalCameraService end to end against the simulated device of the mock
+ * HAL, which takes the latencies of a profile and delivers the preview frames,
+ * the shutter, the focus and the compressed image from a thread of its own.
+ * The time of each path users feel is written as JSON, to compare the results
+ * of two commits.
+ */
+
+namespace {
+
+const int TIMEOUT = 5000;
+
+/*!
+ * \brief The BenchmarkSurface class stands in for the QML video node: it
+ * creates a texture for the first frame without one and counts the frames
+ * drawn with a texture
+ */
+class BenchmarkSurface : public QAbstractVideoSurface
+{
+public:
+    BenchmarkSurface()
+        : m_frames(0)
+    {
+    }
+
+    QList<QVideoFrame::PixelFormat> supportedPixelFormats(QAbstractVideoBuffer::HandleType handleType) const
+    {
+        Q_UNUSED(handleType);
+        return QList<QVideoFrame::PixelFormat>() << QVideoFrame::Format_RGB32;
+    }
+
+    bool present(const QVideoFrame &frame)
+    {
+        if (frame.handle().toUInt() == 0) {
+            // Created on the render thread, after the frame was presented
+            QTimer::singleShot(0, SharedSignal::instance(), [] () {
+                Q_EMIT SharedSignal::instance()->textureCreated(1);
+            });
+        } else {
+            ++m_frames;
+        }
+        return true;
+    }
+
+    int frames() const { return m_frames; }
+
+private:
+    int m_frames;
+};
+
+class Benchmark
+{
+public:
+    Benchmark(int iterations, const QString &directory);
+
+    void run();
+    QJsonObject results() const;
+
+private:
+    void measure(const char *name, qint64 time) { m_samples[QByteArray(name)].append(time); }
+    bool waitForFrame(BenchmarkSurface *surface);
+    template<typename Predicate>
+    bool waitFor(Predicate done);
+
+    void runIteration();
+
+    int m_iterations;
+    QString m_directory;
+    QMap<QByteArray, QList<qint64> > m_samples;
+};
+
+Benchmark::Benchmark(int iterations, const QString &directory)
+    : m_iterations(iterations),
+      m_directory(directory)
+{
+}
+
+template<typename Predicate>
+bool Benchmark::waitFor(Predicate done)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!done()) {
+        if (timer.elapsed() > TIMEOUT)
+            return false;
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents, 10);
+    }
+    return true;
+}
+
+bool Benchmark::waitForFrame(BenchmarkSurface *surface)
+{
+    const int frames = surface->frames();
+    if (!waitFor([=] () { return surface->frames() > frames; })) {
+        qWarning() << "No viewfinder frame within" << TIMEOUT << "ms";
+        return false;
+    }
+    return true;
+}
+
+void Benchmark::run()
+{
+    for (int i = 0; i < m_iterations; ++i)
+        runIteration();
+}
+
+void Benchmark::runIteration()
+{
+    QElapsedTimer timer;
+
+    timer.start();
+    AalCameraService *service = new AalCameraService;
+    measure("serviceCreation", timer.nsecsElapsed());
+
+    BenchmarkSurface surface;
+    service->videoOutputControl()->setSurface(&surface);
+    AalCameraControl *camera = service->cameraControl();
+
+    timer.start();
+    camera->setState(QCamera::ActiveState);
+    if (waitForFrame(&surface))
+        measure("firstFrame", timer.nsecsElapsed());
+
+    timer.start();
+    camera->setCaptureMode(QCamera::CaptureVideo);
+    if (waitForFrame(&surface))
+        measure("photoToVideo", timer.nsecsElapsed());
+
+    timer.start();
+    camera->setCaptureMode(QCamera::CaptureStillImage);
+    if (waitForFrame(&surface))
+        measure("videoToPhoto", timer.nsecsElapsed());
+
+    AalVideoDeviceSelectorControl *deviceSelector = service->deviceSelector();
+    timer.start();
+    deviceSelector->setSelectedDevice(1);
+    if (waitForFrame(&surface))
+        measure("backToFront", timer.nsecsElapsed());
+
+    timer.start();
+    deviceSelector->setSelectedDevice(0);
+    if (waitForFrame(&surface))
+        measure("frontToBack", timer.nsecsElapsed());
+
+    AalImageCaptureControl *imageCapture = service->imageCaptureControl();
+    if (waitFor([=] () { return imageCapture->isReadyForCapture(); })) {
+        bool saved = false;
+        qint64 previewTime = -1;
+        QMetaObject::Connection previewConnection =
+                QObject::connect(imageCapture, &AalImageCaptureControl::imageCaptured,
+                                 [&previewTime, &timer] () { previewTime = timer.nsecsElapsed(); });
+        QMetaObject::Connection connection =
+                QObject::connect(imageCapture, &AalImageCaptureControl::imageSaved,
+                                 [&saved] () { saved = true; });
+        timer.start();
+        imageCapture->capture(m_directory + QLatin1String("/image.jpg"));
+        if (waitFor([&saved] () { return saved; }))
+            measure("captureToSaved", timer.nsecsElapsed());
+        else
+            qWarning() << "The image was not saved within" << TIMEOUT << "ms";
+        if (waitFor([&previewTime] () { return previewTime >= 0; }))
+            measure("captureToPreview", previewTime);
+        QObject::disconnect(previewConnection);
+        QObject::disconnect(connection);
+    } else {
+        qWarning() << "The camera did not get ready to capture";
+    }
+
+    camera->setCaptureMode(QCamera::CaptureVideo);
+    waitForFrame(&surface);
+    AalMediaRecorderControl *recorder = service->mediaRecorderControl();
+    recorder->setOutputLocation(QUrl::fromLocalFile(m_directory + QLatin1String("/video.mp4")));
+
+    timer.start();
+    recorder->setState(QMediaRecorder::RecordingState);
+    qint64 elapsed = timer.nsecsElapsed();
+    if (recorder->state() == QMediaRecorder::RecordingState) {
+        measure("recordStart", elapsed);
+
+        timer.start();
+        recorder->setState(QMediaRecorder::StoppedState);
+        elapsed = timer.nsecsElapsed();
+        if (recorder->state() == QMediaRecorder::StoppedState)
+            measure("recordStop", elapsed);
+        else
+            qWarning() << "The recording did not stop";
+    } else {
+        qWarning() << "The recording did not start";
+    }
+
+    camera->setState(QCamera::UnloadedState);
+    delete service;
+}
+
+QJsonObject Benchmark::results() const
+{
+    QJsonObject results;
+    QMap<QByteArray, QList<qint64> >::const_iterator it = m_samples.constBegin();
+    for (; it != m_samples.constEnd(); ++it) {
+        QList<qint64> samples = it.value();
+        std::sort(samples.begin(), samples.end());
+
+        QJsonArray times;
+        Q_FOREACH (qint64 sample, samples)
+            times.append(sample / 1000000.0);
+
+        QJsonObject result;
+        result.insert(QLatin1String("min"), samples.first() / 1000000.0);
+        result.insert(QLatin1String("median"), samples.at(samples.size() / 2) / 1000000.0);
+        result.insert(QLatin1String("max"), samples.last() / 1000000.0);
+        result.insert(QLatin1String("samples"), times);
+        results.insert(QString::fromLatin1(it.key()), result);
+    }
+    return results;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QLatin1String("Measures AalCameraService on a mock HAL"));
+    parser.addHelpOption();
+    QCommandLineOption outputOption(QStringList() << "o" << "output",
+                                    QLatin1String("Write the results to <file>, else to stdout."),
+                                    QLatin1String("file"));
+    QCommandLineOption iterationsOption(QStringList() << "n" << "iterations",
+                                        QLatin1String("Measure every path <count> times."),
+                                        QLatin1String("count"), QLatin1String("10"));
+    QCommandLineOption latenciesOption(QLatin1String("latencies"),
+                                       QLatin1String("Load the HAL latency profile in <file>."),
+                                       QLatin1String("file"));
+    parser.addOption(outputOption);
+    parser.addOption(iterationsOption);
+    parser.addOption(latenciesOption);
+    parser.process(app);
+
+    bool ok = false;
+    const int iterations = parser.value(iterationsOption).toInt(&ok);
+    if (!ok || iterations < 1) {
+        qWarning() << "Invalid number of iterations" << parser.value(iterationsOption);
+        return 1;
+    }
+    if (parser.isSet(latenciesOption) && !HalSimulation::loadLatencies(parser.value(latenciesOption)))
+        return 1;
+
+    QTemporaryDir directory;
+    if (!directory.isValid()) {
+        qWarning() << "Failed to create a directory for the captures";
+        return 1;
+    }
+
+    QCameraInfoData::availableDevices.clear();
+    QCameraInfoData::availableDevices.append(CameraInfo("0", "Back", 0, QCamera::BackFace));
+    QCameraInfoData::availableDevices.append(CameraInfo("1", "Front", 270, QCamera::FrontFace));
+
+    HalSimulation::setDeviceSimulated(true);
+
+    Benchmark benchmark(iterations, directory.path());
+    benchmark.run();
+
+    QJsonObject report;
+    report.insert(QLatin1String("iterations"), iterations);
+    report.insert(QLatin1String("latencies"), parser.value(latenciesOption));
+    report.insert(QLatin1String("unit"), QLatin1String("ms"));
+    report.insert(QLatin1String("results"), benchmark.results());
+    const QByteArray json = QJsonDocument(report).toJson();
+
+    if (!parser.isSet(outputOption)) {
+        fputs(json.constData(), stdout);
+        return 0;
+    }
+
+    QFile output(parser.value(outputOption));
+    if (!output.open(QIODevice::WriteOnly) || output.write(json) != json.size()) {
+        qWarning() << "Failed to write the results to" << output.fileName() << ":" << output.errorString();
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,4 @@
+include(../coverage.pri)
+TEMPLATE = subdirs
+SUBDIRS += \
+    aalcameraservice
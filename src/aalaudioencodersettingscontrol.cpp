@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "aalaudioencodersettingscontrol.h"
+#include "aalcameraservice.h"
+#include "bitratepolicy.h"
+
+const QString AalAudioEncoderSettingsControl::DEFAULT_CODEC = QString("AAC");
+const int AalAudioEncoderSettingsControl::DEFAULT_SAMPLE_RATE = 96000;
+const int AalAudioEncoderSettingsControl::DEFAULT_CHANNEL_COUNT = 2;
+
+/*!
+ * \brief AalAudioEncoderSettingsControl::AalAudioEncoderSettingsControl
+ * \param service
+ * \param parent
+ */
+AalAudioEncoderSettingsControl::AalAudioEncoderSettingsControl(AalCameraService *service, QObject *parent)
+    : QAudioEncoderSettingsControl(parent)
+{
+    Q_UNUSED(service);
+    resetAllSettings();
+}
+
+/*!
+ * \reimp
+ */
+QAudioEncoderSettings AalAudioEncoderSettingsControl::audioSettings() const
+{
+    return m_settings;
+}
+
+/*!
+ * \reimp
+ */
+QString AalAudioEncoderSettingsControl::codecDescription(const QString &codecName) const
+{
+    return codecName;
+}
+
+/*!
+ * \reimp
+ * An explicit bitrate is only used with one of the bitrate encoding modes,
+ * otherwise it is derived from the quality and the number of channels.
+ */
+void AalAudioEncoderSettingsControl::setAudioSettings(const QAudioEncoderSettings &settings)
+{
+    if (supportedAudioCodecs().contains(settings.codec()))
+        m_settings.setCodec(settings.codec());
+
+    if (supportedSampleRates(settings).contains(settings.sampleRate()))
+        m_settings.setSampleRate(settings.sampleRate());
+
+    if (settings.channelCount() == 1 || settings.channelCount() == 2)
+        m_settings.setChannelCount(settings.channelCount());
+
+    m_settings.setEncodingMode(settings.encodingMode());
+    m_settings.setQuality(settings.quality());
+    if (settings.encodingMode() != QMultimedia::ConstantQualityEncoding && settings.bitRate() > 0) {
+        m_settings.setBitRate(settings.bitRate());
+    } else {
+        m_settings.setBitRate(BitratePolicy::audioBitRate(m_settings.channelCount(),
+                                                          m_settings.quality()));
+    }
+}
+
+/*!
+ * \reimp
+ */
+QStringList AalAudioEncoderSettingsControl::supportedAudioCodecs() const
+{
+    QStringList codecs;
+    codecs << DEFAULT_CODEC;
+    return codecs;
+}
+
+/*!
+ * \reimp
+ */
+QList<int> AalAudioEncoderSettingsControl::supportedSampleRates(const QAudioEncoderSettings &settings, bool *continuous) const
+{
+    Q_UNUSED(settings);
+    if (continuous)
+        *continuous = false;
+
+    QList<int> sampleRates;
+    sampleRates << 48000 << 96000;
+    return sampleRates;
+}
+
+/*!
+ * \brief AalAudioEncoderSettingsControl::resetAllSettings goes back to the
+ * settings that were always used for the camcorder audio
+ */
+void AalAudioEncoderSettingsControl::resetAllSettings()
+{
+    m_settings.setCodec(DEFAULT_CODEC);
+    m_settings.setSampleRate(DEFAULT_SAMPLE_RATE);
+    m_settings.setChannelCount(DEFAULT_CHANNEL_COUNT);
+    m_settings.setEncodingMode(QMultimedia::ConstantQualityEncoding);
+    m_settings.setQuality(QMultimedia::NormalQuality);
+    m_settings.setBitRate(BitratePolicy::audioBitRate(DEFAULT_CHANNEL_COUNT));
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef AALAUDIOENCODERSETTINGSCONTROL_H
+#define AALAUDIOENCODERSETTINGSCONTROL_H
+
+#include <QAudioEncoderSettingsControl>
+
+class AalCameraService;
+
+class AalAudioEncoderSettingsControl : public QAudioEncoderSettingsControl
+{
+    Q_OBJECT
+public:
+    explicit AalAudioEncoderSettingsControl(AalCameraService *service, QObject *parent = 0);
+
+    virtual QAudioEncoderSettings audioSettings() const;
+    virtual QString codecDescription(const QString &codecName) const;
+    virtual void setAudioSettings(const QAudioEncoderSettings &settings);
+    virtual QStringList supportedAudioCodecs() const;
+    virtual QList<int> supportedSampleRates(const QAudioEncoderSettings &settings, bool *continuous = 0) const;
+
+    void resetAllSettings();
+
+private:
+    QAudioEncoderSettings m_settings;
+
+    static const QString DEFAULT_CODEC;
+    static const int DEFAULT_SAMPLE_RATE;
+    static const int DEFAULT_CHANNEL_COUNT;
+};
+
+#endif // AALAUDIOENCODERSETTINGSCONTROL_H
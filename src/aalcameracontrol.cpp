@@ -17,6 +17,8 @@
 #include "aalcameracontrol.h"
 #include "aalcameraservice.h"
 #include "aalmediarecordercontrol.h"
+#include "haleventqueue.h"
+#include "haltrace.h"
 
 #include <QtGui/QGuiApplication>
 
@@ -171,7 +173,7 @@ void AalCameraControl::handleError()
 
 void AalCameraControl::errorCB(void *context)
 {
-    Q_UNUSED(context);
-    QMetaObject::invokeMethod(AalCameraService::instance()->cameraControl(),
-                              "handleError", Qt::QueuedConnection);
+    HalTraceSpan span(Q_FUNC_INFO);
+    halRecordCallback("on_msg_error");
+    static_cast<AalCameraService*>(context)->postHalEvent(new HalEvent(HalEvent::CameraError));
 }
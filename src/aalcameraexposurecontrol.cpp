@@ -17,6 +17,7 @@
 #include "aalcameraexposurecontrol.h"
 #include "aalcameracontrol.h"
 #include "aalcameraservice.h"
+#include "haltrace.h"
 
 #include <hybris/camera/camera_compatibility_layer.h>
 #include <hybris/camera/camera_compatibility_layer_capabilities.h>
@@ -43,7 +44,7 @@ void AalCameraExposureControl::init(CameraControl *control, CameraControlListene
     Q_UNUSED(listener);
 
     m_supportedExposureModes.clear();
-    android_camera_enumerate_supported_scene_modes(control, &AalCameraExposureControl::supportedSceneModesCallback, this);
+    HAL_TRACE(android_camera_enumerate_supported_scene_modes, control, &AalCameraExposureControl::supportedSceneModesCallback, this);
 
     setValue(QCameraExposureControl::ExposureMode, m_requestedExposureMode);
 
@@ -52,6 +53,7 @@ void AalCameraExposureControl::init(CameraControl *control, CameraControlListene
 
 void AalCameraExposureControl::supportedSceneModesCallback(void *context, SceneMode sceneMode)
 {
+    halRecordCallback("scene_mode_callback", sceneMode);
     AalCameraExposureControl *self = (AalCameraExposureControl*)context;
     self->m_supportedExposureModes << self->m_androidToQtExposureModes[sceneMode];
 }
@@ -70,7 +72,7 @@ bool AalCameraExposureControl::setValue(ExposureParameter parameter, const QVari
 
         if (m_service->androidControl() != NULL && m_supportedExposureModes.contains(m_requestedExposureMode)) {
             SceneMode sceneMode = m_androidToQtExposureModes.key(m_requestedExposureMode);
-            android_camera_set_scene_mode(m_service->androidControl(), sceneMode);
+            HAL_TRACE(android_camera_set_scene_mode, m_service->androidControl(), sceneMode);
             m_actualExposureMode = m_requestedExposureMode;
             Q_EMIT actualValueChanged(QCameraExposureControl::ExposureMode);
             return true;
@@ -17,6 +17,7 @@
 #include "aalcameraflashcontrol.h"
 #include "aalcameracontrol.h"
 #include "aalcameraservice.h"
+#include "haltrace.h"
 
 #include <QDebug>
 
@@ -54,7 +55,7 @@ void AalCameraFlashControl::setFlashMode(QCameraExposure::FlashModes mode)
     m_currentMode = mode;
 
     if (m_service->androidControl()) {
-        android_camera_set_flash_mode(m_service->androidControl(), fmode);
+        HAL_TRACE(android_camera_set_flash_mode, m_service->androidControl(), fmode);
     }
 }
 
@@ -63,7 +64,7 @@ void AalCameraFlashControl::init(CameraControl *control)
     querySupportedFlashModes(control);
 
     FlashMode mode = qt2Android(m_currentMode);
-    android_camera_set_flash_mode(control, mode);
+    HAL_TRACE(android_camera_set_flash_mode, control, mode);
 
     Q_EMIT flashReady(true);
 }
@@ -111,11 +112,12 @@ void AalCameraFlashControl::querySupportedFlashModes(CameraControl *control)
 {
     m_supportedModes.clear();
 
-    android_camera_enumerate_supported_flash_modes(control, &AalCameraFlashControl::supportedFlashModesCallback, this);
+    HAL_TRACE(android_camera_enumerate_supported_flash_modes, control, &AalCameraFlashControl::supportedFlashModesCallback, this);
 }
 
 void AalCameraFlashControl::supportedFlashModesCallback(void *context, FlashMode flashMode)
 {
+    halRecordCallback("flash_mode_callback", flashMode);
     AalCameraFlashControl *self = (AalCameraFlashControl*)context;
     self->m_supportedModes << self->android2Qt(flashMode);
 }
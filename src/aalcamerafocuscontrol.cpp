@@ -17,6 +17,8 @@
 #include "aalcamerafocuscontrol.h"
 #include "aalcameracontrol.h"
 #include "aalcameraservice.h"
+#include "haleventqueue.h"
+#include "haltrace.h"
 
 #include <QDebug>
 #include <QTimer>
@@ -90,8 +92,8 @@ void AalCameraFocusControl::setCustomFocusPoint(const QPointF &point)
     Q_EMIT customFocusPointChanged(m_focusPoint);
 
     if (m_service->androidControl()) {
-        android_camera_set_metering_region(m_service->androidControl(), &meteringRegion);
-        android_camera_set_focus_region(m_service->androidControl(), &m_focusRegion);
+        HAL_TRACE(android_camera_set_metering_region, m_service->androidControl(), &meteringRegion);
+        HAL_TRACE(android_camera_set_focus_region, m_service->androidControl(), &m_focusRegion);
         startFocus();
     }
 }
@@ -106,7 +108,7 @@ void AalCameraFocusControl::setFocusMode(QCameraFocus::FocusModes mode)
     AutoFocusMode focusMode = qt2Android(mode);
     m_focusMode = mode;
     if (m_service->androidControl()) {
-        android_camera_set_auto_focus_mode(m_service->androidControl(), focusMode);
+        HAL_TRACE(android_camera_set_auto_focus_mode, m_service->androidControl(), focusMode);
     }
 
     Q_EMIT focusModeChanged(m_focusMode);
@@ -123,10 +125,9 @@ void AalCameraFocusControl::setFocusPointMode(QCameraFocus::FocusPointMode mode)
 
 void AalCameraFocusControl::focusCB(void *context)
 {
-    Q_UNUSED(context);
-    AalCameraService::instance()->focusControl()->m_focusRunning = false;
-    QMetaObject::invokeMethod(AalCameraService::instance(),
-                              "updateCaptureReady", Qt::QueuedConnection);
+    HalTraceSpan span(Q_FUNC_INFO);
+    halRecordCallback("on_msg_focus");
+    static_cast<AalCameraService*>(context)->postHalEvent(new HalEvent(HalEvent::Focus));
 }
 
 bool AalCameraFocusControl::isFocusBusy() const
@@ -155,7 +156,7 @@ void AalCameraFocusControl::init(CameraControl *control, CameraControlListener *
     listener->on_msg_focus_cb = &AalCameraFocusControl::focusCB;
 
     AutoFocusMode mode = qt2Android(m_focusMode);
-    android_camera_set_auto_focus_mode(control, mode);
+    HAL_TRACE(android_camera_set_auto_focus_mode, control, mode);
     m_focusRunning = false;
     m_service->updateCaptureReady();
 }
@@ -167,7 +168,7 @@ void AalCameraFocusControl::startFocus()
 
     m_focusRunning = true;
     m_service->updateCaptureReady();
-    android_camera_start_autofocus(m_service->androidControl());
+    HAL_TRACE(android_camera_start_autofocus, m_service->androidControl());
 }
 
 AutoFocusMode AalCameraFocusControl::qt2Android(QCameraFocus::FocusModes mode)
@@ -62,6 +62,8 @@ private:
     QPointF m_focusPoint;
     FocusRegion m_focusRegion;
     bool m_focusRunning;
+
+    friend class AalCameraService;
 };
 
 #endif // AALCAMERAFOCUSCONTROL_H
@@ -14,6 +14,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "aalaudioencodersettingscontrol.h"
 #include "aalcameracontrol.h"
 #include "aalcameraflashcontrol.h"
 #include "aalcamerafocuscontrol.h"
@@ -31,22 +32,28 @@
 #include "storagemanager.h"
 #include "aalcameraexposurecontrol.h"
 #include "rotationhandler.h"
+#include "haleventqueue.h"
+#include "haltrace.h"
 
 #include <hybris/camera/camera_compatibility_layer.h>
 
+#include <QCoreApplication>
 #include <QDebug>
+#include <QEvent>
+#include <QSettings>
 #include <cmath>
 
-AalCameraService *AalCameraService::m_service = 0;
+// Posted to the service when HAL events are waiting, once per batch
+static const QEvent::Type HalEventsPending = static_cast<QEvent::Type>(QEvent::registerEventType());
 
 AalCameraService::AalCameraService(QObject *parent):
     QMediaService(parent),
     m_androidControl(0),
-    m_androidListener(0)
+    m_androidListener(0),
+    m_halEvents(new HalEventQueue)
 {
-    m_service = this;
-
     m_storageManager = new StorageManager;
+    m_audioEncoderControl = new AalAudioEncoderSettingsControl(this);
     m_cameraControl = new AalCameraControl(this);
     m_flashControl = new AalCameraFlashControl(this);
     m_focusControl = new AalCameraFocusControl(this);
@@ -68,6 +75,7 @@ AalCameraService::~AalCameraService()
 {
     disconnectCamera();
     m_cameraControl->setState(QCamera::UnloadedState);
+    delete m_audioEncoderControl;
     delete m_cameraControl;
     delete m_flashControl;
     delete m_focusControl;
@@ -83,13 +91,17 @@ AalCameraService::~AalCameraService()
     delete m_exposureControl;
     delete m_infoControl;
     if (m_androidControl)
-        android_camera_delete(m_androidControl);
+        HAL_TRACE(android_camera_delete, m_androidControl);
     delete m_storageManager;
     delete m_rotationHandler;
+    delete m_halEvents;
 }
 
 QMediaControl *AalCameraService::requestControl(const char *name)
 {
+    if (qstrcmp(name, QAudioEncoderSettingsControl_iid) == 0)
+        return m_audioEncoderControl;
+
     if (qstrcmp(name, QCameraControl_iid) == 0)
         return m_cameraControl;
 
@@ -162,17 +174,20 @@ bool AalCameraService::connectCamera()
 
     m_androidListener = new CameraControlListener;
     memset(m_androidListener, 0, sizeof(*m_androidListener));
+    // The camera callbacks find their controls through the service they were
+    // registered by, so that several services can run side by side
+    m_androidListener->context = this;
 
     // if there is only one camera fallback directly to the ID of whatever device we have
     if (m_deviceSelectControl->deviceCount() == 1) {
-        m_androidControl = android_camera_connect_by_id(m_deviceSelectControl->selectedDevice(), m_androidListener);
+        m_androidControl = HAL_TRACE(android_camera_connect_by_id, m_deviceSelectControl->selectedDevice(), m_androidListener);
     } else {
         CameraType device = BACK_FACING_CAMERA_TYPE;
         if (!isBackCameraUsed()) {
             device = FRONT_FACING_CAMERA_TYPE;
         }
 
-        m_androidControl = android_camera_connect_to(device, m_androidListener);
+        m_androidControl = HAL_TRACE(android_camera_connect_to, device, m_androidListener);
     }
 
     if (!m_androidControl) {
@@ -181,7 +196,6 @@ bool AalCameraService::connectCamera()
         return false;
     }
 
-    m_androidListener->context = m_androidControl;
     initControls(m_androidControl, m_androidListener);
 
     this->m_cameraControl->setStatus(QCamera::LoadedStatus);
@@ -196,9 +210,10 @@ void AalCameraService::disconnectCamera()
     }
 
     stopPreview();
+    m_mediaRecorderControl->releaseAudioCapture();
 
     if (m_androidControl) {
-        android_camera_disconnect(m_androidControl);
+        HAL_TRACE(android_camera_disconnect, m_androidControl);
         m_androidControl = 0;
     }
 
@@ -258,9 +273,11 @@ void AalCameraService::enablePhotoMode()
         // Trick to make applications notice the change.
         this->m_cameraControl->setStatus(QCamera::StartingStatus);
 
-    m_flashControl->init(m_service->androidControl());
+    m_flashControl->init(androidControl());
     m_imageEncoderControl->enablePhotoMode();
     m_focusControl->enablePhotoMode();
+    m_mediaRecorderControl->releaseAudioCapture();
+    m_viewfinderControl->setFrameRate(0);
     m_viewfinderControl->setAspectRatio(m_imageEncoderControl->getAspectRatio());
 
     if (isPreviewStarted())
@@ -276,9 +293,17 @@ void AalCameraService::enableVideoMode()
         // Trick to make applications notice the change.
         this->m_cameraControl->setStatus(QCamera::StartingStatus);
 
-    m_flashControl->init(m_service->androidControl());
+    m_flashControl->init(androidControl());
     m_focusControl->enableVideoMode();
+    m_videoEncoderControl->updateViewfinderFrameRate();
     m_viewfinderControl->setAspectRatio(m_videoEncoderControl->getAspectRatio());
+    // Known before the first recording starts, to keep its bitrate within it.
+    // The test writes to the user storage, so it only runs when asked for
+    QSettings settings;
+    if (settings.value("measureWriteThroughput", false).toBool())
+        m_storageManager->measureWriteThroughput();
+    // Connected before the first recording starts, so that starting is instant
+    m_mediaRecorderControl->prepareAudioCapture();
 
     if (isPreviewStarted())
         this->m_cameraControl->setStatus(QCamera::ActiveStatus);
@@ -302,6 +327,8 @@ void AalCameraService::updateCaptureReady()
         ready = false;
     if (m_imageCaptureControl->isCaptureRunning())
         ready = false;
+    if (m_imageCaptureControl->isCaptureMemoryExhausted())
+        ready = false;
     if (m_focusControl->isFocusBusy())
         ready = false;
     if (!isPreviewStarted())
@@ -310,6 +337,76 @@ void AalCameraService::updateCaptureReady()
     m_imageCaptureControl->setReady(ready);
 }
 
+/*!
+ * \brief AalCameraService::postHalEvent hands \p event over from a HAL thread,
+ * without locking. The service handles it on its own thread, and takes
+ * ownership of it.
+ */
+void AalCameraService::postHalEvent(HalEvent *event)
+{
+    // Only the first event of a batch wakes up the service, the others are
+    // handled along with it
+    if (m_halEvents->push(event))
+        QCoreApplication::postEvent(this, new QEvent(HalEventsPending));
+}
+
+void AalCameraService::customEvent(QEvent *event)
+{
+    if (event->type() == HalEventsPending)
+        handleHalEvents();
+    else
+        QMediaService::customEvent(event);
+}
+
+/*!
+ * \brief AalCameraService::handleHalEvents handles the waiting HAL events in
+ * the order they came in
+ */
+void AalCameraService::handleHalEvents()
+{
+    HalEvent *event = m_halEvents->takeAll();
+    while (event != 0) {
+        HalEvent *next = event->next;
+        // Drawing a viewfinder frame shows the latest one anyway
+        if (event->type != HalEvent::ViewfinderFrame || next == 0 ||
+                next->type != HalEvent::ViewfinderFrame)
+            handleHalEvent(*event);
+        delete event;
+        event = next;
+    }
+}
+
+void AalCameraService::handleHalEvent(const HalEvent &event)
+{
+    switch (event.type) {
+    case HalEvent::Shutter:
+        m_imageCaptureControl->shutter();
+        break;
+    case HalEvent::Focus:
+        m_focusControl->m_focusRunning = false;
+        updateCaptureReady();
+        break;
+    case HalEvent::Zoom:
+        m_zoomControl->updateZoom(event.value);
+        break;
+    case HalEvent::ViewfinderFrame:
+        if (m_videoOutput->isPreviewStarted())
+            m_videoOutput->updateViewfinderFrame();
+        break;
+    case HalEvent::Jpeg:
+        m_imageCaptureControl->saveJpeg(event.data);
+        break;
+    case HalEvent::CameraError:
+        // No JPEG follows a failed snapshot to restore the viewfinder zoom
+        m_imageCaptureControl->restoreZoom();
+        m_cameraControl->handleError();
+        break;
+    case HalEvent::RecorderError:
+        m_mediaRecorderControl->handleError();
+        break;
+    }
+}
+
 /*!
  * \brief AalCameraService::initControls initialize all the controls for a newly
  * connected camera
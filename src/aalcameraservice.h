@@ -21,6 +21,7 @@
 #include <QSize>
 #include <QtMultimedia/QCamera>
 
+class AalAudioEncoderSettingsControl;
 class AalCameraControl;
 class AalCameraFlashControl;
 class AalCameraFocusControl;
@@ -36,6 +37,8 @@ class AalViewfinderSettingsControl;
 class AalCameraExposureControl;
 class AalCameraInfoControl;
 class QCameraControl;
+class HalEvent;
+class HalEventQueue;
 
 struct CameraControl;
 struct CameraControlListener;
@@ -53,6 +56,7 @@ public:
     QMediaControl* requestControl(const char *name);
     void releaseControl(QMediaControl *control);
 
+    AalAudioEncoderSettingsControl *audioEncoderControl() const { return m_audioEncoderControl; }
     AalCameraControl *cameraControl() const { return m_cameraControl; }
     AalCameraFlashControl *flashControl() const { return m_flashControl; }
     AalCameraFocusControl *focusControl() const { return m_focusControl; }
@@ -88,16 +92,20 @@ public:
     bool isRecording() const;
     QSize selectSizeWithAspectRatio(const QList<QSize> &sizes, float targetAspectRatio) const;
 
-    static AalCameraService *instance() { return m_service; }
+    void postHalEvent(HalEvent *event);
 
 public Q_SLOTS:
     void updateCaptureReady();
 
+protected:
+    void customEvent(QEvent *event);
+
 private:
     void initControls(CameraControl *camControl, CameraControlListener *listener);
+    void handleHalEvents();
+    void handleHalEvent(const HalEvent &event);
 
-    static AalCameraService *m_service;
-
+    AalAudioEncoderSettingsControl *m_audioEncoderControl;
     AalCameraControl *m_cameraControl;
     AalCameraFlashControl *m_flashControl;
     AalCameraFocusControl *m_focusControl;
@@ -118,6 +126,9 @@ private:
 
     StorageManager *m_storageManager;
     RotationHandler *m_rotationHandler;
+
+    // Callbacks from the HAL threads, handled on the thread of the service
+    HalEventQueue *m_halEvents;
 };
 
 #endif
@@ -16,6 +16,7 @@
 
 #include "aalcameraserviceplugin.h"
 #include "aalcameraservice.h"
+#include "haltrace.h"
 
 #include <QByteArray>
 #include <QDebug>
@@ -55,7 +56,7 @@ QList<QByteArray> AalServicePlugin::devices(const QByteArray &service) const
     }
 
     // Devices are identified in android only by their index, so we do the same
-    int cameras = android_camera_get_number_of_devices();
+    int cameras = HAL_TRACE(android_camera_get_number_of_devices);
     for (int deviceId = 0; deviceId < cameras; deviceId++) {
         QString camera("%1");
         camera = camera.arg(deviceId);
@@ -75,7 +76,7 @@ QString AalServicePlugin::deviceDescription(const QByteArray &service, const QBy
     // send back the index plus some useful human readable information about position.
     bool ok;
     int deviceID = device.toInt(&ok, 10);
-    if (!ok || deviceID >= android_camera_get_number_of_devices()) {
+    if (!ok || deviceID >= HAL_TRACE(android_camera_get_number_of_devices)) {
         qWarning() << "Requested description for invalid device ID:" << device;
         return QString();
     } else {
@@ -118,7 +119,7 @@ int AalServicePlugin::cameraOrientation(const QByteArray & device) const
         return 0;
     }
 
-    int result = android_camera_get_device_info(deviceID, &facing, &orientation);
+    int result = HAL_TRACE(android_camera_get_device_info, deviceID, &facing, &orientation);
     if (result != 0) {
         return 0;
     }
@@ -142,7 +143,7 @@ QCamera::Position AalServicePlugin::cameraPosition(const QByteArray & device) co
         return QCamera::UnspecifiedPosition;
     }
 
-    int result = android_camera_get_device_info(deviceID, &facing, &orientation);
+    int result = HAL_TRACE(android_camera_get_device_info, deviceID, &facing, &orientation);
     if (result != 0) {
         return QCamera::UnspecifiedPosition;
     } else {
@@ -17,6 +17,8 @@
 #include "aalcamerazoomcontrol.h"
 #include "aalcameracontrol.h"
 #include "aalcameraservice.h"
+#include "haleventqueue.h"
+#include "haltrace.h"
 
 #include <QDebug>
 
@@ -79,7 +81,7 @@ void AalCameraZoomControl::zoomTo(qreal optical, qreal digital)
     if (m_pendingZoom == m_currentDigitalZoom)
         return;
 
-    android_camera_set_zoom(m_service->androidControl(), m_pendingZoom);
+    HAL_TRACE(android_camera_set_zoom, m_service->androidControl(), m_pendingZoom);
     m_currentDigitalZoom = m_pendingZoom;
     Q_EMIT currentDigitalZoomChanged(m_currentDigitalZoom);
 }
@@ -87,11 +89,31 @@ void AalCameraZoomControl::zoomTo(qreal optical, qreal digital)
 void AalCameraZoomControl::init(CameraControl *control, CameraControlListener *listener)
 {
     Q_UNUSED(control);
-    Q_UNUSED(listener);
 
+    listener->on_msg_zoom_cb = &AalCameraZoomControl::zoomCB;
     resetZoom();
 }
 
+void AalCameraZoomControl::zoomCB(void *context, int32_t level)
+{
+    HalTraceSpan span(Q_FUNC_INFO);
+    halRecordCallback("on_msg_zoom", level);
+    static_cast<AalCameraService*>(context)->postHalEvent(new HalEvent(HalEvent::Zoom, level));
+}
+
+/*!
+ * \brief AalCameraZoomControl::updateZoom follows the zoom level reported by
+ * the camera, which steps through the levels on its own with smooth zoom
+ */
+void AalCameraZoomControl::updateZoom(int level)
+{
+    if (level < 0 || level > m_maximumDigitalZoom || level == m_currentDigitalZoom)
+        return;
+
+    m_currentDigitalZoom = level;
+    Q_EMIT currentDigitalZoomChanged(m_currentDigitalZoom);
+}
+
 /*!
  * \brief AalCameraZoomControl::reset sets the current zoom value to 0 and the
  * maximum zoom value to the maximum zoom level that the hardware reports as
@@ -108,10 +130,10 @@ void AalCameraZoomControl::resetZoom()
         Q_EMIT currentDigitalZoomChanged(m_currentDigitalZoom);
     }
 
-    android_camera_set_zoom(m_service->androidControl(), m_currentDigitalZoom);
+    HAL_TRACE(android_camera_set_zoom, m_service->androidControl(), m_currentDigitalZoom);
 
     int maxValue = 1;
-    android_camera_get_max_zoom(m_service->androidControl(), &maxValue);
+    HAL_TRACE(android_camera_get_max_zoom, m_service->androidControl(), &maxValue);
     if (maxValue < 0) {
         return;
     }
@@ -19,6 +19,8 @@
 
 #include <QCameraZoomControl>
 
+#include <stdint.h>
+
 class AalCameraService;
 class CameraControl;
 class CameraControlListener;
@@ -39,15 +41,21 @@ public:
 
     void resetZoom();
 
+    static void zoomCB(void *context, int32_t level);
+
 public Q_SLOTS:
     void init(CameraControl *control, CameraControlListener *listener);
 
 private:
+    void updateZoom(int level);
+
     AalCameraService *m_service;
 
     int m_currentDigitalZoom;
     int m_maximumDigitalZoom;
     int m_pendingZoom;
+
+    friend class AalCameraService;
 };
 
 #endif // AALCAMERAZOOMCONTROL_H
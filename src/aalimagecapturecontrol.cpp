@@ -15,11 +15,16 @@
  */
 
 #include "aalcameraservice.h"
+#include "aalcamerazoomcontrol.h"
 #include "aalimagecapturecontrol.h"
 #include "aalimageencodercontrol.h"
 #include "aalmetadatawritercontrol.h"
 #include "aalvideorenderercontrol.h"
+#include "aalvideodeviceselectorcontrol.h"
 #include "aalviewfindersettingscontrol.h"
+#include "devicequirks.h"
+#include "haleventqueue.h"
+#include "haltrace.h"
 #include "storagemanager.h"
 #include "rotationhandler.h"
 
@@ -47,15 +52,31 @@ AalImageCaptureControl::AalImageCaptureControl(AalCameraService *service, QObjec
     m_ready(false),
     m_targetFileName(),
     m_captureCancelled(false),
+    m_halWritesMetadata(false),
+    m_exifRotation(0),
+    m_rotateAfterSaving(false),
+    m_cropZoom(1.0),
+    m_restoreZoomLevel(0),
+    m_previewCapturePending(false),
+    m_previewCaptureRotation(0),
     m_screenAspectRatio(0.0),
-    m_audioPlayer(new QMediaPlayer(this))
+    m_audioPlayer(new QMediaPlayer(this)),
+    m_spilledCaptureCost(0)
 {
     m_galleryPath = QStandardPaths::writableLocation(QStandardPaths::PicturesLocation);
     m_audioPlayer->setMedia(QUrl::fromLocalFile("/usr/share/sounds/ubports/camera/click/camera_click.ogg"));
     m_audioPlayer->setAudioRole(QAudio::NotificationRole);
 
+    // In MiB, devices with little memory lower it
+    if (m_settings.contains("captureMemoryBudget")) {
+        qint64 budget = m_settings.value("captureMemoryBudget").toLongLong();
+        m_storageManager.setCaptureMemoryBudget(budget * 1024 * 1024);
+    }
+
     QObject::connect(&m_storageManager, &StorageManager::previewReady,
                      this, &AalImageCaptureControl::imageCaptured);
+    QObject::connect(&m_storageManager, &StorageManager::imageNormalized,
+                     this, &AalImageCaptureControl::imageNormalized);
 }
 
 AalImageCaptureControl::~AalImageCaptureControl()
@@ -82,9 +103,49 @@ int AalImageCaptureControl::capture(const QString &fileName)
 
     RotationHandler *rotationHandler = m_service->rotationHandler();
     int rotation = rotationHandler->calculateRotation();
-    android_camera_set_rotation(m_service->androidControl(), rotation);
 
-    android_camera_take_snapshot(m_service->androidControl());
+    if (m_service->isRecording() && !isVideoSnapshotSupported()) {
+        // A regular snapshot stops the preview the recorder is fed from, so
+        // the picture is taken from the viewfinder instead
+        if (!m_service->videoOutputControl()->createPreview()) {
+            m_targetFileName.clear();
+            emit error(m_lastRequestId, QCameraImageCapture::NotReadyError,
+                       QLatin1String("No viewfinder to capture from"));
+            return m_lastRequestId;
+        }
+        m_previewCapturePending = true;
+        m_previewCaptureRotation = rotation;
+        m_service->updateCaptureReady();
+        return m_lastRequestId;
+    }
+
+    // Rotating the full resolution picture in the HAL takes long, where viewers
+    // honour the EXIF Orientation it is rotated by them instead, elsewhere it
+    // can be turned losslessly once it was saved
+    m_exifRotation = 0;
+    m_rotateAfterSaving = isLosslessRotationUsed();
+    if (m_rotateAfterSaving || isExifOrientationUsed()) {
+        m_exifRotation = rotation;
+        rotation = 0;
+    }
+
+    // The HAL upscales a zoomed picture, instead it can be taken at zoom 1
+    // and the zoomed part cut out of it losslessly when saving. A video
+    // snapshot shares the zoom with the recording, so it is left alone
+    m_cropZoom = 1.0;
+    m_restoreZoomLevel = 0;
+    int zoomLevel = qRound(m_service->zoomControl()->currentDigitalZoom());
+    if (zoomLevel > 0 && !m_service->isRecording() && isLosslessZoomUsed()) {
+        m_cropZoom = digitalZoomRatio();
+        m_restoreZoomLevel = zoomLevel;
+        HAL_TRACE(android_camera_set_zoom, m_service->androidControl(), 0);
+    }
+
+    HAL_TRACE(android_camera_set_rotation, m_service->androidControl(), rotation);
+    setHalLocation();
+    m_halWritesMetadata = isHalExifTrusted();
+
+    HAL_TRACE(android_camera_take_snapshot, m_service->androidControl());
 
     m_service->updateCaptureReady();
 
@@ -97,24 +158,139 @@ void AalImageCaptureControl::cancelCapture()
     m_targetFileName.clear();
 }
 
+/*!
+ * \brief AalImageCaptureControl::isVideoSnapshotSupported returns true if the
+ * HAL can take a full resolution picture while recording without stopping the
+ * preview. Android reports this as the "video-snapshot-supported" parameter,
+ * which is not exposed through hybris, so devices opt in with the
+ * aal.camera.videosnapshot.<id> property
+ */
+bool AalImageCaptureControl::isVideoSnapshotSupported() const
+{
+    int deviceId = m_service->deviceSelector()->selectedDevice();
+    return DeviceQuirks::isEnabled(QLatin1String("videosnapshot"), deviceId);
+}
+
+/*!
+ * \brief AalImageCaptureControl::isHalExifTrusted returns true if the JPEG of
+ * the HAL can be saved as it is, because the HAL writes the time and the
+ * location given by setHalLocation() into its EXIF data correctly. Many HALs
+ * write the time in UTC, so the EXIF data is rewritten when saving unless the
+ * device was verified and opts in with the aal.camera.trusthalexif.<id>
+ * property
+ */
+bool AalImageCaptureControl::isHalExifTrusted() const
+{
+    int deviceId = m_service->deviceSelector()->selectedDevice();
+    return DeviceQuirks::isEnabled(QLatin1String("trusthalexif"), deviceId);
+}
+
+/*!
+ * \brief AalImageCaptureControl::isExifOrientationUsed returns true if pictures
+ * are saved as the sensor took them, with an EXIF Orientation telling viewers
+ * how to rotate them. Devices where the gallery and the other viewers have
+ * been verified to honour it opt in with the aal.camera.exiforientation.<id>
+ * property
+ */
+bool AalImageCaptureControl::isExifOrientationUsed() const
+{
+    int deviceId = m_service->deviceSelector()->selectedDevice();
+    return DeviceQuirks::isEnabled(QLatin1String("exiforientation"), deviceId);
+}
+
+/*!
+ * \brief AalImageCaptureControl::isLosslessRotationUsed returns true if
+ * pictures are saved with an EXIF Orientation first, and then turned upright
+ * losslessly in the background for the viewers which ignore it. Devices opt in
+ * with the aal.camera.losslessrotation.<id> property
+ */
+bool AalImageCaptureControl::isLosslessRotationUsed() const
+{
+    int deviceId = m_service->deviceSelector()->selectedDevice();
+    return DeviceQuirks::isEnabled(QLatin1String("losslessrotation"), deviceId);
+}
+
+/*!
+ * \brief AalImageCaptureControl::isLosslessZoomUsed returns true if zoomed
+ * pictures are taken at zoom 1 and cropped losslessly when saving, rather than
+ * upscaled by the HAL. Devices opt in with the aal.camera.losslesszoom.<id>
+ * property
+ */
+bool AalImageCaptureControl::isLosslessZoomUsed() const
+{
+    int deviceId = m_service->deviceSelector()->selectedDevice();
+    return DeviceQuirks::isEnabled(QLatin1String("losslesszoom"), deviceId);
+}
+
+/*!
+ * \brief AalImageCaptureControl::digitalZoomRatio returns the magnification of
+ * the current zoom level. Android spreads the levels evenly up to the maximum
+ * zoom ratio, which is not exposed through hybris, so devices zooming further
+ * or less than 4x set it with the aal.camera.maxzoomratio.<id> property
+ */
+qreal AalImageCaptureControl::digitalZoomRatio() const
+{
+    AalCameraZoomControl *zoomControl = m_service->zoomControl();
+    if (zoomControl->maximumDigitalZoom() <= 0)
+        return 1.0;
+
+    int deviceId = m_service->deviceSelector()->selectedDevice();
+    bool ok = false;
+    qreal maximumRatio = DeviceQuirks::value(QLatin1String("maxzoomratio"), deviceId).toDouble(&ok);
+    if (!ok || maximumRatio < 1.0)
+        maximumRatio = 4.0;
+
+    return 1.0 + (maximumRatio - 1.0) * zoomControl->currentDigitalZoom()
+            / zoomControl->maximumDigitalZoom();
+}
+
+/*!
+ * \brief AalImageCaptureControl::setHalLocation passes the GPS metadata of the
+ * next picture to the HAL, so that it goes into the EXIF data of the JPEG. A
+ * picture without GPS metadata clears the location of the previous one.
+ */
+void AalImageCaptureControl::setHalLocation()
+{
+    AalMetaDataWriterControl* metadataControl = m_service->metadataWriterControl();
+    const QVariant latitudeValue = metadataControl->metaData("GPSLatitude");
+    const QVariant longitudeValue = metadataControl->metaData("GPSLongitude");
+    const QVariant timestampValue = metadataControl->metaData("GPSTimeStamp");
+    const QVariant altitudeValue = metadataControl->metaData("GPSAltitude");
+
+    CameraControl *cc = m_service->androidControl();
+    if (!latitudeValue.isValid() || !longitudeValue.isValid() || !timestampValue.isValid()) {
+        HAL_TRACE(android_camera_set_location, cc, 0, 0, 0, 0, 0);
+        return;
+    }
+
+    const float latitude = latitudeValue.toFloat();
+    const float longitude = longitudeValue.toFloat();
+    const float altitude = altitudeValue.toFloat();
+    const int timestamp = timestampValue.toDateTime().toTime_t();
+    const QByteArray method = metadataControl->metaData("GPSProcessingMethod").toString().toLatin1();
+    HAL_TRACE(android_camera_set_location, cc, &latitude, &longitude,
+              altitudeValue.isValid() ? &altitude : 0, timestamp,
+              method.isEmpty() ? 0 : method.constData());
+}
+
 void AalImageCaptureControl::shutterCB(void *context)
 {
-    Q_UNUSED(context);
-    QMetaObject::invokeMethod(AalCameraService::instance()->imageCaptureControl(),
-                              "shutter", Qt::QueuedConnection);
+    HalTraceSpan span(Q_FUNC_INFO);
+    halRecordCallback("on_msg_shutter");
+    static_cast<AalCameraService*>(context)->postHalEvent(new HalEvent(HalEvent::Shutter));
 }
 
 void AalImageCaptureControl::saveJpegCB(void *data, uint32_t data_size, void *context)
 {
-    Q_UNUSED(context);
+    HalTraceSpan span(Q_FUNC_INFO);
+    if (HalRecorder::isEnabled())
+        HalRecorder::recordCallback("on_data_compressed_image", QByteArray(), data, data_size);
 
     // Copy the data buffer so that it is safe to pass it off to another thread,
     // since it will be destroyed once this function returns
-    QByteArray dataCopy((const char*)data, data_size);
-
-    QMetaObject::invokeMethod(AalCameraService::instance()->imageCaptureControl(),
-                              "saveJpeg", Qt::QueuedConnection,
-                              Q_ARG(QByteArray, dataCopy));
+    HalEvent *event = new HalEvent(HalEvent::Jpeg);
+    event->data = QByteArray((const char*)data, data_size);
+    static_cast<AalCameraService*>(context)->postHalEvent(event);
 }
 
 void AalImageCaptureControl::init(CameraControl *control, CameraControlListener *listener)
@@ -124,6 +300,11 @@ void AalImageCaptureControl::init(CameraControl *control, CameraControlListener
     listener->on_msg_shutter_cb = &AalImageCaptureControl::shutterCB;
     listener->on_data_compressed_image_cb = &AalImageCaptureControl::saveJpegCB;
 
+    // The zoom of a newly connected camera starts at 0, there is nothing of a
+    // capture on the previous one to restore
+    m_cropZoom = 1.0;
+    m_restoreZoomLevel = 0;
+
     connect(m_service->videoOutputControl(), SIGNAL(previewReady()), this, SLOT(onPreviewReady()));
 }
 
@@ -140,29 +321,52 @@ bool AalImageCaptureControl::isCaptureRunning() const
     return !m_targetFileName.isEmpty();
 }
 
+/*!
+ * \brief AalImageCaptureControl::isCaptureMemoryExhausted returns true if not
+ * even a spilled picture the size of the last one fits into the capture memory
+ * budget, so that no more can be taken until the ones being saved are done
+ */
+bool AalImageCaptureControl::isCaptureMemoryExhausted() const
+{
+    return !m_storageManager.fitsCaptureMemory(m_spilledCaptureCost);
+}
+
 void AalImageCaptureControl::shutter()
 {
+    // The click would end up in the soundtrack of the video being recorded
     bool playShutterSound = m_settings.value("playShutterSound", true).toBool();
-    if (playShutterSound) {
+    if (playShutterSound && !m_service->isRecording()) {
         m_audioPlayer->play();
     }
     Q_EMIT imageExposed(m_lastRequestId);
 }
 
+/*!
+ * \brief AalImageCaptureControl::restoreZoom sets the viewfinder back to the
+ * zoom level it had before a picture was taken at zoom 1 to be cropped, so
+ * that it keeps showing what is being framed
+ */
+void AalImageCaptureControl::restoreZoom()
+{
+    if (m_restoreZoomLevel > 0 && m_service->androidControl()) {
+        HAL_TRACE(android_camera_set_zoom, m_service->androidControl(), m_restoreZoomLevel);
+    }
+    m_restoreZoomLevel = 0;
+}
+
 void AalImageCaptureControl::saveJpeg(const QByteArray& data)
 {
+    restoreZoom();
+
     if (m_captureCancelled) {
         m_captureCancelled = false;
         return;
     }
 
-    // Copy the metadata so that we can clear its container
-    QVariantMap metadata;
-    AalMetaDataWriterControl* metadataControl = m_service->metadataWriterControl();
-    Q_FOREACH(QString key, metadataControl->availableMetaData()) {
-        metadata.insert(key, metadataControl->metaData(key));
+    QVariantMap metadata = takeMetadata();
+    if (m_exifRotation != 0) {
+        metadata.insert("Orientation", m_exifRotation);
     }
-    m_service->metadataWriterControl()->clearAllMetaData();
 
     QString fileName = m_targetFileName;
     m_targetFileName.clear();
@@ -170,18 +374,133 @@ void AalImageCaptureControl::saveJpeg(const QByteArray& data)
     AalViewfinderSettingsControl* viewfinder = m_service->viewfinderControl();
     QSize resolution = viewfinder->viewfinderParameter(QCameraViewfinderSettingsControl::Resolution).toSize();
 
-    // Restart the viewfinder and notify that the camera is ready to capture again
-    if (m_service->androidControl()) {
-        android_camera_start_preview(m_service->androidControl());
+    // Restart the viewfinder and notify that the camera is ready to capture again.
+    // A video snapshot leaves the preview running, restarting it would break the recording
+    if (m_service->androidControl() && !m_service->isRecording()) {
+        HAL_TRACE(android_camera_start_preview, m_service->androidControl());
+    }
+
+    // Only rewrite the EXIF data if the HAL can't be trusted to get it right,
+    // or if the orientation has to be added or the size changes with a crop
+    qreal cropZoom = m_cropZoom;
+    bool updateMetadata = !m_halWritesMetadata || m_exifRotation != 0 || cropZoom > 1.0;
+    int requestId = m_lastRequestId;
+    if (m_rotateAfterSaving && m_exifRotation != 0) {
+        m_pendingRotations.insert(requestId);
+    }
+
+    // The name is picked here, the file name generator isn't thread safe
+    QString captureFile = m_storageManager.captureFileName(fileName);
+
+    // Past the memory budget the JPEG is parked in its destination directory
+    // by the worker and saved from there. A crop needs it in memory, so it is
+    // kept there. Only the accounting is done here.
+    qint64 memory = m_storageManager.captureMemoryCost(data.size(), resolution, updateMetadata, false);
+    m_spilledCaptureCost = m_storageManager.captureMemoryCost(data.size(), resolution, updateMetadata, true);
+    bool spill = false;
+    if (!m_storageManager.reserveCaptureMemory(memory)) {
+        spill = cropZoom <= 1.0;
+        if (spill) {
+            memory = m_spilledCaptureCost;
+        }
+        m_storageManager.reserveCaptureMemory(memory, true);
+    }
+    m_service->updateCaptureReady();
+
+    QFuture<SaveToDiskResult> future;
+    if (spill) {
+        QByteArray jpeg = data;
+        future = QtConcurrent::run([=]() mutable -> SaveToDiskResult {
+            QString spillFile = m_storageManager.spillJpegImage(jpeg, captureFile);
+            if (spillFile.isEmpty()) {
+                return m_storageManager.saveJpegImage(jpeg, metadata, captureFile, resolution,
+                                                      requestId, updateMetadata);
+            }
+            // Only the spilled file is held on to from here on
+            jpeg = QByteArray();
+            return m_storageManager.saveSpilledJpegImage(spillFile, metadata, captureFile,
+                                                         resolution, requestId, updateMetadata);
+        });
+    } else {
+        future = QtConcurrent::run([=]() {
+            QByteArray jpeg = cropZoom > 1.0 ? m_storageManager.cropLossless(data, cropZoom) : data;
+            return m_storageManager.saveJpegImage(jpeg, metadata, captureFile, resolution,
+                                                  requestId, updateMetadata);
+        });
+    }
+    watchSaveOperation(future, memory);
+}
+
+/*!
+ * \brief AalImageCaptureControl::onPreviewReady saves the viewfinder frame
+ * requested by capture() while recording. Encoding runs on a worker thread so
+ * that neither the recorder nor the viewfinder are held up
+ */
+void AalImageCaptureControl::onPreviewReady()
+{
+    if (!m_previewCapturePending)
+        return;
+    m_previewCapturePending = false;
+
+    if (m_captureCancelled) {
+        m_captureCancelled = false;
+        return;
     }
+
+    Q_EMIT imageExposed(m_lastRequestId);
+
+    QVariantMap metadata = takeMetadata();
+
+    QString fileName = m_targetFileName;
+    m_targetFileName.clear();
+
+    AalViewfinderSettingsControl* viewfinder = m_service->viewfinderControl();
+    QSize resolution = viewfinder->viewfinderParameter(QCameraViewfinderSettingsControl::Resolution).toSize();
+    int quality = m_service->imageEncoderControl()->jpegQuality();
+
     m_service->updateCaptureReady();
 
+    QImage image = m_service->videoOutputControl()->preview();
+    int rotation = m_previewCaptureRotation;
+    int requestId = m_lastRequestId;
+
+    // The frame is in memory already, it is only accounted for. Its JPEG is
+    // taken to be no bigger than the frame itself
+    qint64 memory = image.byteCount() +
+            m_storageManager.captureMemoryCost(image.byteCount(), resolution, true, false);
+    m_storageManager.reserveCaptureMemory(memory, true);
+
+    QString captureFile = m_storageManager.captureFileName(fileName);
+    QFuture<SaveToDiskResult> future = QtConcurrent::run([=]() {
+        return m_storageManager.saveImage(image, rotation, quality, metadata,
+                                          captureFile, resolution, requestId);
+    });
+    watchSaveOperation(future, memory);
+}
+
+/*!
+ * \brief AalImageCaptureControl::takeMetadata returns a copy of the metadata
+ * to write into the next picture and clears it from the metadata control. The
+ * orientation is left out, it is the one the picture was taken in.
+ */
+QVariantMap AalImageCaptureControl::takeMetadata()
+{
+    QVariantMap metadata;
+    AalMetaDataWriterControl* metadataControl = m_service->metadataWriterControl();
+    Q_FOREACH(QString key, metadataControl->availableMetaData()) {
+        metadata.insert(key, metadataControl->metaData(key));
+    }
+    metadata.remove("Orientation");
+    metadataControl->clearAllMetaData();
+    return metadata;
+}
+
+void AalImageCaptureControl::watchSaveOperation(const QFuture<SaveToDiskResult> &future, qint64 memory)
+{
     DiskWriteWatcher* watcher = new DiskWriteWatcher(this);
     QObject::connect(watcher, &QFutureWatcher<QString>::finished, this, &AalImageCaptureControl::onImageFileSaved);
     m_pendingSaveOperations.insert(watcher, m_lastRequestId);
-
-    QFuture<SaveToDiskResult> future = QtConcurrent::run(&m_storageManager, &StorageManager::saveJpegImage,
-                                                         data, metadata, fileName, resolution, m_lastRequestId);
+    m_reservedMemory.insert(watcher, memory);
     watcher->setFuture(future);
 }
 
@@ -191,12 +510,18 @@ void AalImageCaptureControl::onImageFileSaved()
 
     if (m_pendingSaveOperations.contains(watcher)) {
         int requestID = m_pendingSaveOperations.take(watcher);
+        m_storageManager.releaseCaptureMemory(m_reservedMemory.take(watcher));
 
         SaveToDiskResult result = watcher->result();
         delete watcher;
+        m_service->updateCaptureReady();
 
+        bool rotate = m_pendingRotations.remove(requestID);
         if (result.success) {
             Q_EMIT imageSaved(requestID, result.fileName);
+            if (rotate) {
+                m_storageManager.normalizeOrientation(result.fileName, requestID);
+            }
         } else {
             Q_EMIT error(requestID, QCameraImageCapture::ResourceError, result.errorMessage);
         }
@@ -21,6 +21,7 @@
 #include <QSettings>
 #include <QString>
 #include <QFutureWatcher>
+#include <QSet>
 #include <storagemanager.h>
 
 #include <stdint.h>
@@ -54,6 +55,12 @@ public:
     void setReady(bool ready);
 
     bool isCaptureRunning() const;
+    bool isCaptureMemoryExhausted() const;
+    void restoreZoom();
+
+Q_SIGNALS:
+    /// The saved picture fileName was turned upright losslessly
+    void imageNormalized(int id, const QString &fileName);
 
 public Q_SLOTS:
     void init(CameraControl *control, CameraControlListener *listener);
@@ -62,9 +69,19 @@ public Q_SLOTS:
 private Q_SLOTS:
     void shutter();
     void saveJpeg(const QByteArray& data);
+    void onPreviewReady();
 
 private:
     bool updateJpegMetadata(void* data, uint32_t dataSize, QTemporaryFile* destination);
+    bool isVideoSnapshotSupported() const;
+    bool isHalExifTrusted() const;
+    bool isExifOrientationUsed() const;
+    bool isLosslessRotationUsed() const;
+    bool isLosslessZoomUsed() const;
+    qreal digitalZoomRatio() const;
+    void setHalLocation();
+    QVariantMap takeMetadata();
+    void watchSaveOperation(const QFuture<SaveToDiskResult> &future, qint64 memory);
 
     AalCameraService *m_service;
     AalCameraControl *m_cameraControl;
@@ -73,6 +90,21 @@ private:
     bool m_ready;
     QString m_targetFileName;
     bool m_captureCancelled;
+    /// The HAL writes the EXIF data of the picture being taken
+    bool m_halWritesMetadata;
+    /// The rotation of the picture being taken left to the EXIF Orientation
+    int m_exifRotation;
+    /// The picture being taken is turned upright after it was saved
+    bool m_rotateAfterSaving;
+    /// The captures to turn upright once they are saved
+    QSet<int> m_pendingRotations;
+    /// The magnification cut out of the picture being taken at zoom 1
+    qreal m_cropZoom;
+    /// The HAL zoom level to restore for the viewfinder after the picture
+    int m_restoreZoomLevel;
+    /// A picture is being taken from the viewfinder while recording a video
+    bool m_previewCapturePending;
+    int m_previewCaptureRotation;
     float m_screenAspectRatio;
     /// Maintains a list of highest priority aspect ratio to lowest, for the
     /// currently selected camera
@@ -82,6 +114,12 @@ private:
     QSettings m_settings;
 
     QMap<DiskWriteWatcher*, int> m_pendingSaveOperations;
+    /// The capture memory reserved for each save operation
+    QMap<DiskWriteWatcher*, qint64> m_reservedMemory;
+    /// The capture memory the last picture would take once spilled
+    qint64 m_spilledCaptureCost;
+
+    friend class AalCameraService;
 };
 
 #endif
@@ -20,6 +20,7 @@
 #include "aalvideoencodersettingscontrol.h"
 #include "aalimagecapturecontrol.h"
 #include "aalcameraservice.h"
+#include "haltrace.h"
 
 #include <hybris/camera/camera_compatibility_layer_capabilities.h>
 
@@ -58,7 +59,7 @@ void AalImageEncoderControl::setImageSettings(const QImageEncoderSettings &setti
         m_encoderSettings.setQuality(settings.quality());
         if (m_service->androidControl()) {
             int jpegQuality = qtEncodingQualityToJpegQuality(settings.quality());
-            android_camera_set_jpeg_quality(m_service->androidControl(), jpegQuality);
+            HAL_TRACE(android_camera_set_jpeg_quality, m_service->androidControl(), jpegQuality);
         }
 
         // codec
@@ -104,17 +105,26 @@ float AalImageEncoderControl::getAspectRatio() const
     return (float)m_currentSize.width() / (float)m_currentSize.height();
 }
 
+/*!
+ * \brief AalImageEncoderControl::jpegQuality returns the JPEG quality (0-100)
+ * matching the current encoding quality setting
+ */
+int AalImageEncoderControl::jpegQuality() const
+{
+    return qtEncodingQualityToJpegQuality(m_encoderSettings.quality());
+}
+
 void AalImageEncoderControl::init(CameraControl *control)
 {
     Q_ASSERT(control != NULL);
 
     if (m_availableSizes.isEmpty()) {
-        android_camera_enumerate_supported_picture_sizes(control, &AalImageEncoderControl::getPictureSizeCb, this);
-        android_camera_enumerate_supported_thumbnail_sizes(control, &AalImageEncoderControl::getThumbnailSizeCb, this);
+        HAL_TRACE(android_camera_enumerate_supported_picture_sizes, control, &AalImageEncoderControl::getPictureSizeCb, this);
+        HAL_TRACE(android_camera_enumerate_supported_thumbnail_sizes, control, &AalImageEncoderControl::getThumbnailSizeCb, this);
     }
 
     int jpegQuality;
-    android_camera_get_jpeg_quality(control, &jpegQuality);
+    HAL_TRACE(android_camera_get_jpeg_quality, control, &jpegQuality);
     m_encoderSettings.setQuality(jpegQualityToQtEncodingQuality(jpegQuality));
 
     if (m_availableSizes.empty()) {
@@ -192,8 +202,8 @@ bool AalImageEncoderControl::setSize(const QSize &size)
         qWarning() << "(AalImageEncoderControl::setSize) ** Image and thumbnail aspect ratios are different. Thumbnails will look wrong!";
     }
 
-    android_camera_set_picture_size(cc, m_currentSize.width(), m_currentSize.height());
-    android_camera_set_thumbnail_size(cc, m_currentThumbnailSize.width(), m_currentThumbnailSize.height());
+    HAL_TRACE(android_camera_set_picture_size, cc, m_currentSize.width(), m_currentSize.height());
+    HAL_TRACE(android_camera_set_thumbnail_size, cc, m_currentThumbnailSize.width(), m_currentThumbnailSize.height());
     return true;
 }
 
@@ -214,12 +224,13 @@ void AalImageEncoderControl::enablePhotoMode()
     if (!cc || !m_currentSize.isValid()) {
         return;
     }
-    android_camera_set_picture_size(cc, m_currentSize.width(), m_currentSize.height());
-    android_camera_set_thumbnail_size(cc, m_currentThumbnailSize.width(), m_currentThumbnailSize.height());
+    HAL_TRACE(android_camera_set_picture_size, cc, m_currentSize.width(), m_currentSize.height());
+    HAL_TRACE(android_camera_set_thumbnail_size, cc, m_currentThumbnailSize.width(), m_currentThumbnailSize.height());
 }
 
 void AalImageEncoderControl::getPictureSizeCb(void *ctx, int width, int height)
 {
+    halRecordCallback("size_callback", width, height);
     if (ctx != NULL)
     {
         AalImageEncoderControl *self = static_cast<AalImageEncoderControl *>(ctx);
@@ -231,6 +242,7 @@ void AalImageEncoderControl::getPictureSizeCb(void *ctx, int width, int height)
 
 void AalImageEncoderControl::getThumbnailSizeCb(void *ctx, int width, int height)
 {
+    halRecordCallback("size_callback", width, height);
     if (ctx != NULL)
     {
         AalImageEncoderControl *self = static_cast<AalImageEncoderControl *>(ctx);
@@ -268,7 +280,7 @@ QMultimedia::EncodingQuality AalImageEncoderControl::jpegQualityToQtEncodingQual
     return quality;
 }
 
-int AalImageEncoderControl::qtEncodingQualityToJpegQuality(QMultimedia::EncodingQuality quality)
+int AalImageEncoderControl::qtEncodingQualityToJpegQuality(QMultimedia::EncodingQuality quality) const
 {
     int jpegQuality = 100;
     switch (quality) {
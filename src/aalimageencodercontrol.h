@@ -38,6 +38,7 @@ public:
     QList<QSize> supportedResolutions(const QImageEncoderSettings &settings, bool *continuous = 0) const;
     QList<QSize> supportedThumbnailResolutions(const QImageEncoderSettings &settings, bool *continuous = 0) const;
     float getAspectRatio() const;
+    int jpegQuality() const;
 
     void init(CameraControl *control);
     void resetAllSettings();
@@ -59,7 +60,7 @@ private:
     void getPictureSize(int width, int height);
     void getThumbnailSize(int width, int height);
     QMultimedia::EncodingQuality jpegQualityToQtEncodingQuality(int jpegQuality);
-    int qtEncodingQualityToJpegQuality(QMultimedia::EncodingQuality quality);
+    int qtEncodingQualityToJpegQuality(QMultimedia::EncodingQuality quality) const;
 };
 
 #endif
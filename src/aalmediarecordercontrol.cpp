@@ -15,11 +15,16 @@
  */
 
 #include "aalmediarecordercontrol.h"
+#include "aalaudioencodersettingscontrol.h"
 #include "aalcameraservice.h"
 #include "aalmetadatawritercontrol.h"
 #include "aalvideoencodersettingscontrol.h"
 #include "aalviewfindersettingscontrol.h"
 #include "audiocapture.h"
+#include "bitratepolicy.h"
+#include "haleventqueue.h"
+#include "haltrace.h"
+#include "replaybuffer.h"
 #include "storagemanager.h"
 #include "rotationhandler.h"
 
@@ -34,15 +39,27 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/statvfs.h>
 #include <fcntl.h>
 #include <errno.h>
 
+extern "C" {
+// Only newer media compatibility layers can pause, check for them at runtime
+int android_recorder_pause(MediaRecorderWrapper *mr) __attribute__((weak));
+int android_recorder_resume(MediaRecorderWrapper *mr) __attribute__((weak));
+}
+
 const int AalMediaRecorderControl::RECORDER_GENERAL_ERROR;
 const int AalMediaRecorderControl::RECORDER_NOT_AVAILABLE_ERROR;
 const int AalMediaRecorderControl::RECORDER_INITIALIZATION_ERROR;
+const int AalMediaRecorderControl::RECORDER_STORAGE_FULL_ERROR;
 
 const int AalMediaRecorderControl::DURATION_UPDATE_INTERVAL;
 
+const qint64 AalMediaRecorderControl::DEFAULT_EXPECTED_DURATION;
+const qint64 AalMediaRecorderControl::DEFAULT_STORAGE_RESERVE;
+const qint64 AalMediaRecorderControl::PREALLOCATION_CHUNK_SIZE;
+
 const QLatin1String AalMediaRecorderControl::PARAM_AUDIO_BITRATE = QLatin1String("audio-param-encoding-bitrate");
 const QLatin1String AalMediaRecorderControl::PARAM_AUDIO_CHANNELS = QLatin1String("audio-param-number-of-channels");
 const QLatin1String AalMediaRecorderControl::PARAM_AUTIO_SAMPLING = QLatin1String("audio-param-sampling-rate");
@@ -62,10 +79,31 @@ AalMediaRecorderControl::AalMediaRecorderControl(AalCameraService *service, QObj
     m_audioCapture(0),
     m_outfd(-1),
     m_duration(0),
+    m_recordedDuration(0),
+    m_lastStatisticsUpdate(0),
+    m_expectedDuration(DEFAULT_EXPECTED_DURATION),
+    m_storageReserve(DEFAULT_STORAGE_RESERVE),
+    m_preallocationEnabled(true),
+    m_preallocatedSize(0),
+    m_droppedSize(0),
+    m_writebackSize(0),
+    m_segmentDuration(0),
+    m_segmentSize(0),
+    m_segmentStorageBudget(0),
+    m_segmentIndex(0),
+    m_segmentTimer(0),
+    m_segmentRemaining(-1),
+    m_replayWindow(0),
+    m_replayBuffer(0),
     m_currentState(QMediaRecorder::StoppedState),
     m_currentStatus(QMediaRecorder::UnloadedStatus),
     m_recordingTimer(0),
-    m_audioCaptureAvailable(false)
+    m_audioCaptureAvailable(false),
+    m_audioSyncCorrection(true),
+    m_audioSyncTolerance(AudioCapture::DEFAULT_SYNC_TOLERANCE / 1000),
+    m_audioLevelMetering(false),
+    m_audioLevelTimer(0),
+    m_audioLevelSilent(true)
 {
 }
 
@@ -75,6 +113,8 @@ AalMediaRecorderControl::AalMediaRecorderControl(AalCameraService *service, QObj
 AalMediaRecorderControl::~AalMediaRecorderControl()
 {
     delete m_recordingTimer;
+    delete m_segmentTimer;
+    delete m_audioLevelTimer;
     if (m_outfd != -1)
     {
         int err = close(m_outfd);
@@ -83,8 +123,7 @@ AalMediaRecorderControl::~AalMediaRecorderControl()
                 << errno << ")";
     }
     deleteRecorder();
-    m_audioCaptureThread.quit();
-    m_audioCaptureThread.wait();
+    releaseAudioCapture();
 }
 
 /*!
@@ -163,7 +202,7 @@ qreal AalMediaRecorderControl::volume() const
 void AalMediaRecorderControl::startAudioCaptureThread()
 {
     qDebug() << "Starting microphone reader/writer thread";
-    // Start the microphone read/write thread
+    // The thread normally runs since video mode was entered
     m_audioCaptureThread.start();
     Q_EMIT audioCaptureThreadStarted();
 }
@@ -182,19 +221,10 @@ bool AalMediaRecorderControl::initRecorder()
             return false;
         }
 
-        int audioInitError = initAudioCapture();
-        if (audioInitError == 0) {
-            m_audioCaptureAvailable = true;
-        } else {
-            m_audioCaptureAvailable = false;
-            if (audioInitError == AudioCapture::AUDIO_CAPTURE_TIMEOUT_ERROR) {
-                deleteRecorder();
-                return false;
-            }
-        }
+        m_audioCaptureAvailable = attachAudioCapture();
 
-        android_recorder_set_error_cb(m_mediaRecorder, &AalMediaRecorderControl::errorCB, this);
-        android_camera_unlock(m_service->androidControl());
+        HAL_TRACE(android_recorder_set_error_cb, m_mediaRecorder, &AalMediaRecorderControl::errorCB, this);
+        HAL_TRACE(android_camera_unlock, m_service->androidControl());
     }
 
     return true;
@@ -206,46 +236,57 @@ bool AalMediaRecorderControl::initRecorder()
  */
 void AalMediaRecorderControl::deleteRecorder()
 {
-    deleteAudioCapture();
+    if (m_audioCapture != 0) {
+        m_audioCapture->stopCapture();
+        m_audioCapture->detach();
+    }
+    m_audioCaptureAvailable = false;
 
     if (m_mediaRecorder == 0)
         return;
 
-    android_recorder_release(m_mediaRecorder);
+    HAL_TRACE(android_recorder_release, m_mediaRecorder);
     m_mediaRecorder = 0;
-    android_camera_lock(m_service->androidControl());
+    HAL_TRACE(android_camera_lock, m_service->androidControl());
     setStatus(QMediaRecorder::UnloadedStatus);
 }
 
-int AalMediaRecorderControl::initAudioCapture()
+/*!
+ * \brief AalMediaRecorderControl::prepareAudioCapture connects to the
+ * microphone in the background when entering video mode. The stream then
+ * stays connected, and corked, between recordings.
+ */
+void AalMediaRecorderControl::prepareAudioCapture()
 {
-    // setting up audio recording; m_audioCapture is executed within the m_workerThread affinity
-    m_audioCapture = new AudioCapture(m_mediaRecorder);
-    int audioInitError = m_audioCapture->setupMicrophoneStream();
-    if (audioInitError != 0)
-    {
-        qWarning() << "Failed to setup PulseAudio microphone recording stream";
-        delete m_audioCapture;
-        m_audioCapture = 0;
-    } else {
-        m_audioCapture->moveToThread(&m_audioCaptureThread);
+    if (m_audioCapture != 0)
+        return;
 
-        // startWorkerThread signal comes from an Android layer callback that resides down in
-        // the AudioRecordHybris class
-        connect(this, SIGNAL(audioCaptureThreadStarted()), m_audioCapture, SLOT(run()));
+    // m_audioCapture is executed within the m_audioCaptureThread affinity
+    m_audioCapture = new AudioCapture();
+    m_audioCapture->setSyncCorrection(m_audioSyncCorrection);
+    m_audioCapture->setSyncTolerance(m_audioSyncTolerance * 1000);
+    m_audioCapture->setLevelMetering(m_audioLevelMetering);
+    m_audioCapture->moveToThread(&m_audioCaptureThread);
 
-        // Call recorderReadAudioCallback when the reader side of the named pipe has been setup
-        m_audioCapture->init(&AalMediaRecorderControl::recorderReadAudioCallback, this);
-    }
-    return audioInitError;
+    // startWorkerThread signal comes from an Android layer callback that resides down in
+    // the AudioRecordHybris class
+    connect(this, SIGNAL(audioCaptureThreadStarted()), m_audioCapture, SLOT(run()));
+
+    m_audioCaptureThread.start();
+    QMetaObject::invokeMethod(m_audioCapture, "connectStream", Qt::QueuedConnection);
 }
 
-void AalMediaRecorderControl::deleteAudioCapture()
+/*!
+ * \brief AalMediaRecorderControl::releaseAudioCapture disconnects from the
+ * microphone when leaving video mode
+ */
+void AalMediaRecorderControl::releaseAudioCapture()
 {
     if (m_audioCapture == 0)
         return;
 
     m_audioCapture->stopCapture();
+    m_audioCapture->detach();
     m_audioCaptureThread.quit();
     m_audioCaptureThread.wait();
 
@@ -254,15 +295,169 @@ void AalMediaRecorderControl::deleteAudioCapture()
     m_audioCaptureAvailable = false;
 }
 
+/*!
+ * \brief AalMediaRecorderControl::attachAudioCapture hands the microphone
+ * stream to the recorder for the next recording
+ * \return false if the stream isn't connected, the recording then has no audio
+ */
+bool AalMediaRecorderControl::attachAudioCapture()
+{
+    prepareAudioCapture();
+    if (!m_audioCapture->isStreamReady()) {
+        // Still connecting, or reconnecting in the background
+        qWarning() << "Microphone stream not connected, recording without audio";
+        return false;
+    }
+
+    // Call recorderReadAudioCallback when the reader side of the named pipe has been setup
+    m_audioCapture->init(m_mediaRecorder, &AalMediaRecorderControl::recorderReadAudioCallback, this);
+    return true;
+}
+
+/*!
+ * \brief AalMediaRecorderControl::audioSyncCorrection returns true if the
+ * microphone data is kept in sync with the recording clock, by inserting
+ * silence or dropping audio when it drifts beyond audioSyncTolerance()
+ */
+bool AalMediaRecorderControl::audioSyncCorrection() const
+{
+    return m_audioSyncCorrection;
+}
+
+void AalMediaRecorderControl::setAudioSyncCorrection(bool enabled)
+{
+    m_audioSyncCorrection = enabled;
+    if (m_audioCapture != 0)
+        m_audioCapture->setSyncCorrection(enabled);
+}
+
+/*!
+ * \brief AalMediaRecorderControl::audioSyncTolerance returns how far, in
+ * milliseconds, the audio may drift from the recording clock before it is
+ * corrected
+ */
+qint64 AalMediaRecorderControl::audioSyncTolerance() const
+{
+    return m_audioSyncTolerance;
+}
+
+void AalMediaRecorderControl::setAudioSyncTolerance(qint64 tolerance)
+{
+    m_audioSyncTolerance = qMax(tolerance, qint64(0));
+    if (m_audioCapture != 0)
+        m_audioCapture->setSyncTolerance(m_audioSyncTolerance * 1000);
+}
+
+/*!
+ * \brief AalMediaRecorderControl::audioSyncStatistics returns the drift and
+ * corrections of the audio in the current recording, or of the last one when
+ * not recording
+ */
+AudioSyncStatistics AalMediaRecorderControl::audioSyncStatistics() const
+{
+    if (m_audioCapture != 0 && m_currentState != QMediaRecorder::StoppedState)
+        return m_audioCapture->syncStatistics();
+    return m_audioSyncStatistics;
+}
+
+/*!
+ * \brief AalMediaRecorderControl::audioLevelMetering returns true if the level
+ * of the microphone is measured while recording, for a live level display.
+ * audioLevelChanged() is then emitted at most every AUDIO_LEVEL_UPDATE_INTERVAL
+ * milliseconds.
+ */
+bool AalMediaRecorderControl::audioLevelMetering() const
+{
+    return m_audioLevelMetering;
+}
+
+void AalMediaRecorderControl::setAudioLevelMetering(bool enabled)
+{
+    if (m_audioLevelMetering == enabled)
+        return;
+
+    m_audioLevelMetering = enabled;
+    if (m_audioCapture != 0)
+        m_audioCapture->setLevelMetering(enabled);
+    updateAudioLevelTimer();
+}
+
+/*!
+ * \brief AalMediaRecorderControl::audioChannelCount returns the number of
+ * microphone channels audioLevel() can be asked about
+ */
+int AalMediaRecorderControl::audioChannelCount() const
+{
+    if (m_audioCapture == 0)
+        return 0;
+    return m_audioCapture->channelCount();
+}
+
+/*!
+ * \brief AalMediaRecorderControl::audioLevel returns the latest level of
+ * microphone \p channel, or silence when not recording or metering is off
+ */
+AudioLevel AalMediaRecorderControl::audioLevel(int channel) const
+{
+    if (m_audioCapture == 0 || !m_audioLevelMetering ||
+            m_currentState != QMediaRecorder::RecordingState || !m_audioCaptureAvailable)
+        return AudioLevel();
+    return m_audioCapture->level(channel);
+}
+
+/*!
+ * \brief AalMediaRecorderControl::updateAudioLevel notifies about the latest
+ * microphone level. Silence is only reported once, so an idle meter doesn't
+ * keep waking up the UI.
+ */
+void AalMediaRecorderControl::updateAudioLevel()
+{
+    bool silent = true;
+    for (int c = 0; c < audioChannelCount() && silent; ++c) {
+        const AudioLevel level = audioLevel(c);
+        silent = level.peak == 0 && level.rms == 0;
+    }
+
+    if (silent && m_audioLevelSilent)
+        return;
+    m_audioLevelSilent = silent;
+    Q_EMIT audioLevelChanged();
+}
+
+/*!
+ * \brief AalMediaRecorderControl::updateAudioLevelTimer polls the microphone
+ * level only while recording with metering enabled, and lets the display
+ * drop to silence otherwise
+ */
+void AalMediaRecorderControl::updateAudioLevelTimer()
+{
+    const bool active = m_audioLevelMetering && m_currentState == QMediaRecorder::RecordingState;
+    if (!active) {
+        if (m_audioLevelTimer != 0)
+            m_audioLevelTimer->stop();
+        updateAudioLevel();
+        return;
+    }
+
+    if (m_audioLevelTimer == 0) {
+        m_audioLevelTimer = new QTimer(this);
+        m_audioLevelTimer->setInterval(AUDIO_LEVEL_UPDATE_INTERVAL);
+        QObject::connect(m_audioLevelTimer, SIGNAL(timeout()),
+                         this, SLOT(updateAudioLevel()));
+    }
+    m_audioLevelTimer->start();
+}
+
 /*!
  * \brief AalMediaRecorderControl::errorCB handles errors from the android layer
- * \param context
+ * \param context the AalMediaRecorderControl which registered the callback
  */
 void AalMediaRecorderControl::errorCB(void *context)
 {
-    Q_UNUSED(context);
-    QMetaObject::invokeMethod(AalCameraService::instance()->mediaRecorderControl(),
-                              "handleError", Qt::QueuedConnection);
+    HalTraceSpan span(Q_FUNC_INFO);
+    halRecordCallback("on_recorder_msg_error");
+    AalMediaRecorderControl *thiz = static_cast<AalMediaRecorderControl*>(context);
+    thiz->m_service->postHalEvent(new HalEvent(HalEvent::RecorderError));
 }
 
 MediaRecorderWrapper* AalMediaRecorderControl::mediaRecorder() const
@@ -275,6 +470,159 @@ AudioCapture *AalMediaRecorderControl::audioCapture() const
     return m_audioCapture;
 }
 
+/*!
+ * \brief AalMediaRecorderControl::statistics returns the throughput of the
+ * current recording, as sampled on the last duration update
+ */
+RecordingStatistics AalMediaRecorderControl::statistics() const
+{
+    return m_statistics;
+}
+
+/*!
+ * \brief AalMediaRecorderControl::expectedDuration returns how long recordings
+ * are expected to last, in milliseconds. Used to check for free space before
+ * starting a recording.
+ */
+qint64 AalMediaRecorderControl::expectedDuration() const
+{
+    return m_expectedDuration;
+}
+
+void AalMediaRecorderControl::setExpectedDuration(qint64 duration)
+{
+    m_expectedDuration = qMax(qint64(0), duration);
+}
+
+/*!
+ * \brief AalMediaRecorderControl::storageReserve returns the amount of space
+ * that is kept free on the output filesystem, in bytes. A recording is stopped
+ * cleanly when the free space drops below it.
+ */
+qint64 AalMediaRecorderControl::storageReserve() const
+{
+    return m_storageReserve;
+}
+
+void AalMediaRecorderControl::setStorageReserve(qint64 bytes)
+{
+    m_storageReserve = qMax(qint64(0), bytes);
+}
+
+/*!
+ * \brief AalMediaRecorderControl::isPreallocationEnabled returns true if the
+ * output file is allocated on disk ahead of the muxer, in chunks of
+ * PREALLOCATION_CHUNK_SIZE
+ */
+bool AalMediaRecorderControl::isPreallocationEnabled() const
+{
+    return m_preallocationEnabled;
+}
+
+void AalMediaRecorderControl::setPreallocationEnabled(bool enabled)
+{
+    m_preallocationEnabled = enabled;
+}
+
+/*!
+ * \brief AalMediaRecorderControl::segmentDuration returns after how many
+ * milliseconds a recording rolls over to a new file, or 0 if it doesn't
+ */
+qint64 AalMediaRecorderControl::segmentDuration() const
+{
+    return m_segmentDuration;
+}
+
+void AalMediaRecorderControl::setSegmentDuration(qint64 duration)
+{
+    m_segmentDuration = qMax(qint64(0), duration);
+}
+
+/*!
+ * \brief AalMediaRecorderControl::segmentSize returns after how many bytes a
+ * recording rolls over to a new file, or 0 if it doesn't
+ */
+qint64 AalMediaRecorderControl::segmentSize() const
+{
+    return m_segmentSize;
+}
+
+void AalMediaRecorderControl::setSegmentSize(qint64 bytes)
+{
+    m_segmentSize = qMax(qint64(0), bytes);
+}
+
+/*!
+ * \brief AalMediaRecorderControl::segmentStorageBudget returns how much space
+ * the segments of a recording may take. The oldest segments are deleted to stay
+ * within it. 0 means the segments are never deleted.
+ */
+qint64 AalMediaRecorderControl::segmentStorageBudget() const
+{
+    return m_segmentStorageBudget;
+}
+
+void AalMediaRecorderControl::setSegmentStorageBudget(qint64 bytes)
+{
+    m_segmentStorageBudget = qMax(qint64(0), bytes);
+}
+
+/*!
+ * \brief AalMediaRecorderControl::isSegmented returns true if the next
+ * recording will be split in several files
+ */
+bool AalMediaRecorderControl::isSegmented() const
+{
+    return m_segmentDuration > 0 || m_segmentSize > 0;
+}
+
+/*!
+ * \brief AalMediaRecorderControl::replayWindow returns how many milliseconds
+ * of the recording are kept in memory for saveReplay(), or 0 if the recording
+ * is written to a file
+ */
+qint64 AalMediaRecorderControl::replayWindow() const
+{
+    return m_replayWindow;
+}
+
+/*!
+ * \brief AalMediaRecorderControl::setReplayWindow makes the next recordings
+ * be kept in memory only, for the given number of milliseconds. Nothing is
+ * written to disk until saveReplay() is called.
+ */
+void AalMediaRecorderControl::setReplayWindow(qint64 window)
+{
+    m_replayWindow = qMax(qint64(0), window);
+}
+
+/*!
+ * \brief AalMediaRecorderControl::saveReplay writes the last duration
+ * milliseconds kept in memory to location as an MPEG-2 transport stream.
+ * replaySaved() is emitted once the file is complete.
+ * \param duration how much to save, the whole window if 0
+ * \return false if there is no replay to save
+ */
+bool AalMediaRecorderControl::saveReplay(const QUrl &location, qint64 duration)
+{
+    if (m_replayBuffer == 0) {
+        qWarning() << "No replay recording to save";
+        return false;
+    }
+
+    QString fileName = location.path();
+    QFileInfo fileInfo = QFileInfo(fileName);
+    if (fileName.isEmpty() || fileInfo.isDir()) {
+        fileInfo.setFile(m_service->storageManager()->nextVideoFileName(fileName));
+        fileName = QString("%1/%2.ts").arg(fileInfo.absolutePath()).arg(fileInfo.completeBaseName());
+    }
+
+    if (duration <= 0)
+        duration = m_replayBuffer->window();
+
+    return m_replayBuffer->saveReplay(fileName, duration);
+}
+
 /*!
  * \reimp
  */
@@ -294,7 +642,11 @@ void AalMediaRecorderControl::setState(QMediaRecorder::State state)
 
     switch (state) {
     case QMediaRecorder::RecordingState: {
-        startRecording();
+        if (m_currentState == QMediaRecorder::PausedState) {
+            resumeRecording();
+        } else {
+            startRecording();
+        }
         break;
     }
     case QMediaRecorder::StoppedState: {
@@ -302,7 +654,7 @@ void AalMediaRecorderControl::setState(QMediaRecorder::State state)
         break;
     }
     case QMediaRecorder::PausedState: {
-        qDebug() << Q_FUNC_INFO << " pause not used for video recording.";
+        pauseRecording();
         break;
     }
     }
@@ -317,10 +669,208 @@ void AalMediaRecorderControl::setVolume(qreal gain)
     qDebug() << Q_FUNC_INFO << " is not used";
 }
 
+/*!
+ * \brief AalMediaRecorderControl::updateDuration samples the monotonic clock
+ * started with the recorder, so late timer ticks don't make the duration drift
+ */
 void AalMediaRecorderControl::updateDuration()
 {
-    m_duration += DURATION_UPDATE_INTERVAL;
+    if (!m_recordingClock.isValid())
+        return;
+
+    m_duration = m_recordedDuration + m_recordingClock.elapsed();
     Q_EMIT durationChanged(m_duration);
+
+    updateStatistics();
+    if (!checkOutputStorage())
+        return;
+
+    if (!m_segmentBaseName.isEmpty() && m_segmentSize > 0 && m_statistics.bytesWritten >= m_segmentSize)
+        rolloverSegment();
+}
+
+/*!
+ * \brief AalMediaRecorderControl::updateStatistics measures how much has been
+ * written to the output file and how much room is left for it
+ */
+void AalMediaRecorderControl::updateStatistics()
+{
+    if (m_outfd < 0)
+        return;
+
+    if (m_replayBuffer != 0) {
+        // Nothing reaches the disk, only report what is held in memory
+        m_statistics.bytesWritten = m_replayBuffer->size();
+        m_statistics.bitRate = m_duration > 0 ? m_statistics.bytesWritten * 8 * 1000 / m_duration : 0;
+        Q_EMIT statisticsChanged();
+        return;
+    }
+
+    struct stat st;
+    if (fstat(m_outfd, &st) < 0) {
+        qWarning() << "Failed to stat recording output file (errno: " << errno << ")";
+        return;
+    }
+
+    const qint64 bytesWritten = st.st_size;
+    const qint64 interval = m_duration - m_lastStatisticsUpdate;
+    if (interval > 0) {
+        qint64 writeRate = (bytesWritten - m_statistics.bytesWritten) * 1000 / interval;
+        // The muxer writes in bursts, so smooth out the instantaneous rate
+        if (m_statistics.writeRate > 0)
+            writeRate = (3 * m_statistics.writeRate + writeRate) / 4;
+        m_statistics.writeRate = writeRate;
+    }
+    m_statistics.bytesWritten = bytesWritten;
+    m_statistics.bitRate = m_duration > 0 ? bytesWritten * 8 * 1000 / m_duration : 0;
+
+    struct statvfs vfs;
+    if (fstatvfs(m_outfd, &vfs) == 0) {
+        m_statistics.freeSpace = (qint64)vfs.f_bavail * (qint64)vfs.f_frsize;
+        // Space preallocated for the output is still available to it
+        if (m_preallocatedSize > bytesWritten)
+            m_statistics.freeSpace += m_preallocatedSize - bytesWritten;
+    }
+
+    if (m_statistics.writeRate > 0) {
+        m_statistics.timeUntilFull = m_statistics.freeSpace * 1000 / m_statistics.writeRate;
+    } else {
+        m_statistics.timeUntilFull = -1;
+    }
+
+    m_lastStatisticsUpdate = m_duration;
+    Q_EMIT statisticsChanged();
+}
+
+/*!
+ * \brief AalMediaRecorderControl::checkOutputStorage stops the recording
+ * cleanly when the free space drops below the reserve, and otherwise keeps the
+ * output file allocated ahead of the muxer
+ * \return false if the recording had to be stopped
+ */
+bool AalMediaRecorderControl::checkOutputStorage()
+{
+    if (m_outfd < 0 || m_replayBuffer != 0 || m_currentStatus != QMediaRecorder::RecordingStatus)
+        return true;
+
+    if (m_statistics.freeSpace < m_storageReserve) {
+        qWarning() << "Free space dropped below" << m_storageReserve << "bytes, stopping recording";
+        stopRecording();
+        Q_EMIT error(RECORDER_STORAGE_FULL_ERROR, "Storage is full, recording stopped");
+        return false;
+    }
+
+    preallocateOutput();
+    dropWrittenOutput();
+
+    return true;
+}
+
+/*!
+ * \brief AalMediaRecorderControl::dropWrittenOutput lets the recording data go
+ * from the page cache, as it is written once and never read back. The data
+ * written since the previous check starts being written back now, the data
+ * that started one check ago is waited for, which is normally done by then,
+ * and dropped once it is clean. Only the new ranges are touched, so the cost
+ * doesn't grow with the length of the recording.
+ */
+void AalMediaRecorderControl::dropWrittenOutput()
+{
+    const qint64 written = m_statistics.bytesWritten;
+    if (written < m_writebackSize)
+        return;
+
+    if (m_writebackSize > m_droppedSize) {
+        const qint64 length = m_writebackSize - m_droppedSize;
+        if (sync_file_range(m_outfd, m_droppedSize, length, SYNC_FILE_RANGE_WAIT_BEFORE |
+                            SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER) != 0) {
+            qWarning() << "Failed to write back recording data (errno: " << errno << ")";
+        } else if (posix_fadvise(m_outfd, m_droppedSize, length, POSIX_FADV_DONTNEED) != 0) {
+            qWarning() << "Failed to drop written recording data from the page cache";
+        } else {
+            m_droppedSize = m_writebackSize;
+        }
+    }
+
+    if (written > m_writebackSize) {
+        if (sync_file_range(m_outfd, m_writebackSize, written - m_writebackSize,
+                            SYNC_FILE_RANGE_WRITE) != 0) {
+            qWarning() << "Failed to start writing back recording data (errno: " << errno << ")";
+            return;
+        }
+        m_writebackSize = written;
+    }
+}
+
+/*!
+ * \brief AalMediaRecorderControl::hasSpaceForRecording checks that the
+ * filesystem holding fileName can hold a recording of the expected duration
+ * at the given bitrate, on top of the storage reserve
+ */
+bool AalMediaRecorderControl::hasSpaceForRecording(const QString &fileName, qint64 bitRate)
+{
+    QString directory = QFileInfo(fileName).absolutePath();
+    struct statvfs vfs;
+    if (statvfs(directory.toLocal8Bit().constData(), &vfs) != 0) {
+        qWarning() << "Failed to query free space of" << directory << "(errno: " << errno << ")";
+        // Don't block recording when the filesystem can't be queried
+        return true;
+    }
+
+    const qint64 freeSpace = (qint64)vfs.f_bavail * (qint64)vfs.f_frsize;
+    const qint64 required = bitRate / 8 * m_expectedDuration / 1000 + m_storageReserve;
+    if (freeSpace < required) {
+        qWarning() << "Not enough space for recording:" << freeSpace << "bytes free,"
+                   << required << "bytes needed";
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+ * \brief AalMediaRecorderControl::preallocateOutput makes sure that at least
+ * half a chunk is allocated on disk ahead of the muxer, so sustained writes
+ * don't have to look for free blocks on a fragmented filesystem
+ */
+void AalMediaRecorderControl::preallocateOutput()
+{
+    if (!m_preallocationEnabled || m_outfd < 0 || m_preallocatedSize < 0)
+        return;
+
+    if (m_statistics.bytesWritten + PREALLOCATION_CHUNK_SIZE / 2 < m_preallocatedSize)
+        return;
+
+    // Keep the file size as is, the muxer relies on it
+    if (fallocate(m_outfd, FALLOC_FL_KEEP_SIZE, m_preallocatedSize, PREALLOCATION_CHUNK_SIZE) < 0) {
+        if (errno == EOPNOTSUPP) {
+            qDebug() << "Output filesystem does not support preallocation";
+        } else {
+            qWarning() << "Failed to preallocate recording output (errno: " << errno << ")";
+        }
+        // Don't try again for this recording
+        m_preallocatedSize = -1;
+        return;
+    }
+
+    m_preallocatedSize += PREALLOCATION_CHUNK_SIZE;
+}
+
+/*!
+ * \brief AalMediaRecorderControl::releasePreallocation gives back to the
+ * filesystem the blocks that were preallocated beyond the end of the output
+ */
+void AalMediaRecorderControl::releasePreallocation()
+{
+    if (m_preallocatedSize <= 0 || m_outfd < 0)
+        return;
+
+    struct stat st;
+    if (fstat(m_outfd, &st) == 0 && st.st_size < m_preallocatedSize) {
+        if (ftruncate(m_outfd, st.st_size) < 0)
+            qWarning() << "Failed to release preallocated space (errno: " << errno << ")";
+    }
+    m_preallocatedSize = 0;
 }
 
 /*!
@@ -328,6 +878,11 @@ void AalMediaRecorderControl::updateDuration()
  */
 void AalMediaRecorderControl::handleError()
 {
+    // A full disk only shows up as a generic error from the recorder
+    updateStatistics();
+    if (!checkOutputStorage())
+        return;
+
     Q_EMIT error(RECORDER_GENERAL_ERROR, "Error on recording video");
 }
 
@@ -363,17 +918,89 @@ int AalMediaRecorderControl::startRecording()
     setStatus(QMediaRecorder::LoadingStatus);
 
     m_duration = 0;
+    m_recordedDuration = 0;
+    m_recordingClock.invalidate();
     Q_EMIT durationChanged(m_duration);
 
+    m_statistics = RecordingStatistics();
+    m_lastStatisticsUpdate = 0;
+
     if (!initRecorder()) {
         setStatus(QMediaRecorder::UnloadedStatus);
         return RECORDER_NOT_AVAILABLE_ERROR;
     }
 
+    m_segmentIndex = 0;
+    m_segmentBaseName.clear();
+    m_finishedSegments.clear();
+
+    // A replay recording is only written to disk by saveReplay()
+    QString fileName;
+    if (m_replayWindow == 0) {
+        fileName = m_outputLocation.path();
+        QFileInfo fileInfo = QFileInfo(fileName);
+        if (fileName.isEmpty()) {
+            fileName = m_service->storageManager()->nextVideoFileName();
+        } else if (fileInfo.isDir()) {
+            fileName = m_service->storageManager()->nextVideoFileName(fileName);
+        }
+
+        if (isSegmented()) {
+            m_segmentBaseName = fileName;
+            fileName = segmentFileName(m_segmentIndex);
+        }
+        Q_EMIT actualLocationChanged(QUrl(fileName));
+    }
+
+    int ret = startRecorder(fileName);
+    if (ret < 0)
+        return ret;
+    m_recordingClock.start();
+
+    m_currentState = QMediaRecorder::RecordingState;
+    Q_EMIT stateChanged(m_currentState);
+    updateAudioLevelTimer();
+
+    setStatus(QMediaRecorder::RecordingStatus);
+
+    if (m_recordingTimer == 0) {
+        m_recordingTimer = new QTimer(this);
+        m_recordingTimer->setInterval(DURATION_UPDATE_INTERVAL);
+        m_recordingTimer->setSingleShot(false);
+        QObject::connect(m_recordingTimer, SIGNAL(timeout()),
+                         this, SLOT(updateDuration()));
+    }
+    m_recordingTimer->start();
+
+    if (!m_segmentBaseName.isEmpty()) {
+        startSegmentTimer();
+        Q_EMIT segmentStarted(m_segmentIndex, QUrl::fromLocalFile(fileName));
+    }
+
+    return 0;
+}
+
+/*!
+ * \brief AalMediaRecorderControl::startRecorder configures the media recorder
+ * to write to fileName and starts it. If fileName is empty, the recording goes
+ * to a new replay buffer instead.
+ */
+int AalMediaRecorderControl::startRecorder(const QString &fileName)
+{
     QVideoEncoderSettings videoSettings = m_service->videoEncoderControl()->videoSettings();
+    QAudioEncoderSettings audioSettings = m_service->audioEncoderControl()->audioSettings();
+
+    // Keep the recording within what the storage can write
+    int videoBitRate = videoSettings.bitRate();
+    if (!fileName.isEmpty()) {
+        qint64 throughput = m_service->storageManager()->writeThroughput(QFileInfo(fileName).absolutePath());
+        videoBitRate = BitratePolicy::capVideoBitRate(videoBitRate, audioSettings.bitRate(), throughput);
+        if (videoBitRate < videoSettings.bitRate())
+            qWarning() << "Video bitrate lowered to" << videoBitRate << "for the storage throughput";
+    }
 
     int ret;
-    ret = android_recorder_setCamera(m_mediaRecorder, m_service->androidControl());
+    ret = HAL_TRACE(android_recorder_setCamera, m_mediaRecorder, m_service->androidControl());
     if (ret < 0) {
         deleteRecorder();
         Q_EMIT error(RECORDER_INITIALIZATION_ERROR, "android_recorder_setCamera() failed\n");
@@ -381,7 +1008,7 @@ int AalMediaRecorderControl::startRecording()
     }
     // state initial / idle
     if (m_audioCaptureAvailable) {
-        ret = android_recorder_setAudioSource(m_mediaRecorder, ANDROID_AUDIO_SOURCE_CAMCORDER);
+        ret = HAL_TRACE(android_recorder_setAudioSource, m_mediaRecorder, ANDROID_AUDIO_SOURCE_CAMCORDER);
         if (ret < 0) {
             deleteRecorder();
             Q_EMIT error(RECORDER_INITIALIZATION_ERROR, "android_recorder_setAudioSource() failed");
@@ -389,14 +1016,16 @@ int AalMediaRecorderControl::startRecording()
         }
 
     }
-    ret = android_recorder_setVideoSource(m_mediaRecorder, ANDROID_VIDEO_SOURCE_CAMERA);
+    ret = HAL_TRACE(android_recorder_setVideoSource, m_mediaRecorder, ANDROID_VIDEO_SOURCE_CAMERA);
     if (ret < 0) {
         deleteRecorder();
         Q_EMIT error(RECORDER_INITIALIZATION_ERROR, "android_recorder_setVideoSource() failed");
         return RECORDER_INITIALIZATION_ERROR;
     }
     // state initialized
-    ret = android_recorder_setOutputFormat(m_mediaRecorder, ANDROID_OUTPUT_FORMAT_MPEG_4);
+    // Only a transport stream can be cut at any point and still be played
+    ret = HAL_TRACE(android_recorder_setOutputFormat, m_mediaRecorder, fileName.isEmpty() ?
+            ANDROID_OUTPUT_FORMAT_MPEG2TS : ANDROID_OUTPUT_FORMAT_MPEG_4);
     if (ret < 0) {
         deleteRecorder();
         Q_EMIT error(RECORDER_INITIALIZATION_ERROR, "android_recorder_setOutputFormat() failed");
@@ -404,38 +1033,61 @@ int AalMediaRecorderControl::startRecording()
     }
     // state DataSourceConfigured
     if (m_audioCaptureAvailable) {
-        ret = android_recorder_setAudioEncoder(m_mediaRecorder, ANDROID_AUDIO_ENCODER_AAC);
+        ret = HAL_TRACE(android_recorder_setAudioEncoder, m_mediaRecorder, ANDROID_AUDIO_ENCODER_AAC);
         if (ret < 0) {
             deleteRecorder();
             Q_EMIT error(RECORDER_INITIALIZATION_ERROR, "android_recorder_setAudioEncoder() failed");
             return RECORDER_INITIALIZATION_ERROR;
         }
     }
-    // FIXME set codec from settings
-    ret = android_recorder_setVideoEncoder(m_mediaRecorder, ANDROID_VIDEO_ENCODER_H264);
+    // The transport stream muxer only takes H.264
+    VideoEncoder videoEncoder = fileName.isEmpty() ? ANDROID_VIDEO_ENCODER_H264 :
+            m_service->videoEncoderControl()->androidVideoEncoder();
+    ret = HAL_TRACE(android_recorder_setVideoEncoder, m_mediaRecorder, videoEncoder);
     if (ret < 0) {
         deleteRecorder();
         Q_EMIT error(RECORDER_INITIALIZATION_ERROR, "android_recorder_setVideoEncoder() failed");
         return RECORDER_INITIALIZATION_ERROR;
     }
 
-    QString fileName = m_outputLocation.path();
-    QFileInfo fileInfo = QFileInfo(fileName);
+    // The previous replay is dropped once a new recording starts
+    delete m_replayBuffer;
+    m_replayBuffer = 0;
+    m_statistics.bytesWritten = 0;
+    m_preallocatedSize = 0;
+    m_droppedSize = 0;
+    m_writebackSize = 0;
+
     if (fileName.isEmpty()) {
-        fileName = m_service->storageManager()->nextVideoFileName();
-    } else if (fileInfo.isDir()) {
-        fileName = m_service->storageManager()->nextVideoFileName(fileName);
-    }
-    Q_EMIT actualLocationChanged(QUrl(fileName));
+        m_replayBuffer = new ReplayBuffer(m_replayWindow, this);
+        QObject::connect(m_replayBuffer, SIGNAL(replaySaved(QString)),
+                         this, SLOT(handleReplaySaved(QString)));
+        QObject::connect(m_replayBuffer, SIGNAL(replayFailed(QString)),
+                         this, SLOT(handleReplayFailed(QString)));
+        m_outfd = m_replayBuffer->start();
+        if (m_outfd < 0) {
+            deleteRecorder();
+            Q_EMIT error(RECORDER_INITIALIZATION_ERROR, "Could not create replay buffer");
+            return RECORDER_INITIALIZATION_ERROR;
+        }
+    } else {
+        if (!hasSpaceForRecording(fileName, videoBitRate + audioSettings.bitRate())) {
+            deleteRecorder();
+            Q_EMIT error(RECORDER_STORAGE_FULL_ERROR, "Not enough free space for video recording");
+            return RECORDER_STORAGE_FULL_ERROR;
+        }
 
-    m_outfd = open(fileName.toLocal8Bit().data(), O_WRONLY | O_CREAT,
-              S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
-    if (m_outfd < 0) {
-        deleteRecorder();
-        Q_EMIT error(RECORDER_INITIALIZATION_ERROR, "Could not open file for video recording");
-        return RECORDER_INITIALIZATION_ERROR;
+        m_outfd = open(fileName.toLocal8Bit().data(), O_WRONLY | O_CREAT | O_TRUNC,
+                  S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+        if (m_outfd < 0) {
+            deleteRecorder();
+            Q_EMIT error(RECORDER_INITIALIZATION_ERROR, "Could not open file for video recording");
+            return RECORDER_INITIALIZATION_ERROR;
+        }
+        posix_fadvise(m_outfd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        preallocateOutput();
     }
-    ret = android_recorder_setOutputFile(m_mediaRecorder, m_outfd);
+    ret = HAL_TRACE(android_recorder_setOutputFile, m_mediaRecorder, m_outfd);
     if (ret < 0) {
         close(m_outfd);
         m_outfd = -1;
@@ -445,7 +1097,7 @@ int AalMediaRecorderControl::startRecording()
     }
 
     QSize resolution = videoSettings.resolution();
-    ret = android_recorder_setVideoSize(m_mediaRecorder, resolution.width(), resolution.height());
+    ret = HAL_TRACE(android_recorder_setVideoSize, m_mediaRecorder, resolution.width(), resolution.height());
     if (ret < 0) {
         close(m_outfd);
         m_outfd = -1;
@@ -453,7 +1105,7 @@ int AalMediaRecorderControl::startRecording()
         Q_EMIT error(RECORDER_INITIALIZATION_ERROR, "android_recorder_setVideoSize() failed");
         return RECORDER_INITIALIZATION_ERROR;
     }
-    ret = android_recorder_setVideoFrameRate(m_mediaRecorder, videoSettings.frameRate());
+    ret = HAL_TRACE(android_recorder_setVideoFrameRate, m_mediaRecorder, videoSettings.frameRate());
     if (ret < 0) {
         close(m_outfd);
         m_outfd = -1;
@@ -462,11 +1114,10 @@ int AalMediaRecorderControl::startRecording()
         return RECORDER_INITIALIZATION_ERROR;
     }
 
-    setParameter(PARAM_VIDEO_BITRATE, videoSettings.bitRate());
-    // FIXME get data from a new AalAudioEncoderSettingsControl
-    setParameter(PARAM_AUDIO_BITRATE, 48000);
-    setParameter(PARAM_AUDIO_CHANNELS, 2);
-    setParameter(PARAM_AUTIO_SAMPLING, 96000);
+    setParameter(PARAM_VIDEO_BITRATE, videoBitRate);
+    setParameter(PARAM_AUDIO_BITRATE, audioSettings.bitRate());
+    setParameter(PARAM_AUDIO_CHANNELS, audioSettings.channelCount());
+    setParameter(PARAM_AUTIO_SAMPLING, audioSettings.sampleRate());
 
     int rotation = m_service->rotationHandler()->calculateRotation();
     setParameter(PARAM_ORIENTATION, rotation);
@@ -476,7 +1127,7 @@ int AalMediaRecorderControl::startRecording()
         m_service->metadataWriterControl()->clearAllMetaData();
     }
 
-    ret = android_recorder_prepare(m_mediaRecorder);
+    ret = HAL_TRACE(android_recorder_prepare, m_mediaRecorder);
     if (ret < 0) {
         close(m_outfd);
         m_outfd = -1;
@@ -485,11 +1136,13 @@ int AalMediaRecorderControl::startRecording()
         return RECORDER_INITIALIZATION_ERROR;
     }
 
-    setStatus(QMediaRecorder::LoadedStatus);
-    setStatus(QMediaRecorder::StartingStatus);
+    if (m_currentStatus != QMediaRecorder::RecordingStatus) {
+        setStatus(QMediaRecorder::LoadedStatus);
+        setStatus(QMediaRecorder::StartingStatus);
+    }
 
     // state prepared
-    ret = android_recorder_start(m_mediaRecorder);
+    ret = HAL_TRACE(android_recorder_start, m_mediaRecorder);
     if (ret < 0) {
         close(m_outfd);
         m_outfd = -1;
@@ -498,20 +1151,241 @@ int AalMediaRecorderControl::startRecording()
         return RECORDER_INITIALIZATION_ERROR;
     }
 
-    m_currentState = QMediaRecorder::RecordingState;
+    return 0;
+}
+
+/*!
+ * \brief AalMediaRecorderControl::closeOutputFile takes the last measurement of
+ * the output file and closes it
+ */
+void AalMediaRecorderControl::closeOutputFile()
+{
+    if (m_outfd < 0)
+        return;
+
+    updateStatistics();
+    releasePreallocation();
+
+    int err = close(m_outfd);
+    if (err < 0)
+        qWarning() << "Failed to close recording output file descriptor (errno: "
+            << errno << ")";
+    m_outfd = -1;
+
+    // The reader thread sees the end of the stream now
+    if (m_replayBuffer != 0)
+        m_replayBuffer->stop();
+}
+
+/*!
+ * \brief AalMediaRecorderControl::segmentFileName returns the name of the
+ * file the segment index of the current recording is written to
+ */
+QString AalMediaRecorderControl::segmentFileName(int index) const
+{
+    QFileInfo fileInfo(m_segmentBaseName);
+    QString suffix = fileInfo.suffix();
+    if (suffix.isEmpty())
+        suffix = QLatin1String("mp4");
+
+    return QString("%1/%2_%3.%4")
+            .arg(fileInfo.absolutePath())
+            .arg(fileInfo.completeBaseName())
+            .arg(index, 5, 10, QChar('0'))
+            .arg(suffix);
+}
+
+void AalMediaRecorderControl::startSegmentTimer()
+{
+    if (m_segmentDuration <= 0)
+        return;
+
+    if (m_segmentTimer == 0) {
+        m_segmentTimer = new QTimer(this);
+        m_segmentTimer->setSingleShot(true);
+        m_segmentTimer->setTimerType(Qt::PreciseTimer);
+        QObject::connect(m_segmentTimer, SIGNAL(timeout()),
+                         this, SLOT(rolloverSegment()));
+    }
+    m_segmentTimer->start(m_segmentDuration);
+}
+
+/*!
+ * \brief AalMediaRecorderControl::finishSegment reports the segment that was
+ * just closed, and deletes the oldest ones so that they and a next segment of
+ * nextSegmentSize bytes fit in the storage budget
+ */
+void AalMediaRecorderControl::finishSegment(qint64 nextSegmentSize)
+{
+    QString fileName = segmentFileName(m_segmentIndex);
+    m_finishedSegments.enqueue(qMakePair(fileName, QFileInfo(fileName).size()));
+    Q_EMIT segmentFinished(m_segmentIndex, QUrl::fromLocalFile(fileName));
+
+    if (m_segmentStorageBudget <= 0)
+        return;
+
+    qint64 totalSize = nextSegmentSize;
+    for (int i = 0; i < m_finishedSegments.size(); ++i)
+        totalSize += m_finishedSegments.at(i).second;
+
+    while (totalSize > m_segmentStorageBudget && !m_finishedSegments.isEmpty()) {
+        QPair<QString, qint64> oldest = m_finishedSegments.dequeue();
+        if (!QFile::remove(oldest.first))
+            qWarning() << "Failed to remove recording segment" << oldest.first;
+        totalSize -= oldest.second;
+        Q_EMIT segmentRemoved(QUrl::fromLocalFile(oldest.first));
+    }
+}
+
+/*!
+ * \brief AalMediaRecorderControl::rolloverSegment closes the current segment
+ * and continues the recording into the next one. The recorder object and the
+ * camera connection are kept, so only the muxer and encoders restart.
+ */
+void AalMediaRecorderControl::rolloverSegment()
+{
+    if (m_mediaRecorder == 0 || m_currentStatus != QMediaRecorder::RecordingStatus)
+        return;
+
+    int result = HAL_TRACE(android_recorder_stop, m_mediaRecorder);
+    if (result < 0) {
+        Q_EMIT error(RECORDER_GENERAL_ERROR, "Cannot stop video recording segment");
+        return;
+    }
+
+    // NOTE: This must come after the android_recorder_stop call, see stopRecording()
+    if (m_audioCapture != 0) {
+        m_audioCapture->stopCapture();
+        m_audioSyncStatistics = m_audioCapture->syncStatistics();
+    }
+
+    HAL_TRACE(android_recorder_reset, m_mediaRecorder);
+
+    const qint64 lastSegmentSize = m_statistics.bytesWritten;
+    closeOutputFile();
+    finishSegment(qMax(lastSegmentSize, m_segmentSize));
+
+    // The microphone stream stays connected, the next segment gets a new capture run
+    m_audioCaptureAvailable = attachAudioCapture();
+
+    m_segmentIndex++;
+    QString fileName = segmentFileName(m_segmentIndex);
+    Q_EMIT actualLocationChanged(QUrl(fileName));
+    if (startRecorder(fileName) < 0) {
+        // startRecorder() has released the recorder and reported the error
+        m_recordingTimer->stop();
+        m_recordingClock.invalidate();
+        m_segmentBaseName.clear();
+        m_currentState = QMediaRecorder::StoppedState;
+        Q_EMIT stateChanged(m_currentState);
+        updateAudioLevelTimer();
+        return;
+    }
+
+    startSegmentTimer();
+    Q_EMIT segmentStarted(m_segmentIndex, QUrl::fromLocalFile(fileName));
+}
+
+void AalMediaRecorderControl::handleReplaySaved(const QString &fileName)
+{
+    Q_EMIT replaySaved(QUrl::fromLocalFile(fileName));
+}
+
+void AalMediaRecorderControl::handleReplayFailed(const QString &fileName)
+{
+    Q_UNUSED(fileName);
+    Q_EMIT error(RECORDER_GENERAL_ERROR, "Failed to save replay");
+}
+
+/*!
+ * \brief AalMediaRecorderControl::pauseRecording pauses the recorder. The
+ * recorder, its output and the microphone stream are kept, so the recording
+ * continues into the same file on resume.
+ */
+int AalMediaRecorderControl::pauseRecording()
+{
+    if (m_mediaRecorder == 0 || m_currentStatus != QMediaRecorder::RecordingStatus) {
+        qWarning() << "Can't pause a recording that has not started";
+        return RECORDER_NOT_AVAILABLE_ERROR;
+    }
+
+    if (android_recorder_pause == 0 || android_recorder_resume == 0) {
+        qWarning() << "Pausing video recording is not supported by the media layer";
+        Q_EMIT error(RECORDER_NOT_AVAILABLE_ERROR, "Pausing video recording is not supported");
+        return RECORDER_NOT_AVAILABLE_ERROR;
+    }
+
+    // The paused recorder stops reading the microphone pipe, so stop writing
+    // to it first
+    if (m_audioCapture != 0)
+        m_audioCapture->pauseCapture();
+
+    int result = HAL_TRACE(android_recorder_pause, m_mediaRecorder);
+    if (result < 0) {
+        if (m_audioCapture != 0)
+            m_audioCapture->resumeCapture();
+        Q_EMIT error(RECORDER_GENERAL_ERROR, "Cannot pause video recording");
+        return RECORDER_GENERAL_ERROR;
+    }
+
+    m_recordingTimer->stop();
+    m_recordedDuration += m_recordingClock.elapsed();
+    m_recordingClock.invalidate();
+    m_duration = m_recordedDuration;
+    Q_EMIT durationChanged(m_duration);
+    updateStatistics();
+
+    if (m_segmentTimer != 0 && m_segmentTimer->isActive()) {
+        m_segmentRemaining = m_segmentTimer->remainingTime();
+        m_segmentTimer->stop();
+    }
+
+    m_currentState = QMediaRecorder::PausedState;
     Q_EMIT stateChanged(m_currentState);
+    updateAudioLevelTimer();
+    setStatus(QMediaRecorder::PausedStatus);
 
-    setStatus(QMediaRecorder::RecordingStatus);
+    return 0;
+}
 
-    if (m_recordingTimer == 0) {
-        m_recordingTimer = new QTimer(this);
-        m_recordingTimer->setInterval(DURATION_UPDATE_INTERVAL);
-        m_recordingTimer->setSingleShot(false);
-        QObject::connect(m_recordingTimer, SIGNAL(timeout()),
-                         this, SLOT(updateDuration()));
+/*!
+ * \brief AalMediaRecorderControl::resumeRecording continues a paused recording
+ */
+int AalMediaRecorderControl::resumeRecording()
+{
+    if (m_mediaRecorder == 0 || m_currentStatus != QMediaRecorder::PausedStatus) {
+        qWarning() << "Can't resume a recording that is not paused";
+        return RECORDER_NOT_AVAILABLE_ERROR;
     }
+
+    if (android_recorder_resume == 0) {
+        qWarning() << "Resuming video recording is not supported by the media layer";
+        Q_EMIT error(RECORDER_NOT_AVAILABLE_ERROR, "Resuming video recording is not supported");
+        return RECORDER_NOT_AVAILABLE_ERROR;
+    }
+
+    int result = HAL_TRACE(android_recorder_resume, m_mediaRecorder);
+    if (result < 0) {
+        Q_EMIT error(RECORDER_GENERAL_ERROR, "Cannot resume video recording");
+        return RECORDER_GENERAL_ERROR;
+    }
+
+    if (m_audioCapture != 0)
+        m_audioCapture->resumeCapture();
+
+    m_recordingClock.start();
     m_recordingTimer->start();
 
+    if (m_segmentTimer != 0 && m_segmentRemaining >= 0) {
+        m_segmentTimer->start(m_segmentRemaining);
+        m_segmentRemaining = -1;
+    }
+
+    m_currentState = QMediaRecorder::RecordingState;
+    Q_EMIT stateChanged(m_currentState);
+    updateAudioLevelTimer();
+    setStatus(QMediaRecorder::RecordingStatus);
+
     return 0;
 }
 
@@ -526,7 +1400,8 @@ void AalMediaRecorderControl::stopRecording()
         return;
     }
 
-    if (m_currentStatus != QMediaRecorder::RecordingStatus) {
+    if (m_currentStatus != QMediaRecorder::RecordingStatus &&
+            m_currentStatus != QMediaRecorder::PausedStatus) {
         qWarning() << "Can't stop a recording that has not started";
         return;
     }
@@ -534,7 +1409,12 @@ void AalMediaRecorderControl::stopRecording()
     setStatus(QMediaRecorder::FinalizingStatus);
     m_recordingTimer->stop();
 
-    int result = android_recorder_stop(m_mediaRecorder);
+    if (m_recordingClock.isValid())
+        m_duration = m_recordedDuration + m_recordingClock.elapsed();
+    m_recordingClock.invalidate();
+    Q_EMIT durationChanged(m_duration);
+
+    int result = HAL_TRACE(android_recorder_stop, m_mediaRecorder);
     if (result < 0) {
         Q_EMIT error(RECORDER_GENERAL_ERROR, "Cannot stop video recording");
         return;
@@ -546,18 +1426,25 @@ void AalMediaRecorderControl::stopRecording()
     // cleanly stop recording.
     if (m_audioCapture != 0) {
         m_audioCapture->stopCapture();
+        m_audioSyncStatistics = m_audioCapture->syncStatistics();
     }
 
-    android_recorder_reset(m_mediaRecorder);
+    HAL_TRACE(android_recorder_reset, m_mediaRecorder);
 
-    int err = close(m_outfd);
-    if (err < 0)
-        qWarning() << "Failed to close recording output file descriptor (errno: "
-            << errno << ")";
-    m_outfd = -1;
+    // The muxer has flushed everything by now
+    closeOutputFile();
+
+    if (!m_segmentBaseName.isEmpty()) {
+        if (m_segmentTimer)
+            m_segmentTimer->stop();
+        m_segmentRemaining = -1;
+        finishSegment(0);
+        m_segmentBaseName.clear();
+    }
 
     m_currentState = QMediaRecorder::StoppedState;
     Q_EMIT stateChanged(m_currentState);
+    updateAudioLevelTimer();
 
     deleteRecorder();
 }
@@ -571,13 +1458,24 @@ void AalMediaRecorderControl::setParameter(const QString &parameter, int value)
 {
     Q_ASSERT(m_mediaRecorder);
     QString param =  parameter + QChar('=') + QString::number(value);
-    android_recorder_setParameters(m_mediaRecorder, param.toLocal8Bit().data());
+    HAL_TRACE(android_recorder_setParameters, m_mediaRecorder, param.toLocal8Bit().data());
 }
 
 void AalMediaRecorderControl::recorderReadAudioCallback(void *context)
 {
+    HalTraceSpan span(Q_FUNC_INFO);
+    halRecordCallback("on_recorder_read_audio");
     AalMediaRecorderControl *thiz = static_cast<AalMediaRecorderControl*>(context);
     if (thiz != NULL) {
         thiz->startAudioCaptureThread();
     }
 }
+
+RecordingStatistics::RecordingStatistics()
+    : bytesWritten(0),
+      bitRate(0),
+      writeRate(0),
+      freeSpace(0),
+      timeUntilFull(-1)
+{
+}
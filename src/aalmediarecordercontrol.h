@@ -17,8 +17,13 @@
 #ifndef AALMEDIARECORDERCONTROL_H
 #define AALMEDIARECORDERCONTROL_H
 
+#include "audiocapture.h"
+
+#include <QElapsedTimer>
 #include <QLatin1String>
 #include <QMediaRecorderControl>
+#include <QPair>
+#include <QQueue>
 #include <QSize>
 #include <QUrl>
 #include <QThread>
@@ -29,10 +34,31 @@ class AalCameraService;
 struct CameraControl;
 struct CameraControlListener;
 struct MediaRecorderWrapper;
-class AudioCapture;
+class ReplayBuffer;
 class QThread;
 class QTimer;
 
+/*!
+ * \brief The RecordingStatistics class describes the throughput of the
+ * recording currently being written to disk
+ */
+class RecordingStatistics
+{
+public:
+    RecordingStatistics();
+    /// Size of the output file so far, in bytes
+    qint64 bytesWritten;
+    /// Average bitrate of the output since the recording started, in bits per second
+    qint64 bitRate;
+    /// Rate at which the output file grew recently, in bytes per second
+    qint64 writeRate;
+    /// Space left on the filesystem holding the output file, in bytes
+    qint64 freeSpace;
+    /// Projected time until the filesystem is full at the current write rate,
+    /// in milliseconds, or -1 if it can't be estimated yet
+    qint64 timeUntilFull;
+};
+
 class AalMediaRecorderControl : public QMediaRecorderControl
 {
 Q_OBJECT
@@ -54,6 +80,39 @@ public:
     void init(CameraControl *control, CameraControlListener *listener);
     MediaRecorderWrapper* mediaRecorder() const;
     AudioCapture *audioCapture() const;
+    void prepareAudioCapture();
+    void releaseAudioCapture();
+    RecordingStatistics statistics() const;
+
+    qint64 expectedDuration() const;
+    void setExpectedDuration(qint64 duration);
+    qint64 storageReserve() const;
+    void setStorageReserve(qint64 bytes);
+    bool isPreallocationEnabled() const;
+    void setPreallocationEnabled(bool enabled);
+
+    qint64 segmentDuration() const;
+    void setSegmentDuration(qint64 duration);
+    qint64 segmentSize() const;
+    void setSegmentSize(qint64 bytes);
+    qint64 segmentStorageBudget() const;
+    void setSegmentStorageBudget(qint64 bytes);
+    bool isSegmented() const;
+
+    qint64 replayWindow() const;
+    void setReplayWindow(qint64 window);
+    bool saveReplay(const QUrl &location, qint64 duration = 0);
+
+    bool audioSyncCorrection() const;
+    void setAudioSyncCorrection(bool enabled);
+    qint64 audioSyncTolerance() const;
+    void setAudioSyncTolerance(qint64 tolerance);
+    AudioSyncStatistics audioSyncStatistics() const;
+
+    bool audioLevelMetering() const;
+    void setAudioLevelMetering(bool enabled);
+    int audioChannelCount() const;
+    AudioLevel audioLevel(int channel = 0) const;
 
 public Q_SLOTS:
     virtual void setMuted(bool muted);
@@ -63,20 +122,43 @@ public Q_SLOTS:
 
 signals:
     void audioCaptureThreadStarted();
+    void statisticsChanged();
+    void audioLevelChanged();
+    void segmentStarted(int index, const QUrl &location);
+    void segmentFinished(int index, const QUrl &location);
+    void segmentRemoved(const QUrl &location);
+    void replaySaved(const QUrl &location);
 
 private Q_SLOTS:
     virtual void updateDuration();
     void handleError();
-    void deleteAudioCapture();
+    void rolloverSegment();
+    void handleReplaySaved(const QString &fileName);
+    void handleReplayFailed(const QString &fileName);
+    void updateAudioLevel();
 
 private:
     bool initRecorder();
     void deleteRecorder();
-    int initAudioCapture();
+    bool attachAudioCapture();
     void setStatus(QMediaRecorder::Status status);
     int startRecording();
+    int pauseRecording();
+    int resumeRecording();
+    int startRecorder(const QString &fileName);
+    void closeOutputFile();
     void stopRecording();
+    QString segmentFileName(int index) const;
+    void startSegmentTimer();
+    void finishSegment(qint64 nextSegmentSize);
     void setParameter(const QString &parameter, int value);
+    void updateStatistics();
+    bool checkOutputStorage();
+    bool hasSpaceForRecording(const QString &fileName, qint64 bitRate);
+    void preallocateOutput();
+    void releasePreallocation();
+    void dropWrittenOutput();
+    void updateAudioLevelTimer();
     static void recorderReadAudioCallback(void *context);
 
     AalCameraService *m_service;
@@ -85,17 +167,51 @@ private:
     int m_outfd;
     QUrl m_outputLocation;
     qint64 m_duration;
+    QElapsedTimer m_recordingClock;
+    qint64 m_recordedDuration;
+    RecordingStatistics m_statistics;
+    qint64 m_lastStatisticsUpdate;
+    qint64 m_expectedDuration;
+    qint64 m_storageReserve;
+    bool m_preallocationEnabled;
+    qint64 m_preallocatedSize;
+    /// Output written back to storage and dropped from the page cache
+    qint64 m_droppedSize;
+    /// Output written back since the previous check, not dropped yet
+    qint64 m_writebackSize;
+    qint64 m_segmentDuration;
+    qint64 m_segmentSize;
+    qint64 m_segmentStorageBudget;
+    int m_segmentIndex;
+    QString m_segmentBaseName;
+    QQueue<QPair<QString, qint64> > m_finishedSegments;
+    QTimer *m_segmentTimer;
+    int m_segmentRemaining;
+    qint64 m_replayWindow;
+    ReplayBuffer *m_replayBuffer;
     QMediaRecorder::State m_currentState;
     QMediaRecorder::Status m_currentStatus;
     QTimer *m_recordingTimer;
     QThread m_audioCaptureThread;
     bool m_audioCaptureAvailable;
+    bool m_audioSyncCorrection;
+    qint64 m_audioSyncTolerance;
+    AudioSyncStatistics m_audioSyncStatistics;
+    bool m_audioLevelMetering;
+    QTimer *m_audioLevelTimer;
+    bool m_audioLevelSilent;
 
     static const int RECORDER_GENERAL_ERROR = -1;
     static const int RECORDER_NOT_AVAILABLE_ERROR = -2;
     static const int RECORDER_INITIALIZATION_ERROR = -3;
+    static const int RECORDER_STORAGE_FULL_ERROR = -4;
 
     static const int DURATION_UPDATE_INTERVAL = 1000; // update every second
+    static const int AUDIO_LEVEL_UPDATE_INTERVAL = 50;
+
+    static const qint64 DEFAULT_EXPECTED_DURATION = 60000; // one minute
+    static const qint64 DEFAULT_STORAGE_RESERVE = 50 * 1024 * 1024;
+    static const qint64 PREALLOCATION_CHUNK_SIZE = 16 * 1024 * 1024;
 
     static const QLatin1String PARAM_AUDIO_BITRATE;
     static const QLatin1String PARAM_AUDIO_CHANNELS;
@@ -104,6 +220,8 @@ private:
     static const QLatin1String PARAM_LONGITUDE;
     static const QLatin1String PARAM_ORIENTATION;
     static const QLatin1String PARAM_VIDEO_BITRATE;
+
+    friend class AalCameraService;
 };
 
 #endif
@@ -17,15 +17,27 @@
 #include "aalvideoencodersettingscontrol.h"
 #include "aalcameraservice.h"
 #include "aalcameracontrol.h"
+#include "aalvideodeviceselectorcontrol.h"
 #include "aalviewfindersettingscontrol.h"
+#include "bitratepolicy.h"
+#include "devicequirks.h"
+#include "haltrace.h"
 
 #include <hybris/camera/camera_compatibility_layer_capabilities.h>
 
 #include <QCamera>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QXmlStreamReader>
+
+#include <algorithm>
 
 const QSize AalVideoEncoderSettingsControl::DEFAULT_SIZE = QSize(1280,720);
 const int AalVideoEncoderSettingsControl::DEFAULT_FPS = 30;
 const QString AalVideoEncoderSettingsControl::DEFAULT_CODEC = QString("H.264");
+const QString AalVideoEncoderSettingsControl::HEVC_CODEC = QString("H.265");
+const int AalVideoEncoderSettingsControl::VIDEO_ENCODER_HEVC;
 
 /*!
  * \brief AalVideoEncoderSettingsControl::AalVideoEncoderSettingsControl
@@ -34,12 +46,15 @@ const QString AalVideoEncoderSettingsControl::DEFAULT_CODEC = QString("H.264");
  */
 AalVideoEncoderSettingsControl::AalVideoEncoderSettingsControl(AalCameraService *service, QObject *parent)
     : QVideoEncoderSettingsControl(parent),
-      m_service(service)
+      m_service(service),
+      m_explicitBitRate(false)
 {
 }
 
 /*!
  * \reimp
+ * An explicit bitrate is only used with one of the bitrate encoding modes,
+ * otherwise it is derived from the quality, resolution and frame rate.
  */
 void AalVideoEncoderSettingsControl::setVideoSettings(const QVideoEncoderSettings &settings)
 {
@@ -47,8 +62,6 @@ void AalVideoEncoderSettingsControl::setVideoSettings(const QVideoEncoderSetting
     if (supportedVideoCodecs().contains(settings.codec()))
         m_settings.setCodec(settings.codec());
 
-    m_settings.setBitRate(settings.bitRate());
-
     if (supportedFrameRates(settings, &continuous).contains(settings.frameRate()))
         m_settings.setFrameRate(settings.frameRate());
 
@@ -59,6 +72,19 @@ void AalVideoEncoderSettingsControl::setVideoSettings(const QVideoEncoderSetting
         }
     }
 
+    if (m_service->cameraControl()->captureMode() == QCamera::CaptureVideo)
+        updateViewfinderFrameRate();
+
+    m_settings.setEncodingMode(settings.encodingMode());
+    m_settings.setQuality(settings.quality());
+    m_explicitBitRate = settings.encodingMode() != QMultimedia::ConstantQualityEncoding &&
+            settings.bitRate() > 0;
+    if (m_explicitBitRate) {
+        m_settings.setBitRate(settings.bitRate());
+    } else {
+        updateBitRate();
+    }
+
     // FIXME support more options
 }
 
@@ -67,11 +93,35 @@ void AalVideoEncoderSettingsControl::setVideoSettings(const QVideoEncoderSetting
  */
 QList<qreal> AalVideoEncoderSettingsControl::supportedFrameRates(const QVideoEncoderSettings &settings, bool *continuous) const
 {
-    Q_UNUSED(settings);
-    Q_UNUSED(continuous);
-    // FIXME get data from android
-    QList<qreal> fps;
-    fps << 15 << 30;
+    if (continuous)
+        *continuous = false;
+
+    int deviceId = m_service->deviceSelector()->selectedDevice();
+    if (!m_frameRates.contains(deviceId))
+        queryFrameRates(deviceId);
+
+    QList<qreal> fps = m_frameRates.value(deviceId);
+    if (fps.isEmpty()) {
+        // No camera connected yet
+        fps << 15 << 30;
+        return fps;
+    }
+
+    // High frame rates are only available up to some resolution
+    QSize resolution = settings.resolution();
+    if (resolution.isValid()) {
+        QList<qreal>::iterator it = fps.begin();
+        while (it != fps.end()) {
+            QSize maximum = maximumResolution(*it);
+            if (maximum.isValid() && (resolution.width() > maximum.width() ||
+                                      resolution.height() > maximum.height())) {
+                it = fps.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
     return fps;
 }
 
@@ -80,13 +130,21 @@ QList<qreal> AalVideoEncoderSettingsControl::supportedFrameRates(const QVideoEnc
  */
 QList<QSize> AalVideoEncoderSettingsControl::supportedResolutions(const QVideoEncoderSettings &settings, bool *continuous) const
 {
-    Q_UNUSED(settings);
     Q_UNUSED(continuous);
 
     if (m_availableSizes.isEmpty())
         querySupportedResolution();
 
-    return m_availableSizes;
+    QSize maximum = maximumResolution(settings.frameRate());
+    if (!maximum.isValid())
+        return m_availableSizes;
+
+    QList<QSize> sizes;
+    foreach (const QSize &size, m_availableSizes) {
+        if (size.width() <= maximum.width() && size.height() <= maximum.height())
+            sizes.append(size);
+    }
+    return sizes;
 }
 
 /*!
@@ -94,9 +152,10 @@ QList<QSize> AalVideoEncoderSettingsControl::supportedResolutions(const QVideoEn
  */
 QStringList AalVideoEncoderSettingsControl::supportedVideoCodecs() const
 {
-    // FIXME get data from android
     QStringList codecs;
     codecs << DEFAULT_CODEC;
+    if (isHevcEncoderAvailable())
+        codecs << HEVC_CODEC;
     return codecs;
 }
 
@@ -126,6 +185,55 @@ float AalVideoEncoderSettingsControl::getAspectRatio() const
     return (float)resolution.width() / (float)resolution.height();
 }
 
+/*!
+ * \brief AalVideoEncoderSettingsControl::androidVideoEncoder returns the
+ * android encoder for the selected codec
+ */
+VideoEncoder AalVideoEncoderSettingsControl::androidVideoEncoder() const
+{
+    if (m_settings.codec() == HEVC_CODEC)
+        return static_cast<VideoEncoder>(VIDEO_ENCODER_HEVC);
+
+    return ANDROID_VIDEO_ENCODER_H264;
+}
+
+/*!
+ * \brief AalVideoEncoderSettingsControl::isHighFrameRate returns true if the
+ * frame rate is above what the preview normally runs at, so the camera has to
+ * be switched into a high frame rate mode for it
+ */
+bool AalVideoEncoderSettingsControl::isHighFrameRate(qreal frameRate) const
+{
+    int deviceId = m_service->deviceSelector()->selectedDevice();
+    return m_highFrameRates.value(deviceId).contains(qRound(frameRate));
+}
+
+/*!
+ * \brief AalVideoEncoderSettingsControl::maximumResolution returns the largest
+ * resolution the camera supports at the given frame rate, or an invalid size
+ * if there is no limit
+ */
+QSize AalVideoEncoderSettingsControl::maximumResolution(qreal frameRate) const
+{
+    int deviceId = m_service->deviceSelector()->selectedDevice();
+    return m_highFrameRates.value(deviceId).value(qRound(frameRate), QSize());
+}
+
+/*!
+ * \brief AalVideoEncoderSettingsControl::updateViewfinderFrameRate runs the
+ * viewfinder at the recording frame rate in high frame rate mode, and at the
+ * default one otherwise
+ */
+void AalVideoEncoderSettingsControl::updateViewfinderFrameRate()
+{
+    qreal frameRate = m_settings.frameRate();
+    if (isHighFrameRate(frameRate)) {
+        m_service->viewfinderControl()->setFrameRate(qRound(frameRate), maximumResolution(frameRate));
+    } else {
+        m_service->viewfinderControl()->setFrameRate(0);
+    }
+}
+
 /*!
  * \brief AalVideoEncoderSettingsControl::init
  * \param control
@@ -143,6 +251,7 @@ void AalVideoEncoderSettingsControl::init(CameraControl *control, CameraControlL
 
     if (!m_availableSizes.contains(m_settings.resolution()) && !m_availableSizes.empty()) {
         m_settings.setResolution(m_availableSizes[0]);
+        updateBitRate();
         if (m_service->cameraControl()->captureMode() == QCamera::CaptureVideo) {
             m_service->viewfinderControl()->setAspectRatio(getAspectRatio());
         }
@@ -156,11 +265,131 @@ void AalVideoEncoderSettingsControl::resetAllSettings()
 {
     m_availableSizes.clear();
 
-    int videoBitRate = 7 * DEFAULT_SIZE.width() * DEFAULT_SIZE.height();
-    m_settings.setBitRate(videoBitRate);
     m_settings.setCodec(DEFAULT_CODEC);
     m_settings.setFrameRate(DEFAULT_FPS);
     m_settings.setResolution(DEFAULT_SIZE.width(), DEFAULT_SIZE.height());
+    m_settings.setEncodingMode(QMultimedia::ConstantQualityEncoding);
+    m_settings.setQuality(QMultimedia::NormalQuality);
+    m_explicitBitRate = false;
+    updateBitRate();
+}
+
+/*!
+ * \brief AalVideoEncoderSettingsControl::updateBitRate derives the bitrate
+ * from the current quality, resolution and frame rate, unless a bitrate was
+ * explicitly asked for
+ */
+void AalVideoEncoderSettingsControl::updateBitRate()
+{
+    if (m_explicitBitRate)
+        return;
+
+    int bitRate = BitratePolicy::videoBitRate(m_settings.resolution(), m_settings.frameRate(),
+                                              m_settings.quality());
+    // H.265 gets the same quality at about half the bitrate
+    if (m_settings.codec() == HEVC_CODEC)
+        bitRate /= 2;
+    m_settings.setBitRate(bitRate);
+}
+
+/*!
+ * \brief AalVideoEncoderSettingsControl::queryFrameRates gets the frame rates
+ * the camera can record at. The HAL only reports its normal preview frame rate
+ * range, the high frame rate modes come from the aal.camera.hfr.<device id>
+ * property, as a list of fps:WIDTHxHEIGHT entries with the largest resolution
+ * available at each frame rate.
+ */
+void AalVideoEncoderSettingsControl::queryFrameRates(int deviceId) const
+{
+    CameraControl *cc = m_service->androidControl();
+    if (!cc)
+        return;
+
+    int minFps = 0;
+    int maxFps = 0;
+    HAL_TRACE(android_camera_get_preview_fps_range, cc, &minFps, &maxFps);
+    maxFps /= 1000;
+
+    QList<qreal> fps;
+    const int standardFrameRates[] = { 15, 24, 25, 30 };
+    for (unsigned int i = 0; i < sizeof(standardFrameRates) / sizeof(int); ++i) {
+        if (maxFps <= 0 || standardFrameRates[i] <= maxFps)
+            fps << standardFrameRates[i];
+    }
+    if (maxFps > 30)
+        fps << maxFps;
+
+    QMap<int, QSize> highFrameRates;
+    foreach (const QString &mode, DeviceQuirks::list("hfr", deviceId)) {
+        QStringList parts = mode.split(QChar(':'));
+        QStringList dimensions = parts.last().split(QChar('x'));
+        bool ok = parts.size() == 2 && dimensions.size() == 2;
+        int rate = 0;
+        QSize maximum;
+        if (ok) {
+            bool fpsOk, widthOk, heightOk;
+            rate = parts[0].toInt(&fpsOk);
+            maximum = QSize(dimensions[0].toInt(&widthOk), dimensions[1].toInt(&heightOk));
+            ok = fpsOk && widthOk && heightOk && rate > 0;
+        }
+        if (!ok) {
+            qWarning() << "Invalid high frame rate mode" << mode << "for camera" << deviceId;
+            continue;
+        }
+
+        highFrameRates.insert(rate, maximum);
+        if (!fps.contains(rate))
+            fps << rate;
+    }
+    std::sort(fps.begin(), fps.end());
+
+    m_frameRates.insert(deviceId, fps);
+    m_highFrameRates.insert(deviceId, highFrameRates);
+}
+
+/*!
+ * \brief AalVideoEncoderSettingsControl::isHevcEncoderAvailable checks once
+ * whether the media codecs list of the device has an H.265 encoder
+ */
+bool AalVideoEncoderSettingsControl::isHevcEncoderAvailable()
+{
+    static const bool available = hasEncoder("/vendor/etc/media_codecs.xml", "video/hevc") ||
+            hasEncoder("/system/etc/media_codecs.xml", "video/hevc");
+    return available;
+}
+
+bool AalVideoEncoderSettingsControl::hasEncoder(const QString &fileName, const QString &mimeType, int depth)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QXmlStreamReader xml(&file);
+    bool inEncoders = false;
+    while (!xml.atEnd()) {
+        xml.readNext();
+        if (xml.isStartElement()) {
+            QXmlStreamAttributes attributes = xml.attributes();
+            if (xml.name() == QLatin1String("Encoders")) {
+                inEncoders = true;
+            } else if (xml.name() == QLatin1String("Include") && depth < 4) {
+                QString include = QFileInfo(fileName).absolutePath() + "/" +
+                        attributes.value("href").toString();
+                if (hasEncoder(include, mimeType, depth + 1))
+                    return true;
+            } else if (inEncoders && xml.name() == QLatin1String("MediaCodec")) {
+                if (attributes.value("type") == mimeType)
+                    return true;
+            } else if (inEncoders && xml.name() == QLatin1String("Type")) {
+                if (attributes.value("name") == mimeType)
+                    return true;
+            }
+        } else if (xml.isEndElement() && xml.name() == QLatin1String("Encoders")) {
+            inEncoders = false;
+        }
+    }
+
+    return false;
 }
 
 /*!
@@ -175,8 +404,8 @@ void AalVideoEncoderSettingsControl::querySupportedResolution() const
 
 
     AalVideoEncoderSettingsControl *vSettings = const_cast<AalVideoEncoderSettingsControl*>(this);
-    android_camera_enumerate_supported_video_sizes(cc, &AalVideoEncoderSettingsControl::sizeCB,
-                                                   vSettings);
+    HAL_TRACE(android_camera_enumerate_supported_video_sizes, cc,
+              &AalVideoEncoderSettingsControl::sizeCB, vSettings);
 
     if (m_availableSizes.isEmpty()) {
         // android devices where video and viewfinder are "linked", no sizes are returned
@@ -193,6 +422,7 @@ void AalVideoEncoderSettingsControl::querySupportedResolution() const
  */
 void AalVideoEncoderSettingsControl::sizeCB(void *ctx, int width, int height)
 {
+    halRecordCallback("size_callback", width, height);
     AalVideoEncoderSettingsControl *self = (AalVideoEncoderSettingsControl*)ctx;
     self->m_availableSizes.append(QSize(width, height));
 }
@@ -17,8 +17,12 @@
 #ifndef AALVIDEOENCODERSETTINGSCONTROL_H
 #define AALVIDEOENCODERSETTINGSCONTROL_H
 
+#include <QHash>
+#include <QMap>
 #include <QVideoEncoderSettingsControl>
 
+#include <hybris/media/media_recorder_layer.h>
+
 class AalCameraService;
 struct CameraControl;
 struct CameraControlListener;
@@ -37,6 +41,10 @@ public:
     virtual QVideoEncoderSettings videoSettings() const;
     
     float getAspectRatio() const;
+    VideoEncoder androidVideoEncoder() const;
+    bool isHighFrameRate(qreal frameRate) const;
+    QSize maximumResolution(qreal frameRate) const;
+    void updateViewfinderFrameRate();
 
     void init(CameraControl *control, CameraControlListener *listener);
     void resetAllSettings();
@@ -45,14 +53,24 @@ public:
 
 private:
     void querySupportedResolution() const;
+    void queryFrameRates(int deviceId) const;
+    void updateBitRate();
+    static bool isHevcEncoderAvailable();
+    static bool hasEncoder(const QString &fileName, const QString &mimeType, int depth = 0);
 
     AalCameraService *m_service;
     QVideoEncoderSettings m_settings;
+    /// The bitrate of m_settings was asked for, rather than derived
+    bool m_explicitBitRate;
     mutable QList<QSize> m_availableSizes;
+    mutable QHash<int, QList<qreal> > m_frameRates;
+    mutable QHash<int, QMap<int, QSize> > m_highFrameRates;
 
     static const QSize DEFAULT_SIZE;
     static const int DEFAULT_FPS;
     static const QString DEFAULT_CODEC;
+    static const QString HEVC_CODEC;
+    static const int VIDEO_ENCODER_HEVC = 5; // missing in the hybris VideoEncoder enum
 };
 
 #endif // AALVIDEOENCODERSETTINGSCONTROL_H
@@ -17,6 +17,8 @@
 #include "aalvideorenderercontrol.h"
 #include "aalcameraservice.h"
 #include "aalviewfindersettingscontrol.h"
+#include "haleventqueue.h"
+#include "haltrace.h"
 
 #include <hybris/camera/camera_compatibility_layer.h>
 #include <hybris/camera/camera_compatibility_layer_capabilities.h>
@@ -73,13 +75,11 @@ AalVideoRendererControl::AalVideoRendererControl(AalCameraService *service, QObj
      m_previewStarted(false),
      m_textureId(0)
 {
-    // Get notified when qtvideo-node creates a GL texture
-    connect(SharedSignal::instance(), SIGNAL(textureCreated(unsigned int)), this, SLOT(onTextureCreated(unsigned int)));
-    connect(SharedSignal::instance(), SIGNAL(snapshotTaken(QImage)), this, SLOT(onSnapshotTaken(QImage)));
 }
 
 AalVideoRendererControl::~AalVideoRendererControl()
 {
+    AalSharedSignalDispatcher::instance()->forget(this);
 }
 
 QAbstractVideoSurface *AalVideoRendererControl::surface() const
@@ -116,8 +116,8 @@ void AalVideoRendererControl::startPreview()
 
     if (m_textureId) {
         CameraControl *cc = m_service->androidControl();
-        android_camera_set_preview_texture(cc, m_textureId);
-        android_camera_start_preview(cc);
+        HAL_TRACE(android_camera_set_preview_texture, cc, m_textureId);
+        HAL_TRACE(android_camera_start_preview, cc);
     }
 
     // if no texture ID is set to the frame passed to ShaderVideoNode,
@@ -147,9 +147,9 @@ void AalVideoRendererControl::stopPreview()
     }
 
     CameraControl *cc = m_service->androidControl();
-    android_camera_stop_preview(cc);
+    HAL_TRACE(android_camera_stop_preview, cc);
     // FIXME: missing android_camera_set_preview_size(QSize())
-    android_camera_set_preview_texture(cc, 0);
+    HAL_TRACE(android_camera_set_preview_texture, cc, 0);
 
     m_previewStarted = false;
     m_service->updateCaptureReady();
@@ -196,6 +196,9 @@ void AalVideoRendererControl::updateViewfinderFrame()
 
     if (m_surface->isActive()) {
         m_surface->present(frame);
+        // qtvideo-node creates a texture for a frame without one
+        if (!m_textureId)
+            AalSharedSignalDispatcher::instance()->waitForTexture(this);
     }
 }
 
@@ -204,9 +207,9 @@ void AalVideoRendererControl::onTextureCreated(GLuint textureID)
     m_textureId = textureID;
     CameraControl *cc = m_service->androidControl();
     if (cc) {
-        android_camera_set_preview_texture(cc, m_textureId);
+        HAL_TRACE(android_camera_set_preview_texture, cc, m_textureId);
         if (m_textureId && m_previewStarted) {
-            android_camera_start_preview(cc);
+            HAL_TRACE(android_camera_start_preview, cc);
         }
     }
     m_service->updateCaptureReady();
@@ -220,11 +223,9 @@ void AalVideoRendererControl::onSnapshotTaken(QImage snapshotImage)
 
 void AalVideoRendererControl::updateViewfinderFrameCB(void* context)
 {
-    Q_UNUSED(context);
-    AalVideoRendererControl *self = AalCameraService::instance()->videoOutputControl();
-    if (self->m_previewStarted) {
-        QMetaObject::invokeMethod(self, "updateViewfinderFrame", Qt::QueuedConnection);
-    }
+    HalTraceSpan span(Q_FUNC_INFO);
+    halRecordCallback("on_preview_texture_needs_update");
+    static_cast<AalCameraService*>(context)->postHalEvent(new HalEvent(HalEvent::ViewfinderFrame));
 }
 
 const QImage &AalVideoRendererControl::preview() const
@@ -232,12 +233,72 @@ const QImage &AalVideoRendererControl::preview() const
     return m_preview;
 }
 
-void AalVideoRendererControl::createPreview()
+/*!
+ * \brief AalVideoRendererControl::createPreview requests a copy of the next
+ * viewfinder frame, previewReady() is emitted once it is available
+ * \return false if there is no viewfinder to take the frame from
+ */
+bool AalVideoRendererControl::createPreview()
 {
     if (!m_textureId || !m_service->androidControl())
-        return;
+        return false;
 
     QSize vfSize = m_service->viewfinderControl()->currentSize();
+    AalSharedSignalDispatcher::instance()->waitForSnapshot(this);
     SharedSignal::instance()->setSnapshotSize(vfSize);
     SharedSignal::instance()->takeSnapshot(m_service->androidControl());
+    return true;
+}
+
+AalSharedSignalDispatcher::AalSharedSignalDispatcher()
+{
+    // Get notified when qtvideo-node creates a GL texture or a snapshot
+    connect(SharedSignal::instance(), SIGNAL(textureCreated(unsigned int)), this, SLOT(onTextureCreated(unsigned int)));
+    connect(SharedSignal::instance(), SIGNAL(snapshotTaken(QImage)), this, SLOT(onSnapshotTaken(QImage)));
+}
+
+AalSharedSignalDispatcher *AalSharedSignalDispatcher::instance()
+{
+    static AalSharedSignalDispatcher *dispatcher = new AalSharedSignalDispatcher;
+    return dispatcher;
+}
+
+/*!
+ * \brief AalSharedSignalDispatcher::waitForTexture queues the renderer for the
+ * next texture qtvideo-node creates, unless it is already waiting for one
+ */
+void AalSharedSignalDispatcher::waitForTexture(AalVideoRendererControl *renderer)
+{
+    if (!m_textureWaiters.contains(renderer))
+        m_textureWaiters.append(renderer);
+}
+
+/*!
+ * \brief AalSharedSignalDispatcher::waitForSnapshot queues the renderer for
+ * the next snapshot, once for every snapshot it requested
+ */
+void AalSharedSignalDispatcher::waitForSnapshot(AalVideoRendererControl *renderer)
+{
+    m_snapshotWaiters.append(renderer);
+}
+
+void AalSharedSignalDispatcher::forget(AalVideoRendererControl *renderer)
+{
+    m_textureWaiters.removeAll(renderer);
+    m_snapshotWaiters.removeAll(renderer);
+}
+
+void AalSharedSignalDispatcher::onTextureCreated(unsigned int textureID)
+{
+    // Textures of other video nodes, like those of a media player, are left alone
+    if (m_textureWaiters.isEmpty())
+        return;
+    m_textureWaiters.takeFirst()->onTextureCreated(textureID);
+}
+
+void AalSharedSignalDispatcher::onSnapshotTaken(QImage snapshotImage)
+{
+    if (m_snapshotWaiters.isEmpty())
+        return;
+    m_snapshotWaiters.takeFirst()->onSnapshotTaken(snapshotImage);
 }
@@ -18,13 +18,42 @@
 #define AALVIDEORENDERERCONTROL_H
 
 #include <QImage>
+#include <QList>
 #include <QVideoRendererControl>
 #include <qgl.h>
 
 class AalCameraService;
+class AalVideoRendererControl;
 struct CameraControl;
 struct CameraControlListener;
 
+/*!
+ * \brief The AalSharedSignalDispatcher class hands the textures and snapshots
+ * that qtvideo-node announces process wide, without saying for which camera,
+ * to the renderers waiting for them. Each goes to a single renderer, the one
+ * that has waited longest.
+ */
+class AalSharedSignalDispatcher : public QObject
+{
+    Q_OBJECT
+public:
+    static AalSharedSignalDispatcher *instance();
+
+    void waitForTexture(AalVideoRendererControl *renderer);
+    void waitForSnapshot(AalVideoRendererControl *renderer);
+    void forget(AalVideoRendererControl *renderer);
+
+private Q_SLOTS:
+    void onTextureCreated(unsigned int textureID);
+    void onSnapshotTaken(QImage snapshotImage);
+
+private:
+    AalSharedSignalDispatcher();
+
+    QList<AalVideoRendererControl*> m_textureWaiters;
+    QList<AalVideoRendererControl*> m_snapshotWaiters;
+};
+
 class AalVideoRendererControl : public QVideoRendererControl
 {
     Q_OBJECT
@@ -38,7 +67,7 @@ public:
     static void updateViewfinderFrameCB(void *context);
 
     const QImage &preview() const;
-    void createPreview();
+    bool createPreview();
 
     bool isPreviewStarted() const;
 
@@ -53,10 +82,11 @@ Q_SIGNALS:
 
 private Q_SLOTS:
     void updateViewfinderFrame();
+
+private:
     void onTextureCreated(unsigned int textureID);
     void onSnapshotTaken(QImage snapshotImage);
 
-private:
     QAbstractVideoSurface *m_surface;
     AalCameraService *m_service;
 
@@ -64,6 +94,9 @@ private:
     bool m_previewStarted;
     GLuint m_textureId;
     QImage m_preview;
+
+    friend class AalCameraService;
+    friend class AalSharedSignalDispatcher;
 };
 
 #endif
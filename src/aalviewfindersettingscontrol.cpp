@@ -17,6 +17,7 @@
 #include "aalviewfindersettingscontrol.h"
 #include "aalcameraservice.h"
 #include "aalvideorenderercontrol.h"
+#include "haltrace.h"
 
 #include <QDebug>
 
@@ -29,7 +30,8 @@ AalViewfinderSettingsControl::AalViewfinderSettingsControl(AalCameraService *ser
       m_aspectRatio(0.0),
       m_currentFPS(30),
       m_minFPS(10),
-      m_maxFPS(30)
+      m_maxFPS(30),
+      m_requestedFPS(0)
 {
 }
 
@@ -112,7 +114,7 @@ void AalViewfinderSettingsControl::setSize(const QSize &size)
     if (wasPreviewStarted) {
         m_service->stopPreview();
     }
-    android_camera_set_preview_size(cc, m_currentSize.width(), m_currentSize.height());
+    HAL_TRACE(android_camera_set_preview_size, cc, m_currentSize.width(), m_currentSize.height());
     if (wasPreviewStarted) {
         m_service->startPreview();
     }
@@ -134,9 +136,8 @@ const QList<QSize> &AalViewfinderSettingsControl::supportedSizes() const
         CameraControl *cc = m_service->androidControl();
         if (cc) {
             AalViewfinderSettingsControl *vfControl = const_cast<AalViewfinderSettingsControl*>(this);
-            android_camera_enumerate_supported_preview_sizes(cc,
-                                                             &AalViewfinderSettingsControl::sizeCB,
-                                                             vfControl);
+            HAL_TRACE(android_camera_enumerate_supported_preview_sizes, cc,
+                      &AalViewfinderSettingsControl::sizeCB, vfControl);
         }
     }
 
@@ -159,25 +160,63 @@ void AalViewfinderSettingsControl::setAspectRatio(float ratio)
     setSize(size);
 }
 
+/*!
+ * \brief AalViewfinderSettingsControl::setFrameRate runs the viewfinder at a
+ * frame rate above its normal range, for high frame rate recording. Cameras
+ * only support those at smaller sizes, so the viewfinder size is kept within
+ * maximumSize.
+ * \param fps the frame rate, or 0 to go back to the normal range
+ */
+void AalViewfinderSettingsControl::setFrameRate(int fps, const QSize &maximumSize)
+{
+    if (fps == m_requestedFPS && maximumSize == m_maximumSize)
+        return;
+
+    m_requestedFPS = fps;
+    m_maximumSize = maximumSize;
+
+    CameraControl *cc = m_service->androidControl();
+    if (!cc)
+        return; // will be used on next call of init
+
+    QSize size = m_currentSize;
+    if (m_aspectRatio != 0 || !fitsMaximumSize(size))
+        size = chooseOptimalSize(m_availableSizes);
+    m_currentFPS = m_requestedFPS > 0 ? m_requestedFPS : m_maxFPS;
+
+    bool wasPreviewStarted = m_service->isPreviewStarted();
+    if (wasPreviewStarted) {
+        m_service->stopPreview();
+    }
+    if (size != m_currentSize && !size.isEmpty()) {
+        m_currentSize = size;
+        HAL_TRACE(android_camera_set_preview_size, cc, m_currentSize.width(), m_currentSize.height());
+    }
+    HAL_TRACE(android_camera_set_preview_fps, cc, m_currentFPS);
+    if (wasPreviewStarted) {
+        m_service->startPreview();
+    }
+}
+
 void AalViewfinderSettingsControl::init(CameraControl *control, CameraControlListener *listener)
 {
     Q_UNUSED(listener);
 
     if (m_availableSizes.isEmpty()) {
-        android_camera_enumerate_supported_preview_sizes(control, &AalViewfinderSettingsControl::sizeCB, this);
+        HAL_TRACE(android_camera_enumerate_supported_preview_sizes, control, &AalViewfinderSettingsControl::sizeCB, this);
     }
 
     // Choose optimal resolution based on the current camera's aspect ratio
     if (m_currentSize.isEmpty()) {
         m_currentSize = chooseOptimalSize(m_availableSizes);
     }
-    android_camera_set_preview_size(control, m_currentSize.width(), m_currentSize.height());
+    HAL_TRACE(android_camera_set_preview_size, control, m_currentSize.width(), m_currentSize.height());
 
-    android_camera_get_preview_fps_range(control, &m_minFPS, &m_maxFPS);
+    HAL_TRACE(android_camera_get_preview_fps_range, control, &m_minFPS, &m_maxFPS);
     m_minFPS /= 1000;
     m_maxFPS /= 1000;
-    m_currentFPS = m_maxFPS;
-    android_camera_set_preview_fps(control, m_currentFPS);
+    m_currentFPS = m_requestedFPS > 0 ? m_requestedFPS : m_maxFPS;
+    HAL_TRACE(android_camera_set_preview_fps, control, m_currentFPS);
 }
 
 /*! Resets all data, so a new init starts with a fresh start
@@ -195,24 +234,41 @@ void AalViewfinderSettingsControl::resetAllSettings()
     m_currentFPS = 0;
     m_minFPS = 0;
     m_maxFPS = 0;
+    m_requestedFPS = 0;
+    m_maximumSize = QSize();
 }
 
 void AalViewfinderSettingsControl::sizeCB(void *ctx, int width, int height)
 {
+    halRecordCallback("size_callback", width, height);
     AalViewfinderSettingsControl *self = (AalViewfinderSettingsControl*)ctx;
     self->m_availableSizes.append(QSize(width, height));
 }
 
 QSize AalViewfinderSettingsControl::chooseOptimalSize(const QList<QSize> &sizes) const
 {
-    if (!sizes.empty()) {
+    QList<QSize> candidates;
+    foreach (const QSize &size, sizes) {
+        if (fitsMaximumSize(size))
+            candidates.append(size);
+    }
+
+    if (!candidates.empty()) {
         if (m_aspectRatio == 0) {
             // There are resolutions supported, choose one non-optimal one):
-            return sizes[1];
+            return candidates.size() > 1 ? candidates[1] : candidates[0];
         } else {
-            return m_service->selectSizeWithAspectRatio(sizes, m_aspectRatio);
+            return m_service->selectSizeWithAspectRatio(candidates, m_aspectRatio);
         }
     }
 
     return QSize();
 }
+
+bool AalViewfinderSettingsControl::fitsMaximumSize(const QSize &size) const
+{
+    if (!m_maximumSize.isValid())
+        return true;
+
+    return size.width() <= m_maximumSize.width() && size.height() <= m_maximumSize.height();
+}
@@ -39,6 +39,7 @@ public:
     const QList<QSize> &supportedSizes() const;
 
     void setAspectRatio(float ratio);
+    void setFrameRate(int fps, const QSize &maximumSize = QSize());
 
     void init(CameraControl *control, CameraControlListener *listener);
     void resetAllSettings();
@@ -48,6 +49,7 @@ public:
 private:
     void setSize(const QSize &size);
     QSize chooseOptimalSize(const QList<QSize> &sizes) const;
+    bool fitsMaximumSize(const QSize &size) const;
 
     AalCameraService *m_service;
     QSize m_currentSize;
@@ -56,6 +58,8 @@ private:
     mutable QList<QSize> m_availableSizes;
     int m_minFPS;
     int m_maxFPS;
+    int m_requestedFPS;
+    QSize m_maximumSize;
 };
 
 #endif // AALVIEWFINDERSETTINGSCONTROL_H
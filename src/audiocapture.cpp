@@ -17,65 +17,353 @@
  */
 
 #include "audiocapture.h"
+#include "haltrace.h"
 
-#include <pulse/simple.h>
+#include <pulse/context.h>
 #include <pulse/error.h>
 #include <pulse/sample.h>
+#include <pulse/stream.h>
+#include <pulse/thread-mainloop.h>
 
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
 #include <QDebug>
+#include <QMutexLocker>
 #include <QThread>
+#include <QTimer>
+
+// FIXME: Get these parameters more dynamically from the control
+static const pa_sample_spec sampleSpec = {
+    .format = PA_SAMPLE_S16LE,
+    .rate = 48000,
+    .channels = 1
+};
+
+// About 2.7 seconds of audio. Up to a pipe's worth of it can be spliced and
+// not read yet, the recorder falling further behind is an overrun
+static const int RING_BUFFER_SIZE = 256 * 1024;
+// Pulseaudio delivering nothing for this long while recording is an underrun (msec)
+static const int UNDERRUN_TIMEOUT = 200;
+// How often a writer blocked on the pipe checks whether it should exit (msec)
+static const int PIPE_TIMEOUT = 100;
+
+AudioSyncStatistics::AudioSyncStatistics()
+    : drift(0),
+      maxDrift(0),
+      gaps(0),
+      excesses(0),
+      silenceInserted(0),
+      audioDropped(0)
+{
+}
 
-AudioCapture::AudioCapture(MediaRecorderWrapper *mediaRecorder)
-    : m_paStream(NULL),
+AudioCapture::AudioCapture(QObject *parent)
+    : QObject(parent),
+      m_paMainloop(NULL),
+      m_paContext(NULL),
+      m_paStream(NULL),
+      m_streamReady(0),
+      m_latency(DEFAULT_LATENCY),
+      m_ringBuffer(RING_BUFFER_SIZE),
+      m_pipeWriter(&m_ringBuffer),
+      m_dataEvent(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
       m_audioPipe(-1),
-      m_flagExit(false),
-      m_mediaRecorder(mediaRecorder)
+      m_captureId(0),
+      m_stoppedId(0),
+      m_paused(0),
+      m_overruns(0),
+      m_underruns(0),
+      m_syncCorrection(true),
+      m_syncTolerance(DEFAULT_SYNC_TOLERANCE),
+      m_pausedTime(0),
+      m_queuedBytes(0),
+      m_levelMetering(0),
+      m_mediaRecorder(NULL)
 {
+    if (m_dataEvent < 0)
+        qWarning() << "Failed to create the audio data event: " << strerror(errno);
 }
 
 AudioCapture::~AudioCapture()
 {
-    android_recorder_set_audio_read_cb(m_mediaRecorder, NULL, NULL);
+    detach();
+    closeMicrophoneStream();
+    closePipe();
 
-    if (m_audioPipe >= 0)
-        close(m_audioPipe);
-    if (m_paStream != NULL)
-        pa_simple_free(m_paStream);
+    if (m_dataEvent >= 0)
+        close(m_dataEvent);
 }
 
 /*!
- * \brief Initializes AudioCapture so that it's ready to read microphone data from Pulseaudio
+ * \brief Prepares AudioCapture to feed microphone data to the recording made
+ * by \p mediaRecorder. The Pulseaudio stream is kept across recordings.
  */
-bool AudioCapture::init(RecorderReadAudioCallback callback, void *context)
+bool AudioCapture::init(MediaRecorderWrapper *mediaRecorder, RecorderReadAudioCallback callback, void *context)
 {
+    detach();
+    m_mediaRecorder = mediaRecorder;
+    // A new recording, whose capture run must not be ended by the stopCapture()
+    // of the previous one
+    m_captureId.ref();
+
     // The MediaRecorderLayer will call method (callback) when it's ready to encode a new audio buffer
-    android_recorder_set_audio_read_cb(m_mediaRecorder, callback, context);
+    HAL_TRACE(android_recorder_set_audio_read_cb, m_mediaRecorder, callback, context);
 
     return true;
 }
 
+/*!
+ * \brief Stops feeding the recorder given to init(), before it is released
+ */
+void AudioCapture::detach()
+{
+    if (m_mediaRecorder == NULL)
+        return;
+
+    HAL_TRACE(android_recorder_set_audio_read_cb, m_mediaRecorder, NULL, NULL);
+    m_mediaRecorder = NULL;
+}
+
+/*!
+ * \brief Returns true once the Pulseaudio stream is connected and can be
+ * started without a handshake
+ */
+bool AudioCapture::isStreamReady() const
+{
+    return m_streamReady.load();
+}
+
+/*!
+ * \brief Connects to Pulseaudio unless already connected, and keeps trying
+ * in the background if that fails. Runs on the capture thread.
+ */
+void AudioCapture::connectStream()
+{
+    if (m_streamReady.load())
+        return;
+
+    if (setupMicrophoneStream() != 0) {
+        qWarning() << "Trying to connect to Pulseaudio again in" << RECONNECT_INTERVAL << "msec";
+        QTimer::singleShot(RECONNECT_INTERVAL, this, SLOT(connectStream()));
+    }
+}
+
+/*!
+ * \brief Replaces a connection that Pulseaudio closed, for instance because
+ * the daemon restarted
+ */
+void AudioCapture::reconnect()
+{
+    closeMicrophoneStream();
+    connectStream();
+}
+
+/*!
+ * \brief Called on the Pulseaudio thread when a connected context or stream
+ * fails. Reconnecting is left to the capture thread, once it is idle.
+ */
+void AudioCapture::connectionLost()
+{
+    if (m_streamReady.testAndSetOrdered(1, 0)) {
+        qWarning() << "Lost the connection to Pulseaudio, reconnecting";
+        QMetaObject::invokeMethod(this, "reconnect", Qt::QueuedConnection);
+    }
+}
+
 /*!
  * \brief Stops the microphone data capture thread loop
  */
 void AudioCapture::stopCapture()
 {
     qDebug() << __PRETTY_FUNCTION__;
-    m_flagExit = true;
+    m_stoppedId.store(m_captureId.load());
+    notifyWriter();
+}
+
+/*!
+ * \brief Stops handing microphone data to the recorder, without closing the
+ * Pulseaudio stream
+ */
+void AudioCapture::pauseCapture()
+{
+    lockMainloop();
+    if (!m_paused.load())
+        m_pauseClock.start();
+    m_paused.store(1);
+    unlockMainloop();
+}
+
+/*!
+ * \brief Hands microphone data to the recorder again after pauseCapture()
+ */
+void AudioCapture::resumeCapture()
+{
+    lockMainloop();
+    // The recorder doesn't count the pause, neither does the sync clock
+    if (m_pauseClock.isValid()) {
+        m_pausedTime += m_pauseClock.nsecsElapsed() / 1000;
+        m_pauseClock.invalidate();
+    }
+    m_paused.store(0);
+    unlockMainloop();
+}
+
+/*!
+ * \brief Sets the size of the fragments Pulseaudio delivers, in microseconds.
+ * Smaller fragments keep audio closer to video, bigger ones wake up less often
+ */
+void AudioCapture::setLatency(int latency)
+{
+    if (latency <= 0 || latency == m_latency)
+        return;
+
+    lockMainloop();
+    m_latency = latency;
+    const pa_buffer_attr *currentAttr = m_paStream ? pa_stream_get_buffer_attr(m_paStream) : NULL;
+    if (currentAttr != NULL) {
+        pa_buffer_attr bufferAttr = *currentAttr;
+        bufferAttr.fragsize = pa_usec_to_bytes(m_latency, &sampleSpec);
+        pa_operation *operation = pa_stream_set_buffer_attr(m_paStream, &bufferAttr, NULL, NULL);
+        if (operation != NULL)
+            pa_operation_unref(operation);
+    }
+    unlockMainloop();
+}
+
+int AudioCapture::latency() const
+{
+    return m_latency;
 }
 
 /*!
- * \brief The main microphone reader/writer loop. Reads from Pulseaudio, writes to named pipe
+ * \brief Sets whether drift beyond syncTolerance() is corrected, by inserting
+ * silence when the audio falls behind the clock and dropping microphone data
+ * when it runs ahead. Drift is measured either way.
+ */
+void AudioCapture::setSyncCorrection(bool enabled)
+{
+    lockMainloop();
+    m_syncCorrection = enabled;
+    unlockMainloop();
+}
+
+bool AudioCapture::syncCorrection() const
+{
+    return m_syncCorrection;
+}
+
+/*!
+ * \brief Sets the drift allowed between the audio and the clock, in microseconds
+ */
+void AudioCapture::setSyncTolerance(int tolerance)
+{
+    lockMainloop();
+    m_syncTolerance = qMax(tolerance, 0);
+    unlockMainloop();
+}
+
+int AudioCapture::syncTolerance() const
+{
+    return m_syncTolerance;
+}
+
+/*!
+ * \brief Number of times microphone data was dropped because Pulseaudio or the
+ * ring buffer filled up before the recorder read it
+ */
+int AudioCapture::overruns() const
+{
+    return m_overruns.load();
+}
+
+/*!
+ * \brief Number of times the recorder waited for microphone data that did not come
+ */
+int AudioCapture::underruns() const
+{
+    return m_underruns.load();
+}
+
+/*!
+ * \brief Number of bytes read from the microphone and not yet read by the recorder
+ */
+int AudioCapture::bytesInFlight() const
+{
+    return m_ringBuffer.available();
+}
+
+AudioSyncStatistics AudioCapture::syncStatistics() const
+{
+    lockMainloop();
+    AudioSyncStatistics statistics = m_syncStatistics;
+    unlockMainloop();
+    return statistics;
+}
+
+/*!
+ * \brief Enables measuring the peak and RMS level of the microphone data, for
+ * a live level display. It is off by default.
+ */
+void AudioCapture::setLevelMetering(bool enabled)
+{
+    m_levelMetering.store(enabled ? 1 : 0);
+    if (!enabled)
+        resetLevels();
+}
+
+bool AudioCapture::levelMetering() const
+{
+    return m_levelMetering.load();
+}
+
+/*!
+ * \brief Number of channels captured from the microphone
+ */
+int AudioCapture::channelCount() const
+{
+    return sampleSpec.channels;
+}
+
+/*!
+ * \brief Level of \p channel in the latest fragment of microphone data, or
+ * silence when level metering is off or no data is flowing. Can be called from
+ * any thread.
+ */
+AudioLevel AudioCapture::level(int channel) const
+{
+    AudioLevel level;
+    if (channel < 0 || channel >= channelCount())
+        return level;
+
+    const quint32 packed = m_levels[channel].load();
+    level.peak = qreal(packed & 0xffff) / 0xffff;
+    level.rms = qreal(packed >> 16) / 0xffff;
+    return level;
+}
+
+/*!
+ * \brief The pipe writer loop. Pulseaudio fills the ring buffer from its own
+ * thread, this splices it into the named pipe until stopCapture() is called.
+ * A slow reader only delays the writer, and a short write is retried instead
+ * of ending the capture.
  */
 void AudioCapture::run()
 {
-    m_flagExit = false;
-    qDebug() << __PRETTY_FUNCTION__;
+    // Stopped before the recorder asked for audio
+    const int captureId = m_captureId.load();
+    if (isStopped(captureId))
+        return;
 
-    int bytesWritten = 0, bytesRead = 0;
-    const size_t readSize = sizeof(m_audioBuf);
+    m_paused.store(0);
+    m_overruns.store(0);
+    m_underruns.store(0);
+    qDebug() << __PRETTY_FUNCTION__;
 
     if (!setupPipe())
     {
@@ -83,87 +371,306 @@ void AudioCapture::run()
         return;
     }
 
-    // To reduce latency, try to flush samples not read before this function is called.
-    {
-        int ret = 0, error = 0;
-        ret = pa_simple_flush(m_paStream, &error);
-        if (ret < 0) {
-            qWarning() << "Failed to flush sample not read before run(): " << pa_strerror(error)
-                       << " (but continuing anyway).";
+    // A reader going away must end the loop with EPIPE, not kill the process
+    sigset_t pipeSignal;
+    sigemptyset(&pipeSignal);
+    sigaddset(&pipeSignal, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipeSignal, NULL);
+
+    startMicrophoneStream();
+
+    while (!isStopped(captureId)) {
+        if (m_pipeWriter.unwritten() == 0) {
+            if (!waitForData(UNDERRUN_TIMEOUT) && !m_paused.load() && !isStopped(captureId))
+                m_underruns.ref();
+            continue;
+        }
+
+        ssize_t num = m_pipeWriter.write();
+        if (num < 0) {
+            qWarning() << "Failed to write to /dev/socket/micshm: " << strerror(errno) << " (" << errno << ")";
+            break;
+        } else if (num == 0) {
+            // The recorder is behind, the ring buffer absorbs it meanwhile
+            waitForPipe(PIPE_TIMEOUT);
+        }
+    }
+
+    // Stay connected for the next recording, but let the microphone go idle
+    stopMicrophoneStream();
+    resetLevels();
+    closePipe();
+
+    qDebug() << "Audio capture finished with" << m_overruns.load() << "overruns,"
+             << m_underruns.load() << "underruns," << bytesInFlight() << "bytes in flight";
+    const AudioSyncStatistics statistics = syncStatistics();
+    qDebug() << "Audio drift" << statistics.drift << "usec, max" << statistics.maxDrift
+             << "usec," << statistics.silenceInserted << "usec of silence inserted,"
+             << statistics.audioDropped << "usec of audio dropped";
+}
+
+/*!
+ * \brief Returns true once stopCapture() was called for the recording
+ * \p captureId belongs to
+ */
+bool AudioCapture::isStopped(int captureId) const
+{
+    return m_stoppedId.load() - captureId >= 0;
+}
+
+void AudioCapture::contextStateCallback(pa_context *context, void *userdata)
+{
+    AudioCapture *self = static_cast<AudioCapture*>(userdata);
+    if (!PA_CONTEXT_IS_GOOD(pa_context_get_state(context)))
+        self->connectionLost();
+    pa_threaded_mainloop_signal(self->m_paMainloop, 0);
+}
+
+void AudioCapture::streamStateCallback(pa_stream *stream, void *userdata)
+{
+    AudioCapture *self = static_cast<AudioCapture*>(userdata);
+    if (!PA_STREAM_IS_GOOD(pa_stream_get_state(stream)))
+        self->connectionLost();
+    pa_threaded_mainloop_signal(self->m_paMainloop, 0);
+}
+
+void AudioCapture::streamReadCallback(pa_stream *stream, size_t length, void *userdata)
+{
+    Q_UNUSED(length);
+    static_cast<AudioCapture*>(userdata)->readMicrophone(stream);
+}
+
+void AudioCapture::streamOverflowCallback(pa_stream *stream, void *userdata)
+{
+    Q_UNUSED(stream);
+    static_cast<AudioCapture*>(userdata)->m_overruns.ref();
+}
+
+/*!
+ * \brief Moves microphone data from Pulseaudio into the ring buffer. Runs on
+ * the Pulseaudio thread and never blocks.
+ */
+void AudioCapture::readMicrophone(pa_stream *stream)
+{
+    bool queued = false;
+
+    while (pa_stream_readable_size(stream) > 0) {
+        const void *data = NULL;
+        size_t size = 0;
+        if (pa_stream_peek(stream, &data, &size) < 0) {
+            qWarning() << "Failed to read audio from the microphone: "
+                       << pa_strerror(pa_context_errno(m_paContext));
+            break;
+        }
+        if (size == 0)
+            break;
+
+        if (data != NULL && m_levelMetering.load())
+            meterSamples(static_cast<const char*>(data), size);
+
+        // A paused recorder doesn't read the pipe. Keep draining the stream
+        // so it doesn't overrun, and so resuming doesn't deliver stale samples.
+        // A hole (no data) is dropped as well, the sync clock fills the gap.
+        if (data != NULL && !m_paused.load()) {
+            queueSamples(static_cast<const char*>(data), size);
+            queued = true;
         }
+
+        pa_stream_drop(stream);
+    }
+
+    if (queued)
+        notifyWriter();
+}
+
+/*!
+ * \brief Measures the level of a fragment of microphone data and publishes it
+ * for level(). Runs on the Pulseaudio thread.
+ */
+void AudioCapture::meterSamples(const char *data, size_t size)
+{
+    const int channels = qMin(int(sampleSpec.channels), int(AudioLevelMeter::MAX_CHANNELS));
+    const int frames = size / pa_frame_size(&sampleSpec);
+    if (frames == 0)
+        return;
+
+    AudioLevel levels[AudioLevelMeter::MAX_CHANNELS];
+    AudioLevelMeter::measure(reinterpret_cast<const int16_t*>(data), frames, channels, levels);
+    for (int c = 0; c < channels; ++c) {
+        const quint32 peak = qRound(levels[c].peak * 0xffff);
+        const quint32 rms = qRound(levels[c].rms * 0xffff);
+        m_levels[c].store(int(peak | (rms << 16)));
     }
+}
 
-    do {
-        bytesRead = readMicrophone();
-        if (bytesRead > 0)
-        {
-            bytesWritten = writeDataToPipe();
+void AudioCapture::resetLevels()
+{
+    for (int c = 0; c < AudioLevelMeter::MAX_CHANNELS; ++c)
+        m_levels[c].store(0);
+}
+
+/*!
+ * \brief Queues a fragment of microphone data which has just been captured,
+ * after comparing the amount of audio queued since recording started with
+ * the time elapsed. Runs on the Pulseaudio thread.
+ */
+void AudioCapture::queueSamples(const char *data, size_t size)
+{
+    qint64 drift = qint64(pa_bytes_to_usec(m_queuedBytes + size, &sampleSpec)) - elapsedSinceStart();
+    if (qAbs(drift) > qAbs(m_syncStatistics.maxDrift))
+        m_syncStatistics.maxDrift = drift;
+
+    if (drift < -m_syncTolerance) {
+        m_syncStatistics.gaps++;
+        if (m_syncCorrection) {
+            const int inserted = queueSilence(pa_usec_to_bytes(-drift, &sampleSpec));
+            m_queuedBytes += inserted;
+            m_syncStatistics.silenceInserted += qint64(pa_bytes_to_usec(inserted, &sampleSpec));
+            drift += qint64(pa_bytes_to_usec(inserted, &sampleSpec));
         }
-    } while (bytesRead == readSize
-                && bytesWritten == readSize
-                && !m_flagExit);
+    } else if (drift > m_syncTolerance) {
+        m_syncStatistics.excesses++;
+        if (m_syncCorrection) {
+            const size_t dropped = qMin(size_t(pa_usec_to_bytes(drift, &sampleSpec)), size);
+            data += dropped;
+            size -= dropped;
+            m_syncStatistics.audioDropped += qint64(pa_bytes_to_usec(dropped, &sampleSpec));
+            drift -= qint64(pa_bytes_to_usec(dropped, &sampleSpec));
+        }
+    }
 
-    // Make sure that Pulse stops reading the microphone when recording stops
-    if (m_paStream != NULL)
-    {
-        pa_simple_free(m_paStream);
-        m_paStream = NULL;
+    const int written = m_ringBuffer.write(data, size);
+    if (written < int(size)) {
+        m_overruns.ref();
+        drift -= qint64(pa_bytes_to_usec(size - written, &sampleSpec));
+    }
+    m_queuedBytes += written;
+    m_syncStatistics.drift = drift;
+}
+
+/*!
+ * \brief Queues \p size bytes of silence, as much as the ring buffer takes
+ * \return the number of bytes queued
+ */
+int AudioCapture::queueSilence(size_t size)
+{
+    static const char silence[4096] = { 0 };
+    int queued = 0;
+
+    while (size > 0) {
+        const int count = m_ringBuffer.write(silence, qMin(size, sizeof(silence)));
+        if (count == 0)
+            break;
+        queued += count;
+        size -= count;
     }
+    return queued;
+}
+
+/*!
+ * \brief Time recorded since run() started, not counting pauses, in microseconds
+ */
+qint64 AudioCapture::elapsedSinceStart() const
+{
+    return m_syncClock.nsecsElapsed() / 1000 - m_pausedTime;
 }
 
 /*!
- * \brief Reads microphone data from Pulseaudio
+ * \brief Locks the Pulseaudio mainloop, if connected, from any thread. The
+ * mainloop can't go away while locked, even when reconnecting.
  */
-int AudioCapture::readMicrophone()
+void AudioCapture::lockMainloop() const
 {
-    int ret = 0, error = 0;
-    const size_t readSize = sizeof(m_audioBuf);
-    ret = pa_simple_read(m_paStream, m_audioBuf, readSize, &error);
-    if (ret < 0)
-        qWarning() << "Failed to read audio from the microphone: " << pa_strerror(error);
-    else
-        ret = readSize;
+    m_mainloopMutex.lock();
+    if (m_paMainloop != NULL)
+        pa_threaded_mainloop_lock(m_paMainloop);
+}
 
-    return ret;
+void AudioCapture::unlockMainloop() const
+{
+    if (m_paMainloop != NULL)
+        pa_threaded_mainloop_unlock(m_paMainloop);
+    m_mainloopMutex.unlock();
 }
 
 /*!
- * \brief Sets up the Pulseaudio microphone input channel
+ * \brief Sets up the Pulseaudio microphone input channel. The stream is
+ * created corked and only delivers data while run() is active.
  */
 int AudioCapture::setupMicrophoneStream()
 {
-    // FIXME: Get these parameters more dynamically from the control
-    static const pa_sample_spec ss = {
-        .format = PA_SAMPLE_S16LE,
-        .rate = 48000,
-        .channels = 1
-    };
+    if (m_streamReady.load())
+        return 0;
 
     /*
-     * On some device, it can take some time between pa_simple_new() below and
-     * first pa_simple_read(). By setting these buffer attributes, we try to
-     * make PulseAudio drop (initially) unread samples. Otherwise, we'll get
-     * those samples and write them into /dev/socket/micshm, which expects
-     * (roughly) realtime audio. This causes A/V desync as those extra samples
-     * will advance /dev/socket/micshm's internal timestamp ahead.
-     *
-     * I actually want to set PA_STREAM_ADJUST_LATENCY to the stream, but it
-     * seems to be impossible with PA's simple API.
+     * Limit what Pulseaudio keeps for us. Anything older than this is stale
+     * and would advance /dev/socket/micshm's internal timestamp ahead of the
+     * video, causing A/V desync.
      */
-    static const pa_buffer_attr buf_attr = {
-        .maxlength = pa_usec_to_bytes(100000 /* 100 msec */, &ss),
-        .tlength = (uint32_t) -1,
-        .prebuf = (uint32_t) -1,
-        .minreq = (uint32_t) -1,
-        .fragsize = pa_usec_to_bytes(100000 /* 100 msec */, &ss)
-    };
+    pa_buffer_attr bufferAttr;
+    bufferAttr.maxlength = pa_usec_to_bytes(100000 /* 100 msec */, &sampleSpec);
+    bufferAttr.tlength = (uint32_t) -1;
+    bufferAttr.prebuf = (uint32_t) -1;
+    bufferAttr.minreq = (uint32_t) -1;
+    bufferAttr.fragsize = pa_usec_to_bytes(m_latency, &sampleSpec);
 
-    int error = 0;
+    int error = PA_OK;
 
-    m_paStream = pa_simple_new(NULL, "qtubuntu-camera", PA_STREAM_RECORD, NULL, "record", &ss, NULL, &buf_attr, &error);
-    if (m_paStream == NULL)
+    {
+        QMutexLocker locker(&m_mainloopMutex);
+        m_paMainloop = pa_threaded_mainloop_new();
+    }
+    if (m_paMainloop == NULL || pa_threaded_mainloop_start(m_paMainloop) < 0) {
+        qWarning() << "Failed to start the Pulseaudio mainloop";
+        closeMicrophoneStream();
+        return AUDIO_CAPTURE_GENERAL_ERROR;
+    }
+
+    pa_threaded_mainloop_lock(m_paMainloop);
+
+    m_paContext = pa_context_new(pa_threaded_mainloop_get_api(m_paMainloop), "qtubuntu-camera");
+    pa_context_set_state_callback(m_paContext, &AudioCapture::contextStateCallback, this);
+    if (pa_context_connect(m_paContext, NULL, PA_CONTEXT_NOFLAGS, NULL) < 0) {
+        error = pa_context_errno(m_paContext);
+    } else {
+        pa_context_state_t state;
+        while ((state = pa_context_get_state(m_paContext)) != PA_CONTEXT_READY) {
+            if (!PA_CONTEXT_IS_GOOD(state)) {
+                error = pa_context_errno(m_paContext);
+                break;
+            }
+            pa_threaded_mainloop_wait(m_paMainloop);
+        }
+    }
+
+    if (error == PA_OK) {
+        m_paStream = pa_stream_new(m_paContext, "record", &sampleSpec, NULL);
+        pa_stream_set_state_callback(m_paStream, &AudioCapture::streamStateCallback, this);
+        pa_stream_set_read_callback(m_paStream, &AudioCapture::streamReadCallback, this);
+        pa_stream_set_overflow_callback(m_paStream, &AudioCapture::streamOverflowCallback, this);
+
+        const pa_stream_flags_t flags = (pa_stream_flags_t)
+                (PA_STREAM_ADJUST_LATENCY | PA_STREAM_START_CORKED);
+        if (pa_stream_connect_record(m_paStream, NULL, &bufferAttr, flags) < 0) {
+            error = pa_context_errno(m_paContext);
+        } else {
+            pa_stream_state_t state;
+            while ((state = pa_stream_get_state(m_paStream)) != PA_STREAM_READY) {
+                if (!PA_STREAM_IS_GOOD(state)) {
+                    error = pa_context_errno(m_paContext);
+                    break;
+                }
+                pa_threaded_mainloop_wait(m_paMainloop);
+            }
+        }
+    }
+
+    pa_threaded_mainloop_unlock(m_paMainloop);
+
+    if (error != PA_OK)
     {
         qWarning() << "Failed to open a PulseAudio channel to read the microphone: " << pa_strerror(error);
+        closeMicrophoneStream();
         if (error == PA_ERR_TIMEOUT) {
             return AUDIO_CAPTURE_TIMEOUT_ERROR;
         } else {
@@ -171,9 +678,80 @@ int AudioCapture::setupMicrophoneStream()
         }
     }
 
+    m_streamReady.store(1);
     return 0;
 }
 
+/*!
+ * \brief Drops whatever the microphone picked up before recording started,
+ * starts the sync clock and uncorks the stream
+ */
+void AudioCapture::startMicrophoneStream()
+{
+    m_ringBuffer.clear();
+    if (m_paStream == NULL)
+        return;
+
+    pa_threaded_mainloop_lock(m_paMainloop);
+    // Recording starts now, audio arriving later than this is a late start
+    m_syncClock.start();
+    m_pauseClock.invalidate();
+    m_pausedTime = 0;
+    m_queuedBytes = 0;
+    m_syncStatistics = AudioSyncStatistics();
+    pa_operation *operation = pa_stream_flush(m_paStream, NULL, NULL);
+    if (operation != NULL)
+        pa_operation_unref(operation);
+    operation = pa_stream_cork(m_paStream, 0, NULL, NULL);
+    if (operation != NULL)
+        pa_operation_unref(operation);
+    pa_threaded_mainloop_unlock(m_paMainloop);
+}
+
+/*!
+ * \brief Corks the stream between recordings. Pulseaudio can then suspend
+ * the microphone while the connection is kept for the next recording.
+ */
+void AudioCapture::stopMicrophoneStream()
+{
+    if (m_paStream == NULL)
+        return;
+
+    pa_threaded_mainloop_lock(m_paMainloop);
+    pa_operation *operation = pa_stream_cork(m_paStream, 1, NULL, NULL);
+    if (operation != NULL)
+        pa_operation_unref(operation);
+    pa_threaded_mainloop_unlock(m_paMainloop);
+}
+
+/*!
+ * \brief Disconnects from Pulseaudio and stops its thread
+ */
+void AudioCapture::closeMicrophoneStream()
+{
+    QMutexLocker locker(&m_mainloopMutex);
+    m_streamReady.store(0);
+    if (m_paMainloop == NULL)
+        return;
+
+    pa_threaded_mainloop_lock(m_paMainloop);
+    if (m_paStream != NULL) {
+        pa_stream_disconnect(m_paStream);
+        pa_stream_unref(m_paStream);
+        m_paStream = NULL;
+    }
+    if (m_paContext != NULL) {
+        pa_context_disconnect(m_paContext);
+        pa_context_unref(m_paContext);
+        m_paContext = NULL;
+    }
+    pa_threaded_mainloop_unlock(m_paMainloop);
+
+    pa_threaded_mainloop_stop(m_paMainloop);
+    pa_threaded_mainloop_free(m_paMainloop);
+    m_paMainloop = NULL;
+}
+
 /*!
  * \brief Opens the named pipe /dev/socket/micshm for writing mic data to the Android (reader) side
  */
@@ -185,66 +763,78 @@ bool AudioCapture::setupPipe()
         return true;
     }
 
-    // Open the named pipe for writing only
+    // Open the named pipe for writing only. This blocks until the reader side
+    // is open, writes must not block after that.
     m_audioPipe = open("/dev/socket/micshm", O_WRONLY);
     if (m_audioPipe < 0)
     {
         qWarning() << "Failed to open audio data pipe /dev/socket/micshm: " << strerror(errno);
         return false;
     }
+    fcntl(m_audioPipe, F_SETFL, fcntl(m_audioPipe, F_GETFL) | O_NONBLOCK);
+    m_pipeWriter.setPipe(m_audioPipe);
 
     return true;
 }
 
 /*!
- * \brief Writes mic data to the named pipe /dev/socket/micshm
+ * \brief Closes /dev/socket/micshm, each recording opens it again
  */
-int AudioCapture::writeDataToPipe()
+void AudioCapture::closePipe()
 {
-    // Don't open the named pipe twice
-    if (m_audioPipe < 0 && !setupPipe())
-    {
-        qWarning() << "Failed to open /dev/socket/micshm, cannot write data to pipe";
-        return 0;
-    }
-
-    int num = 0;
-    const size_t writeSize = sizeof(m_audioBuf);
-    num = loopWrite(m_audioPipe, m_audioBuf, writeSize);
-    if (num != writeSize)
-        qWarning() << "Failed to write " << num << " bytes to /dev/socket/micshm: " << strerror(errno) << " (" << errno << ")";
+    if (m_audioPipe < 0)
+        return;
 
-    return num;
+    close(m_audioPipe);
+    m_audioPipe = -1;
+    m_pipeWriter.setPipe(-1);
 }
 
-ssize_t AudioCapture::loopWrite(int fd, const void *data, size_t size)
+/*!
+ * \brief Wakes up the writer loop in run()
+ */
+void AudioCapture::notifyWriter()
 {
-    ssize_t ret = 0;
-    fd_set set;
-    struct timeval tv;
-
-    tv.tv_sec = 1;
-    tv.tv_usec = 0;
+    const uint64_t one = 1;
+    if (m_dataEvent >= 0 && write(m_dataEvent, &one, sizeof(one)) < 0 && errno != EAGAIN)
+        qWarning() << "Failed to signal audio data: " << strerror(errno);
+}
 
-    while (size > 0)
-    {
-        ssize_t r;
+/*!
+ * \brief Waits up to \p timeout msec for new microphone data or stopCapture()
+ * \return false if the wait timed out
+ */
+bool AudioCapture::waitForData(int timeout)
+{
+    struct pollfd event = { m_dataEvent, POLLIN, 0 };
+    int n = poll(&event, 1, timeout);
+    if (n <= 0)
+        return false;
 
-        FD_ZERO(&set);
-        FD_SET(fd, &set);
+    uint64_t count;
+    if (read(m_dataEvent, &count, sizeof(count)) < 0 && errno != EAGAIN)
+        qWarning() << "Failed to read the audio data event: " << strerror(errno);
+    return true;
+}
 
-        int n = select(fd+1, NULL, &set, NULL, &tv);
+/*!
+ * \brief Waits up to \p timeout msec for the pipe to accept data, or for stopCapture()
+ * \return false if the pipe is still full
+ */
+bool AudioCapture::waitForPipe(int timeout)
+{
+    struct pollfd fds[2] = {
+        { m_audioPipe, POLLOUT, 0 },
+        { m_dataEvent, POLLIN, 0 }
+    };
+    int n = poll(fds, 2, timeout);
+    if (n <= 0)
+        return false;
 
-        if (!n || n == -1 || m_flagExit)
-            break;
+    // Consume the event, new data doesn't help while the pipe is full
+    uint64_t count;
+    if ((fds[1].revents & POLLIN) && read(m_dataEvent, &count, sizeof(count)) < 0 && errno != EAGAIN)
+        qWarning() << "Failed to read the audio data event: " << strerror(errno);
 
-        if ((r = write(fd, data, size)) < 0)
-            return r;
-        if (r == 0)
-            break;
-        ret += r;
-        data = (const int16_t*) data + r;
-        size -= (size_t) r;
-    }
-    return ret;
+    return fds[0].revents & (POLLOUT | POLLERR | POLLHUP);
 }
@@ -19,16 +19,51 @@
 #ifndef AUDIOCAPTURE_H
 #define AUDIOCAPTURE_H
 
+#include "audiolevelmeter.h"
+#include "audiopipewriter.h"
+#include "audioringbuffer.h"
+
 #include <hybris/media/media_recorder_layer.h>
 
 #include <stdint.h>
+#include <sys/types.h>
 
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMutex>
 #include <QObject>
 
 class AalMediaRecorderControl;
 struct MediaRecorderWrapper;
 
-struct pa_simple;
+struct pa_context;
+struct pa_stream;
+struct pa_threaded_mainloop;
+
+/*!
+ * \brief The AudioSyncStatistics class describes how well the microphone data
+ * handed to the recorder keeps up with the clock since recording started.
+ * All durations are in microseconds.
+ */
+class AudioSyncStatistics
+{
+public:
+    AudioSyncStatistics();
+    /// Audio duration minus elapsed time after the last correction,
+    /// positive when the audio runs ahead of the clock
+    qint64 drift;
+    /// Largest drift seen, before correcting it
+    qint64 maxDrift;
+    /// Times the audio fell behind by more than the tolerance, because of a
+    /// late start, a gap in the microphone data or an overrun
+    int gaps;
+    /// Times the audio got ahead by more than the tolerance
+    int excesses;
+    /// Silence inserted to catch up with the clock
+    qint64 silenceInserted;
+    /// Microphone data dropped to fall back to the clock
+    qint64 audioDropped;
+};
 
 class AudioCapture : public QObject
 {
@@ -38,29 +73,111 @@ class AudioCapture : public QObject
 public:
     static const int AUDIO_CAPTURE_GENERAL_ERROR = -1;
     static const int AUDIO_CAPTURE_TIMEOUT_ERROR = -2;
+    /* Default size of the fragments Pulseaudio delivers, in microseconds */
+    static const int DEFAULT_LATENCY = 20000;
+    /* Default drift allowed before correcting it, in microseconds */
+    static const int DEFAULT_SYNC_TOLERANCE = 60000;
+    /* Delay between attempts to connect to Pulseaudio, in milliseconds */
+    static const int RECONNECT_INTERVAL = 2000;
 
-    explicit AudioCapture(MediaRecorderWrapper *mediaRecorder);
+    explicit AudioCapture(QObject *parent = 0);
     ~AudioCapture();
 
-    bool init(RecorderReadAudioCallback callback, void *context);
+    bool init(MediaRecorderWrapper *mediaRecorder, RecorderReadAudioCallback callback, void *context);
+    void detach();
     /* Terminates the Pulseaudio reader/writer QThread */
     int setupMicrophoneStream();
+    bool isStreamReady() const;
     void stopCapture();
+    void pauseCapture();
+    void resumeCapture();
+
+    void setLatency(int latency);
+    int latency() const;
+
+    void setSyncCorrection(bool enabled);
+    bool syncCorrection() const;
+    void setSyncTolerance(int tolerance);
+    int syncTolerance() const;
+
+    int overruns() const;
+    int underruns() const;
+    int bytesInFlight() const;
+    AudioSyncStatistics syncStatistics() const;
+
+    void setLevelMetering(bool enabled);
+    bool levelMetering() const;
+    int channelCount() const;
+    AudioLevel level(int channel = 0) const;
 
 public Q_SLOTS:
     void run();
+    void connectStream();
+
+private Q_SLOTS:
+    void reconnect();
 
 private:
-    int readMicrophone();
+    static void contextStateCallback(pa_context *context, void *userdata);
+    static void streamStateCallback(pa_stream *stream, void *userdata);
+    static void streamReadCallback(pa_stream *stream, size_t length, void *userdata);
+    static void streamOverflowCallback(pa_stream *stream, void *userdata);
+
+    void readMicrophone(pa_stream *stream);
+    void meterSamples(const char *data, size_t size);
+    void resetLevels();
+    void queueSamples(const char *data, size_t size);
+    int queueSilence(size_t size);
+    qint64 elapsedSinceStart() const;
+    void lockMainloop() const;
+    void unlockMainloop() const;
+    void startMicrophoneStream();
+    void stopMicrophoneStream();
+    void closeMicrophoneStream();
+    void connectionLost();
+    bool isStopped(int captureId) const;
     bool setupPipe();
-    ssize_t loopWrite(int fd, const void *data, size_t len);
-    int writeDataToPipe();
+    void closePipe();
+    void notifyWriter();
+    bool waitForData(int timeout);
+    bool waitForPipe(int timeout);
 
-    pa_simple *m_paStream;
-    int16_t m_audioBuf[MIC_READ_BUF_SIZE];
+    // Held by other threads while using the mainloop, so that reconnecting
+    // doesn't free it under them
+    mutable QMutex m_mainloopMutex;
+    pa_threaded_mainloop *m_paMainloop;
+    pa_context *m_paContext;
+    pa_stream *m_paStream;
+    QAtomicInt m_streamReady;
+    int m_latency;
+
+    // Filled by the Pulseaudio thread, drained into the pipe by run()
+    AudioRingBuffer m_ringBuffer;
+    AudioPipeWriter m_pipeWriter;
+    int m_dataEvent;
 
     int m_audioPipe;
-    bool m_flagExit;
+    // Each recording gets an id from init(), stopCapture() stops the run serving it
+    QAtomicInt m_captureId;
+    QAtomicInt m_stoppedId;
+    QAtomicInt m_paused;
+    QAtomicInt m_overruns;
+    QAtomicInt m_underruns;
+
+    // A/V sync state, protected by the Pulseaudio mainloop lock
+    bool m_syncCorrection;
+    int m_syncTolerance;
+    QElapsedTimer m_syncClock;
+    QElapsedTimer m_pauseClock;
+    qint64 m_pausedTime;
+    qint64 m_queuedBytes;
+    AudioSyncStatistics m_syncStatistics;
+
+    // Latest level of each channel, written by the Pulseaudio thread. The peak
+    // and RMS are packed as 16 bit fractions of full scale, so that readers
+    // always see a matching pair without taking a lock.
+    QAtomicInt m_levelMetering;
+    QAtomicInt m_levels[AudioLevelMeter::MAX_CHANNELS];
     MediaRecorderWrapper *m_mediaRecorder;
 };
 
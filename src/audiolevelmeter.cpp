@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "audiolevelmeter.h"
+
+#include <qmath.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define AUDIO_LEVEL_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define AUDIO_LEVEL_SSE2
+#endif
+
+AudioLevel::AudioLevel()
+    : peak(0),
+      rms(0)
+{
+}
+
+/*!
+ * \brief AudioLevelMeter::measure computes the level of each of the \p channels
+ * of \p frames interleaved frames into \p levels, which must hold \p channels
+ * entries
+ */
+void AudioLevelMeter::measure(const int16_t *samples, int frames, int channels, AudioLevel *levels)
+{
+    if (channels <= 0 || channels > MAX_CHANNELS)
+        return;
+
+    int peaks[MAX_CHANNELS] = { 0 };
+    qint64 sumsOfSquares[MAX_CHANNELS] = { 0 };
+    accumulate(samples, frames, channels, peaks, sumsOfSquares);
+
+    for (int c = 0; c < channels; ++c) {
+        levels[c].peak = qreal(peaks[c]) / FULL_SCALE;
+        levels[c].rms = frames > 0
+                ? qMin(qSqrt(qreal(sumsOfSquares[c]) / frames) / FULL_SCALE, qreal(1))
+                : 0;
+    }
+}
+
+/*!
+ * \brief AudioLevelMeter::accumulate raises \p peaks to the highest absolute
+ * sample value of each channel and adds the squared samples to \p sumsOfSquares,
+ * so that several blocks can be measured as one. Absolute values saturate at
+ * full scale.
+ */
+void AudioLevelMeter::accumulate(const int16_t *samples, int frames, int channels,
+                                 int *peaks, qint64 *sumsOfSquares)
+{
+    if (samples == 0 || frames <= 0 || channels <= 0 || channels > MAX_CHANNELS)
+        return;
+
+    const int count = frames * channels;
+    int i = accumulateVector(samples, count, channels, peaks, sumsOfSquares);
+
+    // The vector loop consumes whole frames, so the tail starts on channel 0
+    for (int c = 0; i < count; ++i) {
+        const int sample = samples[i];
+        peaks[c] = qMax(peaks[c], qMin(qAbs(sample), int(FULL_SCALE)));
+        sumsOfSquares[c] += sample * sample;
+        if (++c == channels)
+            c = 0;
+    }
+}
+
+/*!
+ * \brief AudioLevelMeter::accumulateVector processes the samples eight at a
+ * time when the channel count divides the vector width, keeping a peak and
+ * 64 bit sum per lane which are folded into the channels at the end.
+ * \return the number of samples processed
+ */
+int AudioLevelMeter::accumulateVector(const int16_t *samples, int count, int channels,
+                                      int *peaks, qint64 *sumsOfSquares)
+{
+#if defined(AUDIO_LEVEL_NEON) || defined(AUDIO_LEVEL_SSE2)
+    const int LANES = 8;
+    if (LANES % channels != 0 || count < LANES)
+        return 0;
+
+    int16_t lanePeaks[LANES];
+    int64_t laneSums[LANES];
+    int i = 0;
+
+#if defined(AUDIO_LEVEL_NEON)
+    int16x8_t peak = vdupq_n_s16(0);
+    int64x2_t sum01 = vdupq_n_s64(0);
+    int64x2_t sum23 = vdupq_n_s64(0);
+    int64x2_t sum45 = vdupq_n_s64(0);
+    int64x2_t sum67 = vdupq_n_s64(0);
+
+    for (; i + LANES <= count; i += LANES) {
+        const int16x8_t x = vld1q_s16(samples + i);
+        peak = vmaxq_s16(peak, vqabsq_s16(x));
+
+        // Each square fits in 32 bits, the running sums need 64
+        const int32x4_t low = vmull_s16(vget_low_s16(x), vget_low_s16(x));
+        const int32x4_t high = vmull_s16(vget_high_s16(x), vget_high_s16(x));
+        sum01 = vaddw_s32(sum01, vget_low_s32(low));
+        sum23 = vaddw_s32(sum23, vget_high_s32(low));
+        sum45 = vaddw_s32(sum45, vget_low_s32(high));
+        sum67 = vaddw_s32(sum67, vget_high_s32(high));
+    }
+
+    vst1q_s16(lanePeaks, peak);
+    vst1q_s64(laneSums, sum01);
+    vst1q_s64(laneSums + 2, sum23);
+    vst1q_s64(laneSums + 4, sum45);
+    vst1q_s64(laneSums + 6, sum67);
+#else
+    const __m128i zero = _mm_setzero_si128();
+    __m128i peak = zero;
+    __m128i sum01 = zero;
+    __m128i sum23 = zero;
+    __m128i sum45 = zero;
+    __m128i sum67 = zero;
+
+    for (; i + LANES <= count; i += LANES) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+        // Saturating negation, so that -32768 measures as full scale
+        peak = _mm_max_epi16(peak, _mm_max_epi16(x, _mm_subs_epi16(zero, x)));
+
+        // Interleave the halves of the products into 32 bit squares, which
+        // are never negative and widen to 64 bits by padding with zeros.
+        // _mm_madd_epi16 would overflow on two full scale samples.
+        const __m128i productLow = _mm_mullo_epi16(x, x);
+        const __m128i productHigh = _mm_mulhi_epi16(x, x);
+        const __m128i squares03 = _mm_unpacklo_epi16(productLow, productHigh);
+        const __m128i squares47 = _mm_unpackhi_epi16(productLow, productHigh);
+        sum01 = _mm_add_epi64(sum01, _mm_unpacklo_epi32(squares03, zero));
+        sum23 = _mm_add_epi64(sum23, _mm_unpackhi_epi32(squares03, zero));
+        sum45 = _mm_add_epi64(sum45, _mm_unpacklo_epi32(squares47, zero));
+        sum67 = _mm_add_epi64(sum67, _mm_unpackhi_epi32(squares47, zero));
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanePeaks), peak);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(laneSums), sum01);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(laneSums + 2), sum23);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(laneSums + 4), sum45);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(laneSums + 6), sum67);
+#endif
+
+    for (int lane = 0; lane < LANES; ++lane) {
+        const int c = lane % channels;
+        peaks[c] = qMax(peaks[c], int(lanePeaks[lane]));
+        sumsOfSquares[c] += laneSums[lane];
+    }
+    return i;
+#else
+    Q_UNUSED(samples);
+    Q_UNUSED(count);
+    Q_UNUSED(channels);
+    Q_UNUSED(peaks);
+    Q_UNUSED(sumsOfSquares);
+    return 0;
+#endif
+}
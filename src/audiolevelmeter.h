@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef AUDIOLEVELMETER_H
+#define AUDIOLEVELMETER_H
+
+#include <QtGlobal>
+
+#include <stdint.h>
+
+/*!
+ * \brief The AudioLevel class holds the level of one channel over a block of
+ * samples, as fractions of full scale
+ */
+class AudioLevel
+{
+public:
+    AudioLevel();
+    /// Highest absolute sample value
+    qreal peak;
+    /// Root mean square of the samples
+    qreal rms;
+};
+
+/*!
+ * \brief The AudioLevelMeter class measures the peak and RMS level of blocks
+ * of interleaved signed 16 bit samples, per channel. It is cheap enough to run
+ * on every fragment the microphone delivers.
+ */
+class AudioLevelMeter
+{
+public:
+    static const int MAX_CHANNELS = 8;
+
+    static void measure(const int16_t *samples, int frames, int channels, AudioLevel *levels);
+    static void accumulate(const int16_t *samples, int frames, int channels,
+                           int *peaks, qint64 *sumsOfSquares);
+
+private:
+    static int accumulateVector(const int16_t *samples, int count, int channels,
+                                int *peaks, qint64 *sumsOfSquares);
+
+    static const int FULL_SCALE = 32767;
+};
+
+#endif // AUDIOLEVELMETER_H
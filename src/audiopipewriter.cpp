@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "audiopipewriter.h"
+#include "audioringbuffer.h"
+
+#include <QDebug>
+#include <QtGlobal>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+AudioPipeWriter::AudioPipeWriter(AudioRingBuffer *buffer)
+    : m_buffer(buffer),
+      m_pipe(-1),
+      m_zeroCopy(true),
+      m_referenced(0)
+{
+}
+
+/*!
+ * \brief AudioPipeWriter::setPipe sets the non-blocking pipe to write into
+ */
+void AudioPipeWriter::setPipe(int fd)
+{
+    m_pipe = fd;
+    m_referenced = 0;
+}
+
+int AudioPipeWriter::pipe() const
+{
+    return m_pipe;
+}
+
+void AudioPipeWriter::setZeroCopy(bool zeroCopy)
+{
+    if (!zeroCopy)
+        releaseConsumedData();
+    m_zeroCopy = zeroCopy;
+}
+
+bool AudioPipeWriter::zeroCopy() const
+{
+    return m_zeroCopy;
+}
+
+/*!
+ * \brief AudioPipeWriter::unwritten returns the number of bytes in the ring
+ * buffer that were not given to the pipe yet
+ */
+int AudioPipeWriter::unwritten() const
+{
+    return m_buffer->available() - m_referenced;
+}
+
+/*!
+ * \brief AudioPipeWriter::referenced returns the number of bytes spliced into
+ * the pipe and not read by the other side yet. They stay reserved in the ring
+ * buffer until then.
+ */
+int AudioPipeWriter::referenced() const
+{
+    return m_referenced;
+}
+
+/*!
+ * \brief AudioPipeWriter::write hands as much unwritten data to the pipe as it
+ * takes without blocking
+ * \return the number of bytes written, 0 if the pipe is full, or -1 on error
+ * with errno set
+ */
+ssize_t AudioPipeWriter::write()
+{
+    releaseConsumedData();
+
+    const char *data = NULL;
+    const int size = m_buffer->peek(&data, m_referenced);
+    if (size == 0)
+        return 0;
+
+    ssize_t num = -1;
+    if (m_zeroCopy) {
+        struct iovec iov = { const_cast<char*>(data), size_t(size) };
+        num = vmsplice(m_pipe, &iov, 1, SPLICE_F_NONBLOCK);
+        if (num < 0 && (errno == EINVAL || errno == ENOSYS || errno == EBADF)) {
+            qWarning() << "vmsplice() not available for the audio pipe, copying data instead:" << strerror(errno);
+            setZeroCopy(false);
+        } else if (num > 0) {
+            m_referenced += num;
+            return num;
+        }
+    }
+
+    if (!m_zeroCopy) {
+        num = ::write(m_pipe, data, size);
+        if (num > 0) {
+            // The kernel has its own copy, unless spliced data is still ahead of it
+            if (m_referenced == 0)
+                m_buffer->consume(num);
+            else
+                m_referenced += num;
+            return num;
+        }
+    }
+
+    if (num < 0 && (errno == EAGAIN || errno == EINTR))
+        return 0;
+    return num;
+}
+
+/*!
+ * \brief AudioPipeWriter::releaseConsumedData returns the spliced pages the
+ * reader is done with to the producer. The pipe only holds the most recent
+ * data, so anything older than what it still holds has been read.
+ */
+void AudioPipeWriter::releaseConsumedData()
+{
+    if (m_referenced == 0)
+        return;
+
+    int queued = 0;
+    if (ioctl(m_pipe, FIONREAD, &queued) < 0)
+        return;
+
+    queued = qMin(queued, m_referenced);
+    m_buffer->consume(m_referenced - queued);
+    m_referenced = queued;
+}
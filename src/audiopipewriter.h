@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef AUDIOPIPEWRITER_H
+#define AUDIOPIPEWRITER_H
+
+#include <sys/types.h>
+
+class AudioRingBuffer;
+
+/*!
+ * \brief The AudioPipeWriter class moves data from an AudioRingBuffer into a
+ * pipe. With zero copy enabled the buffer pages are handed to the pipe with
+ * vmsplice(), and only released to the producer once the reader has consumed
+ * them. It falls back to write() if the kernel or the pipe don't support it.
+ * Must only be used from the consumer thread of the ring buffer.
+ */
+class AudioPipeWriter
+{
+public:
+    explicit AudioPipeWriter(AudioRingBuffer *buffer);
+
+    void setPipe(int fd);
+    int pipe() const;
+
+    void setZeroCopy(bool zeroCopy);
+    bool zeroCopy() const;
+
+    int unwritten() const;
+    int referenced() const;
+
+    ssize_t write();
+
+private:
+    void releaseConsumedData();
+
+    AudioRingBuffer *m_buffer;
+    int m_pipe;
+    bool m_zeroCopy;
+    // Bytes given to the pipe which are still in the ring buffer
+    int m_referenced;
+};
+
+#endif // AUDIOPIPEWRITER_H
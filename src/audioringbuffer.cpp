@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "audioringbuffer.h"
+
+#include <QDebug>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/*!
+ * \brief AudioRingBuffer::AudioRingBuffer creates a buffer holding at least
+ * \p capacity bytes, rounded up to the next power of two and to whole pages
+ */
+AudioRingBuffer::AudioRingBuffer(int capacity)
+    : m_capacity(sysconf(_SC_PAGESIZE)),
+      m_readPosition(0),
+      m_writePosition(0)
+{
+    while (m_capacity < quint32(qMax(capacity, 1)))
+        m_capacity <<= 1;
+
+    // Mapped rather than allocated: pages still referenced by a pipe after
+    // vmsplice() stay intact when the buffer goes away, instead of being
+    // handed out again by malloc
+    void *data = mmap(NULL, m_capacity, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+        qWarning() << "Failed to allocate" << m_capacity << "bytes of audio buffer:" << strerror(errno);
+        m_data = NULL;
+        m_capacity = 0;
+    } else {
+        m_data = static_cast<char*>(data);
+    }
+}
+
+AudioRingBuffer::~AudioRingBuffer()
+{
+    if (m_data != NULL)
+        munmap(m_data, m_capacity);
+}
+
+int AudioRingBuffer::capacity() const
+{
+    return m_capacity;
+}
+
+/*!
+ * \brief AudioRingBuffer::available returns the number of bytes written and
+ * not consumed yet
+ */
+int AudioRingBuffer::available() const
+{
+    return m_writePosition.loadAcquire() - m_readPosition.loadAcquire();
+}
+
+int AudioRingBuffer::freeSpace() const
+{
+    return m_capacity - available();
+}
+
+/*!
+ * \brief AudioRingBuffer::write appends as much of \p data as fits. Producer only.
+ * \return the number of bytes written, less than \p size if the buffer is full
+ */
+int AudioRingBuffer::write(const char *data, int size)
+{
+    const quint32 writePosition = m_writePosition.load();
+    const quint32 used = writePosition - m_readPosition.loadAcquire();
+    const quint32 count = qMin(quint32(qMax(size, 0)), m_capacity - used);
+    if (count == 0)
+        return 0;
+
+    const quint32 index = writePosition & (m_capacity - 1);
+    const quint32 first = qMin(count, m_capacity - index);
+    memcpy(m_data + index, data, first);
+    memcpy(m_data, data + first, count - first);
+
+    // Publishes the data to the consumer
+    m_writePosition.storeRelease(writePosition + count);
+    return count;
+}
+
+/*!
+ * \brief AudioRingBuffer::peek points \p data to the unread bytes following
+ * the first \p offset ones, so they can be handed on without copying them.
+ * Consumer only.
+ * \return the number of contiguous bytes readable at \p data, which can be
+ * less than available() - \p offset when the data wraps around the end of
+ * the buffer
+ */
+int AudioRingBuffer::peek(const char **data, int offset) const
+{
+    const quint32 readPosition = m_readPosition.load() + quint32(qMax(offset, 0));
+    const qint32 count = m_writePosition.loadAcquire() - readPosition;
+    if (count <= 0 || m_capacity == 0) {
+        *data = m_data;
+        return 0;
+    }
+
+    const quint32 index = readPosition & (m_capacity - 1);
+    *data = m_data + index;
+    return qMin(quint32(count), m_capacity - index);
+}
+
+/*!
+ * \brief AudioRingBuffer::consume releases \p size bytes returned by peek()
+ * to the producer. Consumer only.
+ */
+void AudioRingBuffer::consume(int size)
+{
+    const quint32 readPosition = m_readPosition.load();
+    const quint32 count = qMin(quint32(qMax(size, 0)),
+                               m_writePosition.loadAcquire() - readPosition);
+    m_readPosition.storeRelease(readPosition + count);
+}
+
+/*!
+ * \brief AudioRingBuffer::clear drops all unread data. Consumer only.
+ */
+void AudioRingBuffer::clear()
+{
+    m_readPosition.storeRelease(m_writePosition.loadAcquire());
+}
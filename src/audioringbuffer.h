@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef AUDIORINGBUFFER_H
+#define AUDIORINGBUFFER_H
+
+#include <QAtomicInteger>
+#include <QtGlobal>
+
+/*!
+ * \brief The AudioRingBuffer class is a byte FIFO of fixed size shared by
+ * exactly one producer thread and one consumer thread, without locks.
+ * write() may only be called by the producer, peek(), consume() and clear()
+ * only by the consumer. The storage is page aligned, so it can be handed to
+ * the kernel with vmsplice().
+ */
+class AudioRingBuffer
+{
+public:
+    explicit AudioRingBuffer(int capacity);
+    ~AudioRingBuffer();
+
+    int capacity() const;
+    int available() const;
+    int freeSpace() const;
+
+    int write(const char *data, int size);
+
+    int peek(const char **data, int offset = 0) const;
+    void consume(int size);
+    void clear();
+
+private:
+    Q_DISABLE_COPY(AudioRingBuffer)
+
+    char *m_data;
+    quint32 m_capacity;
+    // Positions only ever grow, wrapping around at 2^32. The index into
+    // m_data is the position modulo the capacity, which is a power of two
+    QAtomicInteger<quint32> m_readPosition;
+    QAtomicInteger<quint32> m_writePosition;
+};
+
+#endif // AUDIORINGBUFFER_H
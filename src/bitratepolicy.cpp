@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bitratepolicy.h"
+
+#include <QtGlobal>
+
+#include <cmath>
+
+const QSize BitratePolicy::REFERENCE_SIZE = QSize(1280, 720);
+const int BitratePolicy::MINIMUM_VIDEO_BITRATE;
+const int BitratePolicy::MAXIMUM_VIDEO_BITRATE;
+const int BitratePolicy::REFERENCE_FRAME_RATE;
+const int BitratePolicy::REFERENCE_BITRATE;
+const int BitratePolicy::THROUGHPUT_HEADROOM_PERCENT;
+
+/*!
+ * \brief BitratePolicy::videoBitRate returns the H.264 bitrate for the given
+ * resolution and frame rate. At normal quality, 720p at 30 fps gets the
+ * bitrate that was always used for it. Consecutive frames and neighbouring
+ * pixels are largely redundant, so the bitrate grows slower than the pixel
+ * count and the frame rate.
+ */
+int BitratePolicy::videoBitRate(const QSize &resolution, qreal frameRate,
+                                QMultimedia::EncodingQuality quality)
+{
+    QSize size = resolution.isValid() && !resolution.isEmpty() ? resolution : REFERENCE_SIZE;
+    if (frameRate <= 0)
+        frameRate = REFERENCE_FRAME_RATE;
+
+    const qreal pixelRatio = qreal(size.width() * size.height())
+            / (REFERENCE_SIZE.width() * REFERENCE_SIZE.height());
+    const qreal frameRateRatio = frameRate / REFERENCE_FRAME_RATE;
+
+    const qreal bitRate = REFERENCE_BITRATE * std::pow(pixelRatio, 0.75)
+            * std::pow(frameRateRatio, 0.6) * qualityFactor(quality);
+
+    return qRound(qBound(qreal(MINIMUM_VIDEO_BITRATE), bitRate, qreal(MAXIMUM_VIDEO_BITRATE)));
+}
+
+/*!
+ * \brief BitratePolicy::audioBitRate returns the AAC bitrate for the given
+ * number of channels
+ */
+int BitratePolicy::audioBitRate(int channelCount, QMultimedia::EncodingQuality quality)
+{
+    int channelBitRate;
+    switch (quality) {
+    case QMultimedia::VeryLowQuality:
+        channelBitRate = 16000;
+        break;
+    case QMultimedia::LowQuality:
+        channelBitRate = 20000;
+        break;
+    case QMultimedia::HighQuality:
+        channelBitRate = 48000;
+        break;
+    case QMultimedia::VeryHighQuality:
+        channelBitRate = 64000;
+        break;
+    case QMultimedia::NormalQuality:
+    default:
+        channelBitRate = 24000;
+        break;
+    }
+
+    return channelBitRate * qMax(1, channelCount);
+}
+
+/*!
+ * \brief BitratePolicy::capVideoBitRate lowers the video bitrate so that the
+ * whole recording takes at most half of the write throughput of the storage,
+ * leaving room for other writers and for slow phases of the card
+ * \param writeThroughput in bytes per second, or a negative value if unknown
+ */
+int BitratePolicy::capVideoBitRate(int videoBitRate, int audioBitRate, qint64 writeThroughput)
+{
+    if (writeThroughput <= 0 || videoBitRate <= 0)
+        return videoBitRate;
+
+    const qint64 budget = writeThroughput * 8 * (100 - THROUGHPUT_HEADROOM_PERCENT) / 100
+            - qMax(0, audioBitRate);
+    if (budget >= videoBitRate)
+        return videoBitRate;
+
+    return qMax(qint64(MINIMUM_VIDEO_BITRATE), budget);
+}
+
+qreal BitratePolicy::qualityFactor(QMultimedia::EncodingQuality quality)
+{
+    switch (quality) {
+    case QMultimedia::VeryLowQuality:
+        return 0.35;
+    case QMultimedia::LowQuality:
+        return 0.6;
+    case QMultimedia::HighQuality:
+        return 1.4;
+    case QMultimedia::VeryHighQuality:
+        return 2.0;
+    case QMultimedia::NormalQuality:
+    default:
+        return 1.0;
+    }
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BITRATEPOLICY_H
+#define BITRATEPOLICY_H
+
+#include <QMultimedia>
+#include <QSize>
+
+/*!
+ * \brief The BitratePolicy class computes the encoder bitrates for a
+ * resolution, frame rate and quality, and keeps them within what the storage
+ * can take
+ */
+class BitratePolicy
+{
+public:
+    static int videoBitRate(const QSize &resolution, qreal frameRate,
+                            QMultimedia::EncodingQuality quality = QMultimedia::NormalQuality);
+    static int audioBitRate(int channelCount,
+                            QMultimedia::EncodingQuality quality = QMultimedia::NormalQuality);
+    static int capVideoBitRate(int videoBitRate, int audioBitRate, qint64 writeThroughput);
+
+    static const int MINIMUM_VIDEO_BITRATE = 256000;
+    static const int MAXIMUM_VIDEO_BITRATE = 100000000;
+
+private:
+    static qreal qualityFactor(QMultimedia::EncodingQuality quality);
+
+    static const QSize REFERENCE_SIZE;
+    static const int REFERENCE_FRAME_RATE = 30;
+    static const int REFERENCE_BITRATE = 7 * 1280 * 720;
+    static const int THROUGHPUT_HEADROOM_PERCENT = 50;
+};
+
+#endif // BITRATEPOLICY_H
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "devicequirks.h"
+
+#include <QByteArray>
+#include <QStringList>
+
+#include <hybris/properties/properties.h>
+
+/*!
+ * \brief DeviceQuirks::value returns the override for key on the given
+ * camera, or defaultValue if the device doesn't set one
+ */
+QString DeviceQuirks::value(const QString &key, int deviceId, const QString &defaultValue)
+{
+    QByteArray propertyName = QString("aal.camera.%1.%2").arg(key).arg(deviceId).toLocal8Bit();
+
+    char valueStr[PROP_VALUE_MAX];
+    property_get(propertyName.data(), valueStr, "");
+
+    QString result = QString::fromLocal8Bit(valueStr).trimmed();
+    if (result.isEmpty())
+        return defaultValue;
+
+    return result;
+}
+
+/*!
+ * \brief DeviceQuirks::isEnabled returns true if the override for key is set
+ * to 1 or true
+ */
+bool DeviceQuirks::isEnabled(const QString &key, int deviceId, bool defaultValue)
+{
+    QString result = value(key, deviceId);
+    if (result.isEmpty())
+        return defaultValue;
+
+    return result == QLatin1String("1") || result.compare(QLatin1String("true"), Qt::CaseInsensitive) == 0;
+}
+
+/*!
+ * \brief DeviceQuirks::list returns the comma separated entries of the
+ * override for key, leaving out blank ones
+ */
+QStringList DeviceQuirks::list(const QString &key, int deviceId)
+{
+    QStringList entries;
+    foreach (const QString &entry, value(key, deviceId).split(QChar(','))) {
+        if (!entry.trimmed().isEmpty())
+            entries.append(entry.trimmed());
+    }
+
+    return entries;
+}
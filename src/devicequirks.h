@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DEVICEQUIRKS_H
+#define DEVICEQUIRKS_H
+
+#include <QString>
+#include <QStringList>
+
+/*!
+ * \brief The DeviceQuirks class reads the per device overrides for what the
+ * camera HAL doesn't report, or reports wrongly. They are android properties
+ * named aal.camera.<key>.<device id>.
+ */
+class DeviceQuirks
+{
+public:
+    static QString value(const QString &key, int deviceId,
+                         const QString &defaultValue = QString());
+    static bool isEnabled(const QString &key, int deviceId, bool defaultValue = false);
+    static QStringList list(const QString &key, int deviceId);
+};
+
+#endif // DEVICEQUIRKS_H
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "haleventqueue.h"
+
+HalEventQueue::HalEventQueue()
+    : m_head(0)
+{
+}
+
+/*!
+ * \brief HalEventQueue::~HalEventQueue deletes the events nobody took
+ */
+HalEventQueue::~HalEventQueue()
+{
+    HalEvent *event = takeAll();
+    while (event != 0) {
+        HalEvent *next = event->next;
+        delete event;
+        event = next;
+    }
+}
+
+/*!
+ * \brief HalEventQueue::push queues \p event, which the queue takes ownership
+ * of. Can be called from any thread.
+ * \return true if the queue was empty, in which case the consumer has to be
+ * woken up. Events pushed before it takes them ride along in the same batch.
+ */
+bool HalEventQueue::push(HalEvent *event)
+{
+    HalEvent *head;
+    do {
+        head = m_head.loadAcquire();
+        event->next = head;
+    } while (!m_head.testAndSetRelease(head, event));
+
+    return head == 0;
+}
+
+/*!
+ * \brief HalEventQueue::takeAll empties the queue. Must only be called from the
+ * consumer thread.
+ * \return the oldest event, linked to the others through HalEvent::next in the
+ * order they were pushed, or 0 if the queue was empty. The caller owns them.
+ */
+HalEvent *HalEventQueue::takeAll()
+{
+    HalEvent *event = m_head.fetchAndStoreAcquire(0);
+
+    // The list was built newest first
+    HalEvent *oldest = 0;
+    while (event != 0) {
+        HalEvent *next = event->next;
+        event->next = oldest;
+        oldest = event;
+        event = next;
+    }
+    return oldest;
+}
+
+bool HalEventQueue::isEmpty() const
+{
+    return m_head.loadAcquire() == 0;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HALEVENTQUEUE_H
+#define HALEVENTQUEUE_H
+
+#include <QAtomicPointer>
+#include <QByteArray>
+
+/*!
+ * \brief The HalEvent class is a notification from a camera or recorder HAL
+ * thread, waiting to be handled on the thread owning the camera service
+ */
+class HalEvent
+{
+public:
+    enum Type {
+        Shutter,
+        Focus,
+        Zoom,
+        ViewfinderFrame,
+        Jpeg,
+        CameraError,
+        RecorderError
+    };
+
+    explicit HalEvent(Type type, int value = 0)
+        : type(type), value(value), next(0) {}
+
+    Type type;
+    /// Zoom level of a Zoom event
+    int value;
+    /// Image of a Jpeg event
+    QByteArray data;
+    /// Following event in a batch taken from the queue
+    HalEvent *next;
+};
+
+/*!
+ * \brief The HalEventQueue class hands HalEvents from any number of HAL threads
+ * to a single consumer thread without locking. Producers push onto an atomic
+ * list, the consumer takes the whole list at once and gets the events back in
+ * the order they were pushed.
+ */
+class HalEventQueue
+{
+public:
+    HalEventQueue();
+    ~HalEventQueue();
+
+    bool push(HalEvent *event);
+    HalEvent *takeAll();
+    bool isEmpty() const;
+
+private:
+    Q_DISABLE_COPY(HalEventQueue)
+
+    QAtomicPointer<HalEvent> m_head;
+};
+
+#endif // HALEVENTQUEUE_H
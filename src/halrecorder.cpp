@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "halrecorder.h"
+#include "haltrace.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * The session is a text file, one event per line, with the fields separated
+ * by single spaces. Times are in microseconds since the recording started.
+ *
+ *   call <begin> <duration> <name> <result> <argument>...
+ *   callback <time> <name> <within> <payload> <argument>...
+ *
+ * The values are written as described for HalRecordedValue. A callback made
+ * from inside a HAL call on the same thread, like the ones enumerating the
+ * supported sizes, names that call as <within>, otherwise it is '-'. The
+ * payload is '-', or the size of the payload and the name of the file next to
+ * the session holding it, separated by a ':'. Lines starting with '#' are
+ * comments.
+ */
+
+namespace {
+
+class RecorderState
+{
+public:
+    RecorderState()
+        : file(0),
+          start(0),
+          payloads(0)
+    {
+    }
+
+    ~RecorderState()
+    {
+        HalRecorder::stop();
+    }
+
+    QMutex mutex;
+    FILE *file;
+    QString fileName;
+    qint64 start;
+    int payloads;
+};
+
+RecorderState recorderState;
+
+__thread const char *currentCall = 0;
+
+bool startFromEnvironment()
+{
+    const QByteArray fileName = qgetenv("AAL_CAMERA_RECORD");
+    if (!fileName.isEmpty())
+        HalRecorder::start(QString::fromLocal8Bit(fileName));
+    return HalRecorder::isEnabled();
+}
+
+} // namespace
+
+bool HalRecorder::m_enabled = false;
+static const bool startedFromEnvironment = startFromEnvironment();
+
+/*!
+ * \brief HalRecorder::start starts recording a session to \p fileName,
+ * replacing the file and ending any recording in progress
+ * \return false if the file could not be created
+ */
+bool HalRecorder::start(const QString &fileName)
+{
+    stop();
+
+    QMutexLocker locker(&recorderState.mutex);
+    FILE *file = fopen(fileName.toLocal8Bit().constData(), "w");
+    if (file == NULL) {
+        qWarning() << "Failed to record the HAL session to" << fileName
+                   << ":" << strerror(errno);
+        return false;
+    }
+
+    fputs("# aalcamera HAL session 1\n", file);
+    recorderState.file = file;
+    recorderState.fileName = fileName;
+    recorderState.start = now();
+    recorderState.payloads = 0;
+    m_enabled = true;
+    return true;
+}
+
+/*!
+ * \brief HalRecorder::stop ends the recording and closes the session file
+ */
+void HalRecorder::stop()
+{
+    QMutexLocker locker(&recorderState.mutex);
+    m_enabled = false;
+    if (recorderState.file != 0) {
+        fclose(recorderState.file);
+        recorderState.file = 0;
+    }
+}
+
+/*!
+ * \brief HalRecorder::now returns the time the session is recorded in
+ */
+qint64 HalRecorder::now()
+{
+    return HalTrace::now();
+}
+
+/*!
+ * \brief HalRecorder::enterCall notes that the calling thread is in the HAL
+ * call \p name, until leaveCall()
+ * \return the call the thread was in before
+ */
+const char *HalRecorder::enterCall(const char *name)
+{
+    const char *outer = currentCall;
+    currentCall = name;
+    return outer;
+}
+
+/*!
+ * \brief HalRecorder::leaveCall writes the HAL call \p name that ran from \p
+ * begin to \p end to the session, and makes \p outer the current call of the
+ * thread again
+ */
+void HalRecorder::leaveCall(const char *name, const char *outer, qint64 begin, qint64 end,
+                            const QByteArray &result, const QByteArray &arguments)
+{
+    currentCall = outer;
+
+    QMutexLocker locker(&recorderState.mutex);
+    if (recorderState.file == 0)
+        return;
+
+    fprintf(recorderState.file, "call %lld %lld %s%s%s\n",
+            (long long)(begin - recorderState.start), (long long)(end - begin),
+            name, result.constData(), arguments.constData());
+}
+
+/*!
+ * \brief HalRecorder::recordCallback writes that the HAL called back \p name
+ * to the session, storing the \p payloadSize bytes at \p payload in a file of
+ * their own
+ */
+void HalRecorder::recordCallback(const char *name, const QByteArray &arguments,
+                                 const void *payload, uint payloadSize)
+{
+    const qint64 time = now();
+    const char *within = currentCall != 0 ? currentCall : "-";
+
+    QMutexLocker locker(&recorderState.mutex);
+    if (recorderState.file == 0)
+        return;
+
+    QByteArray payloadField("-");
+    if (payload != 0) {
+        const QString payloadName = QString("%1.%2.payload")
+                .arg(QFileInfo(recorderState.fileName).fileName())
+                .arg(recorderState.payloads++);
+        const QString payloadPath = QFileInfo(recorderState.fileName).dir().filePath(payloadName);
+
+        FILE *file = fopen(payloadPath.toLocal8Bit().constData(), "w");
+        if (file == NULL || fwrite(payload, 1, payloadSize, file) != payloadSize)
+            qWarning() << "Failed to record the HAL callback payload to" << payloadPath
+                       << ":" << strerror(errno);
+        if (file != NULL)
+            fclose(file);
+        payloadField = QByteArray::number(payloadSize) + ':' + payloadName.toLocal8Bit();
+    }
+
+    fprintf(recorderState.file, "callback %lld %s %s %s%s\n",
+            (long long)(time - recorderState.start), name, within,
+            payloadField.constData(), arguments.constData());
+}
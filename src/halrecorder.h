@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HALRECORDER_H
+#define HALRECORDER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QtGlobal>
+
+#include <type_traits>
+
+/*!
+ * \brief The HalRecorder class logs a session of camera and recorder HAL calls,
+ * with their arguments, results and timing, and the callbacks the HAL makes,
+ * with their payloads. The replay backend of the mock HAL in the unit tests
+ * plays such a session back against the controls on a desktop.
+ *
+ * Recording is off unless the AAL_CAMERA_RECORD environment variable names the
+ * session file. Callback payloads, the JPEG images, are written next to it.
+ * The session is written as it goes, under a lock, so recording is meant for
+ * investigations and not left on.
+ */
+class HalRecorder
+{
+public:
+    static bool isEnabled() { return m_enabled; }
+    static bool start(const QString &fileName);
+    static void stop();
+
+    static qint64 now();
+    static const char *enterCall(const char *name);
+    static void leaveCall(const char *name, const char *outer, qint64 begin, qint64 end,
+                          const QByteArray &result, const QByteArray &arguments);
+    static void recordCallback(const char *name, const QByteArray &arguments,
+                               const void *payload = 0, uint payloadSize = 0);
+
+private:
+    static bool m_enabled;
+};
+
+/*
+ * How a value is written to the session: numbers as they are, the number a
+ * pointer points to after a '*', strings percent encoded in quotes and
+ * anything else, handles and callbacks, as '-'. Every value is preceded by a
+ * space.
+ */
+template<typename T, typename Enable = void>
+struct HalRecordedValue
+{
+    static void append(QByteArray &line, const T &) { line += " -"; }
+};
+
+template<typename T>
+struct HalRecordedValue<T, typename std::enable_if<std::is_integral<T>::value
+                                                   || std::is_enum<T>::value>::type>
+{
+    static QByteArray text(T value) { return QByteArray::number(qlonglong(value)); }
+    static void append(QByteArray &line, T value) { line += ' ' + text(value); }
+};
+
+template<typename T>
+struct HalRecordedValue<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+{
+    static QByteArray text(T value) { return QByteArray::number(double(value), 'g', 9); }
+    static void append(QByteArray &line, T value) { line += ' ' + text(value); }
+};
+
+template<typename T>
+struct HalRecordedValue<T*, typename std::enable_if<std::is_arithmetic<T>::value
+                                                    || std::is_enum<T>::value>::type>
+{
+    static void append(QByteArray &line, T *value)
+    {
+        if (value == 0)
+            line += " -";
+        else
+            line += " *" + HalRecordedValue<typename std::remove_cv<T>::type>::text(*value);
+    }
+};
+
+template<>
+struct HalRecordedValue<const char*>
+{
+    static void append(QByteArray &line, const char *value)
+    {
+        if (value == 0) {
+            line += " -";
+            return;
+        }
+        line += " \"";
+        line += QByteArray(value).toPercentEncoding();
+        line += '"';
+    }
+};
+
+inline void halRecordValues(QByteArray &)
+{
+}
+
+template<typename T, typename... Rest>
+inline void halRecordValues(QByteArray &line, const T &value, const Rest &... rest)
+{
+    HalRecordedValue<T>::append(line, value);
+    halRecordValues(line, rest...);
+}
+
+/*!
+ * \brief The HalRecordedCall class records one HAL call, taking the values of
+ * the out parameters after the call returned.
+ */
+class HalRecordedCall
+{
+public:
+    explicit HalRecordedCall(const char *name)
+        : m_name(name),
+          m_outer(HalRecorder::enterCall(name)),
+          m_begin(HalRecorder::now())
+    {
+    }
+
+    template<typename Result, typename... Parameters>
+    Result invoke(Result (*function)(Parameters...), Parameters... arguments)
+    {
+        return invoke(typename std::is_void<Result>::type(), function, arguments...);
+    }
+
+private:
+    Q_DISABLE_COPY(HalRecordedCall)
+
+    template<typename Result, typename... Parameters>
+    Result invoke(std::false_type, Result (*function)(Parameters...), Parameters... arguments)
+    {
+        const Result result = function(arguments...);
+        QByteArray recordedResult, recordedArguments;
+        halRecordValues(recordedResult, result);
+        halRecordValues(recordedArguments, arguments...);
+        finish(recordedResult, recordedArguments);
+        return result;
+    }
+
+    template<typename... Parameters>
+    void invoke(std::true_type, void (*function)(Parameters...), Parameters... arguments)
+    {
+        function(arguments...);
+        QByteArray recordedArguments;
+        halRecordValues(recordedArguments, arguments...);
+        finish(" -", recordedArguments);
+    }
+
+    void finish(const QByteArray &result, const QByteArray &arguments)
+    {
+        HalRecorder::leaveCall(m_name, m_outer, m_begin, HalRecorder::now(), result, arguments);
+    }
+
+    const char *m_name;
+    const char *m_outer;
+    qint64 m_begin;
+};
+
+/*!
+ * Records that the HAL called back \p name, the HAL's name for the callback,
+ * with the remaining arguments.
+ */
+template<typename... Values>
+inline void halRecordCallback(const char *name, const Values &... values)
+{
+    if (HalRecorder::isEnabled()) {
+        QByteArray arguments;
+        halRecordValues(arguments, values...);
+        HalRecorder::recordCallback(name, arguments);
+    }
+}
+
+#endif // HALRECORDER_H
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "haltrace.h"
+
+#include <QAtomicInt>
+#include <QDebug>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+struct TraceEvent
+{
+    const char *name;
+    qint64 begin;
+    qint64 end;
+};
+
+/*
+ * Written only by the thread owning it. The count is published after the
+ * event is complete, so flush() can read the buffer while the thread goes on.
+ */
+struct TraceBuffer
+{
+    TraceBuffer()
+        : threadId(syscall(SYS_gettid)),
+          count(0),
+          dropped(0)
+    {
+    }
+
+    pid_t threadId;
+    QAtomicInt count;
+    QAtomicInt dropped;
+    TraceEvent events[HalTrace::EVENTS_PER_THREAD];
+};
+
+/*
+ * Buffers outlive their threads, so that the HAL threads which are gone by
+ * shutdown still show up in the trace. They are never freed, as HAL threads
+ * may still be recording while the process exits. Writes the trace when the
+ * plugin is unloaded or the process exits.
+ */
+class TraceState
+{
+public:
+    ~TraceState()
+    {
+        if (HalTrace::isEnabled())
+            HalTrace::flush();
+    }
+
+    QMutex mutex;
+    QList<TraceBuffer*> buffers;
+    QByteArray fileName;
+};
+
+TraceState traceState;
+
+__thread TraceBuffer *threadBuffer = 0;
+
+TraceBuffer *currentBuffer()
+{
+    if (threadBuffer == 0) {
+        threadBuffer = new TraceBuffer;
+        QMutexLocker locker(&traceState.mutex);
+        traceState.buffers.append(threadBuffer);
+    }
+    return threadBuffer;
+}
+
+void writeEscaped(FILE *file, const char *text)
+{
+    for (; *text != '\0'; ++text) {
+        if (*text == '"' || *text == '\\')
+            fputc('\\', file);
+        if (static_cast<unsigned char>(*text) >= 0x20)
+            fputc(*text, file);
+    }
+}
+
+bool startFromEnvironment()
+{
+    const QByteArray fileName = qgetenv("AAL_CAMERA_TRACE");
+    if (!fileName.isEmpty())
+        HalTrace::start(QString::fromLocal8Bit(fileName));
+    return HalTrace::isEnabled();
+}
+
+} // namespace
+
+bool HalTrace::m_enabled = false;
+static const bool startedFromEnvironment = startFromEnvironment();
+
+/*!
+ * \brief HalTrace::start turns tracing on, the trace is written to \p fileName
+ */
+void HalTrace::start(const QString &fileName)
+{
+    QMutexLocker locker(&traceState.mutex);
+    traceState.fileName = fileName.toLocal8Bit();
+    m_enabled = true;
+}
+
+/*!
+ * \brief HalTrace::now returns the monotonic clock in microseconds, the clock
+ * the kernel and Android traces use as well
+ */
+qint64 HalTrace::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*!
+ * \brief HalTrace::record adds a span from \p begin to \p end to the buffer of
+ * the calling thread
+ */
+void HalTrace::record(const char *name, qint64 begin, qint64 end)
+{
+    TraceBuffer *buffer = currentBuffer();
+    const int index = buffer->count.load();
+    if (index >= EVENTS_PER_THREAD) {
+        buffer->dropped.ref();
+        return;
+    }
+
+    TraceEvent &event = buffer->events[index];
+    event.name = name;
+    event.begin = begin;
+    event.end = end;
+    buffer->count.storeRelease(index + 1);
+}
+
+/*!
+ * \brief HalTrace::flush writes everything recorded so far to the trace file,
+ * replacing what an earlier flush wrote
+ * \return false if the file could not be written
+ */
+bool HalTrace::flush()
+{
+    QMutexLocker locker(&traceState.mutex);
+    if (traceState.fileName.isEmpty())
+        return false;
+
+    FILE *file = fopen(traceState.fileName.constData(), "w");
+    if (file == NULL) {
+        qWarning() << "Failed to write the HAL trace to" << traceState.fileName
+                   << ":" << strerror(errno);
+        return false;
+    }
+
+    const pid_t pid = getpid();
+    bool first = true;
+    fputs("{\"traceEvents\":[", file);
+    Q_FOREACH (TraceBuffer *buffer, traceState.buffers) {
+        const int count = buffer->count.loadAcquire();
+        for (int i = 0; i < count; ++i) {
+            const TraceEvent &event = buffer->events[i];
+            fputs(first ? "\n" : ",\n", file);
+            first = false;
+            fputs("{\"name\":\"", file);
+            writeEscaped(file, event.name);
+            fprintf(file, "\",\"cat\":\"hal\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":%d,\"tid\":%d}",
+                    (long long)event.begin, (long long)(event.end - event.begin),
+                    int(pid), int(buffer->threadId));
+        }
+        if (buffer->dropped.load() > 0)
+            qWarning() << "HAL trace of thread" << buffer->threadId << "dropped"
+                       << buffer->dropped.load() << "events";
+    }
+    fputs("\n],\"displayTimeUnit\":\"ms\"}\n", file);
+
+    const bool ok = ferror(file) == 0;
+    fclose(file);
+    return ok;
+}
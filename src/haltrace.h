@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HALTRACE_H
+#define HALTRACE_H
+
+#include "halrecorder.h"
+
+#include <QString>
+#include <QtGlobal>
+
+/*!
+ * \brief The HalTrace class records how long the camera and recorder HAL calls
+ * and callbacks take, and writes them out in the Chrome trace event format,
+ * which chrome://tracing and Perfetto can open.
+ *
+ * Tracing is off unless the AAL_CAMERA_TRACE environment variable names the
+ * file to write. Each thread records into its own buffer without locking, and
+ * the trace is written when the plugin shuts down, or by flush().
+ */
+class HalTrace
+{
+public:
+    static bool isEnabled() { return m_enabled; }
+    static void start(const QString &fileName);
+    static bool flush();
+
+    static qint64 now();
+    static void record(const char *name, qint64 begin, qint64 end);
+
+    /// Events kept per thread, later ones are dropped
+    static const int EVENTS_PER_THREAD = 16384;
+
+private:
+    static bool m_enabled;
+};
+
+/*!
+ * \brief The HalTraceSpan class records a span in the trace from its
+ * construction to its destruction. \p name must outlive the trace, a string
+ * literal or Q_FUNC_INFO. It costs a single test when tracing is off.
+ */
+class HalTraceSpan
+{
+public:
+    explicit HalTraceSpan(const char *name)
+        : m_name(HalTrace::isEnabled() ? name : 0),
+          m_begin(m_name != 0 ? HalTrace::now() : 0)
+    {
+    }
+
+    ~HalTraceSpan()
+    {
+        if (m_name != 0)
+            HalTrace::record(m_name, m_begin, HalTrace::now());
+    }
+
+private:
+    Q_DISABLE_COPY(HalTraceSpan)
+
+    const char *m_name;
+    qint64 m_begin;
+};
+
+template<typename T>
+struct HalTraceIdentity
+{
+    typedef T type;
+};
+
+/*!
+ * Calls a HAL \p function, recording the call in the trace and in the session
+ * when these are on. The arguments convert to the parameter types here, as
+ * they would when calling the function directly.
+ */
+template<typename Result, typename... Parameters>
+inline Result halTraceCall(const char *name, Result (*function)(Parameters...),
+                           typename HalTraceIdentity<Parameters>::type... arguments)
+{
+    HalTraceSpan span(name);
+    if (!HalRecorder::isEnabled())
+        return function(arguments...);
+
+    HalRecordedCall call(name);
+    return call.invoke(function, arguments...);
+}
+
+/*!
+ * Calls a HAL \p function with the remaining arguments, recording the call in
+ * the trace and in the session. Evaluates to what the function returns.
+ */
+#define HAL_TRACE(function, ...) \
+    halTraceCall(#function, &function, ##__VA_ARGS__)
+
+#endif // HALTRACE_H
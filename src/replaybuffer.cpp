@@ -0,0 +1,413 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "replaybuffer.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QMutexLocker>
+#include <QThread>
+#include <QtConcurrent/QtConcurrent>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+const int ReplayBuffer::TS_PACKET_SIZE;
+const int ReplayBuffer::PIPE_SIZE;
+const int ReplayBuffer::READ_SIZE;
+const qint64 ReplayBuffer::MAX_SIZE;
+
+class ReplayBufferReader : public QThread
+{
+public:
+    explicit ReplayBufferReader(ReplayBuffer *buffer)
+        : m_buffer(buffer)
+    {
+    }
+
+protected:
+    void run()
+    {
+        m_buffer->readStream();
+    }
+
+private:
+    ReplayBuffer *m_buffer;
+};
+
+/*!
+ * \brief ReplayBuffer::ReplayBuffer
+ * \param window how many milliseconds of the stream are kept
+ */
+ReplayBuffer::ReplayBuffer(qint64 window, QObject *parent)
+    : QObject(parent),
+      m_window(window),
+      m_readFd(-1),
+      m_readerThread(0),
+      m_size(0)
+{
+}
+
+ReplayBuffer::~ReplayBuffer()
+{
+    stop();
+    m_pendingWrites.waitForFinished();
+}
+
+/*!
+ * \brief ReplayBuffer::start creates the pipe the stream is written to and
+ * starts reading from it. The caller owns the returned file descriptor, and
+ * has to close it before calling stop().
+ * \return the write end of the pipe, or -1 on error
+ */
+int ReplayBuffer::start()
+{
+    if (m_readerThread != 0) {
+        qWarning() << "Replay buffer is already started";
+        return -1;
+    }
+
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) < 0) {
+        qWarning() << "Failed to create replay pipe (errno: " << errno << ")";
+        return -1;
+    }
+
+    // A larger pipe absorbs the muxer bursts while the reader is descheduled
+    if (fcntl(fds[1], F_SETPIPE_SZ, PIPE_SIZE) < 0)
+        qWarning() << "Failed to grow the replay pipe (errno: " << errno << ")";
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_chunks.clear();
+        m_size = 0;
+    }
+
+    m_readFd = fds[0];
+    m_clock.start();
+    m_readerThread = new ReplayBufferReader(this);
+    m_readerThread->start();
+
+    return fds[1];
+}
+
+/*!
+ * \brief ReplayBuffer::stop waits for the reader thread to drain the pipe.
+ * The content of the buffer is kept, so it can still be saved.
+ */
+void ReplayBuffer::stop()
+{
+    if (m_readerThread == 0)
+        return;
+
+    m_readerThread->wait();
+    delete m_readerThread;
+    m_readerThread = 0;
+
+    close(m_readFd);
+    m_readFd = -1;
+}
+
+/*!
+ * \brief ReplayBuffer::window returns how many milliseconds of the stream are
+ * kept
+ */
+qint64 ReplayBuffer::window() const
+{
+    return m_window;
+}
+
+/*!
+ * \brief ReplayBuffer::size returns how many bytes of the stream are kept
+ */
+qint64 ReplayBuffer::size() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_size;
+}
+
+/*!
+ * \brief ReplayBuffer::duration returns how many milliseconds of the stream
+ * are currently available
+ */
+qint64 ReplayBuffer::duration() const
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_chunks.isEmpty())
+        return 0;
+
+    return m_chunks.last().timestamp - m_chunks.first().timestamp;
+}
+
+/*!
+ * \brief ReplayBuffer::saveReplay writes the last duration milliseconds of the
+ * stream to fileName in the background. replaySaved() or replayFailed() is
+ * emitted once it is done.
+ * \return false if there is nothing to save
+ */
+bool ReplayBuffer::saveReplay(const QString &fileName, qint64 duration)
+{
+    QList<QByteArray> chunks;
+    int startChunk = -1;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_chunks.isEmpty())
+            return false;
+
+        // The chunks are implicitly shared, this doesn't copy the stream. The
+        // ones before the start are handed over too, the replay may have to
+        // begin at a key frame in them.
+        const qint64 start = m_chunks.last().timestamp - duration;
+        for (int i = 0; i < m_chunks.size(); ++i) {
+            if (startChunk < 0 && m_chunks.at(i).timestamp >= start)
+                startChunk = i;
+            chunks.append(m_chunks.at(i).data);
+        }
+    }
+
+    m_pendingWrites.addFuture(QtConcurrent::run(this, &ReplayBuffer::writeReplay,
+                                                fileName, chunks, startChunk));
+    return true;
+}
+
+void ReplayBuffer::readStream()
+{
+    QByteArray pending;
+    char buffer[READ_SIZE];
+
+    while (true) {
+        ssize_t bytes = read(m_readFd, buffer, sizeof(buffer));
+        if (bytes < 0) {
+            if (errno == EINTR)
+                continue;
+            qWarning() << "Failed to read from the replay pipe (errno: " << errno << ")";
+            break;
+        }
+        if (bytes == 0) // the recorder closed its end
+            break;
+
+        // Only whole transport stream packets are stored, so that any chunk
+        // can start a saved replay
+        pending.append(buffer, bytes);
+        const int packetsSize = pending.size() - pending.size() % TS_PACKET_SIZE;
+        if (packetsSize == 0)
+            continue;
+
+        appendChunk(pending.left(packetsSize));
+        pending.remove(0, packetsSize);
+    }
+}
+
+void ReplayBuffer::appendChunk(const QByteArray &data)
+{
+    Chunk chunk;
+    chunk.timestamp = m_clock.elapsed();
+    chunk.data = data;
+
+    QMutexLocker locker(&m_mutex);
+    m_chunks.enqueue(chunk);
+    m_size += data.size();
+
+    const qint64 oldest = chunk.timestamp - m_window;
+    while (m_chunks.size() > 1 &&
+           (m_chunks.first().timestamp < oldest || m_size > MAX_SIZE)) {
+        m_size -= m_chunks.dequeue().data.size();
+    }
+}
+
+/*!
+ * \brief ReplayBuffer::writeReplay writes the chunks to fileName, starting at
+ * a program association table, so players can find the streams, that comes
+ * before a random access point of the video, so they can decode it from the
+ * first frame. The last such point before startChunk is taken, or else the
+ * first one after it. Without any, the replay starts at the last program
+ * association table before startChunk, or else at the first one after it.
+ */
+void ReplayBuffer::writeReplay(const QString &fileName, const QList<QByteArray> &chunks, int startChunk)
+{
+    int patChunk = -1;
+    int patOffset = -1;
+    int keyChunk = -1;
+    int keyOffset = -1;
+    int fallbackChunk = -1;
+    int fallbackOffset = -1;
+    int pmtPid = -1;
+    int videoPid = -1;
+    for (int c = 0; c < chunks.size() && (keyChunk < 0 || c < startChunk); ++c) {
+        const QByteArray &data = chunks.at(c);
+        for (int i = 0; i + TS_PACKET_SIZE <= data.size(); i += TS_PACKET_SIZE) {
+            const char *packet = data.constData() + i;
+            const int pid = packetPid(packet);
+            if (isPatPacket(packet)) {
+                patChunk = c;
+                patOffset = i;
+                pmtPid = programMapPid(packet);
+                if (c < startChunk || fallbackChunk < 0) {
+                    fallbackChunk = c;
+                    fallbackOffset = i;
+                }
+            } else if (pid == pmtPid && pid >= 0) {
+                const int streamPid = videoStreamPid(packet);
+                if (streamPid >= 0)
+                    videoPid = streamPid;
+            } else if (pid == videoPid && patChunk >= 0 && isRandomAccessPacket(packet)) {
+                if (c < startChunk || keyChunk < 0) {
+                    keyChunk = patChunk;
+                    keyOffset = patOffset;
+                }
+            }
+        }
+    }
+
+    int first = keyChunk >= 0 ? keyChunk : fallbackChunk;
+    int offset = keyChunk >= 0 ? keyOffset : fallbackOffset;
+    if (offset < 0) {
+        qWarning() << "No program association table in the replay buffer";
+        Q_EMIT replayFailed(fileName);
+        return;
+    }
+    if (keyChunk < 0)
+        qWarning() << "No video random access point in the replay buffer, starting at a program table";
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to open" << fileName << "to save the replay";
+        Q_EMIT replayFailed(fileName);
+        return;
+    }
+
+    const qint64 firstSize = chunks.at(first).size() - offset;
+    bool ok = file.write(chunks.at(first).constData() + offset, firstSize) == firstSize;
+    for (int i = first + 1; ok && i < chunks.size(); ++i)
+        ok = file.write(chunks.at(i)) == chunks.at(i).size();
+    file.close();
+
+    if (!ok) {
+        qWarning() << "Failed to write the replay to" << fileName;
+        file.remove();
+        Q_EMIT replayFailed(fileName);
+        return;
+    }
+
+    Q_EMIT replaySaved(fileName);
+}
+
+bool ReplayBuffer::isPatPacket(const char *packet)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(packet);
+    const bool payloadUnitStart = bytes[1] & 0x40;
+    return packetPid(packet) == 0 && payloadUnitStart;
+}
+
+/*!
+ * \brief ReplayBuffer::isRandomAccessPacket returns true if the adaptation
+ * field of the packet has the random_access_indicator set, which the muxer
+ * does on the first packet of a key frame
+ */
+bool ReplayBuffer::isRandomAccessPacket(const char *packet)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(packet);
+    const bool hasAdaptationField = bytes[3] & 0x20;
+    return hasAdaptationField && bytes[4] > 0 && (bytes[5] & 0x40);
+}
+
+/*!
+ * \brief ReplayBuffer::packetPid returns the PID of the packet, or -1 if it
+ * isn't a transport stream packet
+ */
+int ReplayBuffer::packetPid(const char *packet)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(packet);
+    if (bytes[0] != 0x47)
+        return -1;
+    return ((bytes[1] & 0x1f) << 8) | bytes[2];
+}
+
+/*!
+ * \brief ReplayBuffer::sectionOffset returns where the table section starting
+ * in the packet begins, or -1 if none does
+ */
+int ReplayBuffer::sectionOffset(const char *packet)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(packet);
+    const bool payloadUnitStart = bytes[1] & 0x40;
+    const bool hasPayload = bytes[3] & 0x10;
+    if (!payloadUnitStart || !hasPayload)
+        return -1;
+
+    int offset = 4;
+    if (bytes[3] & 0x20)
+        offset += 1 + bytes[4];
+    if (offset >= TS_PACKET_SIZE)
+        return -1;
+
+    // Skips the pointer field
+    offset += 1 + bytes[offset];
+    return offset < TS_PACKET_SIZE ? offset : -1;
+}
+
+/*!
+ * \brief ReplayBuffer::programMapPid returns the PID of the program map table
+ * of the first program in the program association table packet, or -1
+ */
+int ReplayBuffer::programMapPid(const char *packet)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(packet);
+    const int table = sectionOffset(packet);
+    if (table < 0 || table + 8 > TS_PACKET_SIZE || bytes[table] != 0x00)
+        return -1;
+
+    // The section length counts the CRC at its end
+    const int sectionLength = ((bytes[table + 1] & 0x0f) << 8) | bytes[table + 2];
+    const int end = qMin(table + 3 + sectionLength - 4, TS_PACKET_SIZE);
+    for (int i = table + 8; i + 4 <= end; i += 4) {
+        const int program = (bytes[i] << 8) | bytes[i + 1];
+        if (program != 0) // 0 is the network information table
+            return ((bytes[i + 2] & 0x1f) << 8) | bytes[i + 3];
+    }
+    return -1;
+}
+
+/*!
+ * \brief ReplayBuffer::videoStreamPid returns the PID of the first video
+ * stream in the program map table packet, or -1
+ */
+int ReplayBuffer::videoStreamPid(const char *packet)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(packet);
+    const int table = sectionOffset(packet);
+    if (table < 0 || table + 12 > TS_PACKET_SIZE || bytes[table] != 0x02)
+        return -1;
+
+    const int sectionLength = ((bytes[table + 1] & 0x0f) << 8) | bytes[table + 2];
+    const int end = qMin(table + 3 + sectionLength - 4, TS_PACKET_SIZE);
+    const int programInfoLength = ((bytes[table + 10] & 0x0f) << 8) | bytes[table + 11];
+    for (int i = table + 12 + programInfoLength; i + 5 <= end;) {
+        const int streamType = bytes[i];
+        const int pid = ((bytes[i + 1] & 0x1f) << 8) | bytes[i + 2];
+        switch (streamType) {
+        case 0x01: // MPEG-1 video
+        case 0x02: // MPEG-2 video
+        case 0x10: // MPEG-4 part 2
+        case 0x1b: // H.264
+        case 0x24: // H.265
+            return pid;
+        }
+        i += 5 + (((bytes[i + 3] & 0x0f) << 8) | bytes[i + 4]);
+    }
+    return -1;
+}
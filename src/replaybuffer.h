@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REPLAYBUFFER_H
+#define REPLAYBUFFER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFutureSynchronizer>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QQueue>
+#include <QString>
+
+class QThread;
+
+/*!
+ * \brief The ReplayBuffer class keeps the last seconds of an MPEG-2 transport
+ * stream in memory. The recorder writes the stream into a pipe, and a reader
+ * thread stores what comes out of it in time stamped chunks. Any part of the
+ * window can then be written to disk as is, without encoding it again.
+ */
+class ReplayBuffer : public QObject
+{
+    Q_OBJECT
+public:
+    static const int TS_PACKET_SIZE = 188;
+
+    explicit ReplayBuffer(qint64 window, QObject *parent = 0);
+    ~ReplayBuffer();
+
+    int start();
+    void stop();
+
+    qint64 window() const;
+    qint64 size() const;
+    qint64 duration() const;
+
+    bool saveReplay(const QString &fileName, qint64 duration);
+
+Q_SIGNALS:
+    void replaySaved(const QString &fileName);
+    void replayFailed(const QString &fileName);
+
+private:
+    struct Chunk
+    {
+        qint64 timestamp;
+        QByteArray data;
+    };
+
+    void readStream();
+    void appendChunk(const QByteArray &data);
+    void writeReplay(const QString &fileName, const QList<QByteArray> &chunks, int startChunk);
+    static bool isPatPacket(const char *packet);
+    static bool isRandomAccessPacket(const char *packet);
+    static int packetPid(const char *packet);
+    static int sectionOffset(const char *packet);
+    static int programMapPid(const char *packet);
+    static int videoStreamPid(const char *packet);
+
+    qint64 m_window;
+    int m_readFd;
+    QThread *m_readerThread;
+    QElapsedTimer m_clock;
+    mutable QMutex m_mutex;
+    QQueue<Chunk> m_chunks;
+    qint64 m_size;
+    QFutureSynchronizer<void> m_pendingWrites;
+
+    static const int PIPE_SIZE = 1024 * 1024;
+    static const int READ_SIZE = 348 * TS_PACKET_SIZE; // about 64 KiB
+    static const qint64 MAX_SIZE = 128 * 1024 * 1024;
+
+    friend class ReplayBufferReader;
+};
+
+#endif // REPLAYBUFFER_H
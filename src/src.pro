@@ -10,11 +10,12 @@ target.path += $$[QT_INSTALL_PLUGINS]/$${PLUGIN_TYPE}
 INSTALLS = target
 
 CONFIG += link_pkgconfig
-PKGCONFIG += exiv2 libqtubuntu-media-signals libmedia libcamera hybris-egl-platform libpulse-simple libandroid-properties
+PKGCONFIG += exiv2 libturbojpeg libqtubuntu-media-signals libmedia libcamera hybris-egl-platform libpulse libandroid-properties
 
 OTHER_FILES += aalcamera.json
 
 HEADERS += \
+    aalaudioencodersettingscontrol.h \
     aalcameracontrol.h \
     aalcameraflashcontrol.h \
     aalcamerafocuscontrol.h \
@@ -31,11 +32,21 @@ HEADERS += \
     aalviewfindersettingscontrol.h \
     aalcamerainfocontrol.h \
     audiocapture.h \
+    audiolevelmeter.h \
+    audiopipewriter.h \
+    audioringbuffer.h \
+    bitratepolicy.h \
+    devicequirks.h \
+    haleventqueue.h \
+    halrecorder.h \
+    haltrace.h \
+    replaybuffer.h \
     aalcameraexposurecontrol.h \
     storagemanager.h \
     rotationhandler.h
 
 SOURCES += \
+    aalaudioencodersettingscontrol.cpp \
     aalcameracontrol.cpp \
     aalcameraflashcontrol.cpp \
     aalcamerafocuscontrol.cpp \
@@ -52,6 +63,15 @@ SOURCES += \
     aalviewfindersettingscontrol.cpp \
     aalcamerainfocontrol.cpp \
     audiocapture.cpp \
+    audiolevelmeter.cpp \
+    audiopipewriter.cpp \
+    audioringbuffer.cpp \
+    bitratepolicy.cpp \
+    devicequirks.cpp \
+    haleventqueue.cpp \
+    halrecorder.cpp \
+    haltrace.cpp \
+    replaybuffer.cpp \
     aalcameraexposurecontrol.cpp \
     storagemanager.cpp \
     rotationhandler.cpp
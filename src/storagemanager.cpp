@@ -24,9 +24,20 @@
 #include <QCoreApplication>
 #include <QBuffer>
 #include <QImageReader>
+#include <QTransform>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThread>
+#include <QtConcurrent/QtConcurrent>
 
 #include <exiv2/exiv2.hpp>
+#include <turbojpeg.h>
 #include <cmath>
+#include <cstring>
+#include <sys/statfs.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 const QLatin1String photoBase = QLatin1String("image");
 const QLatin1String videoBase = QLatin1String("video");
@@ -34,8 +45,83 @@ const QLatin1String photoExtension = QLatin1String("jpg");
 const QLatin1String videoExtension = QLatin1String("mp4");
 const QLatin1String dateFormat = QLatin1String("yyyyMMdd_HHmmsszzz");
 
-StorageManager::StorageManager(QObject* parent) : QObject(parent)
+const qint64 StorageManager::THROUGHPUT_TEST_SIZE;
+const qint64 StorageManager::DEFAULT_CAPTURE_MEMORY_BUDGET;
+
+/*!
+ * \brief exifOrientation returns the EXIF Orientation of a picture that has to
+ * be rotated clockwise by \p rotation degrees to be viewed upright
+ */
+static uint16_t exifOrientation(int rotation)
+{
+    switch ((rotation % 360 + 360) % 360) {
+    case 90:
+        return 6;
+    case 180:
+        return 3;
+    case 270:
+        return 8;
+    default:
+        return 1;
+    }
+}
+
+/*!
+ * \brief rotationOfExifOrientation returns the clockwise rotation in degrees a
+ * picture of the EXIF Orientation \p orientation needs, or -1 if the picture is
+ * mirrored
+ */
+static int rotationOfExifOrientation(long orientation)
 {
+    switch (orientation) {
+    case 1:
+        return 0;
+    case 6:
+        return 90;
+    case 3:
+        return 180;
+    case 8:
+        return 270;
+    default:
+        return -1;
+    }
+}
+
+/*!
+ * \brief setIdleIoPriority makes the calling thread only get disk time nobody
+ * else wants. ioprio_set() has no glibc wrapper.
+ */
+static void setIdleIoPriority()
+{
+    const int IOPRIO_WHO_PROCESS = 1;
+    const int IOPRIO_CLASS_IDLE = 3;
+    const int IOPRIO_CLASS_SHIFT = 13;
+    if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) != 0) {
+        qWarning() << "Failed to lower the I/O priority of post-processing";
+    }
+}
+
+/*!
+ * \brief temporaryFilesInMemory returns true if temporary files are kept on a
+ * tmpfs, so that a picture written there takes as much memory as its size
+ */
+static bool temporaryFilesInMemory()
+{
+    const long TMPFS_MAGIC = 0x01021994;
+    static const bool inMemory = [] () {
+        struct statfs fs;
+        return statfs(QFile::encodeName(QDir::tempPath()).constData(), &fs) == 0 &&
+               long(fs.f_type) == TMPFS_MAGIC;
+    }();
+    return inMemory;
+}
+
+StorageManager::StorageManager(QObject* parent)
+    : QObject(parent),
+      m_memoryBudget(DEFAULT_CAPTURE_MEMORY_BUDGET),
+      m_memoryInUse(0)
+{
+    m_postProcessing.setMaxThreadCount(1);
 }
 
 QString StorageManager::nextPhotoFileName(const QString &directoy)
@@ -84,6 +170,94 @@ bool StorageManager::checkDirectory(const QString &path) const
     return true;
 }
 
+/*!
+ * \brief StorageManager::measureWriteThroughput measures in the background
+ * how fast data can be written to the directory, so that video recordings
+ * can be kept below it. Nothing happens if it was measured already.
+ */
+void StorageManager::measureWriteThroughput(const QString &directory)
+{
+    QString path = videoDirectory(directory);
+    {
+        QMutexLocker locker(&m_throughputMutex);
+        if (m_writeThroughput.contains(path))
+            return;
+        // Mark the measurement as running
+        m_writeThroughput.insert(path, -1);
+    }
+
+    m_throughputTests.addFuture(QtConcurrent::run(this, &StorageManager::runThroughputTest, path));
+}
+
+/*!
+ * \brief StorageManager::writeThroughput returns how many bytes per second
+ * can be written to the directory, or -1 if it wasn't measured yet
+ */
+qint64 StorageManager::writeThroughput(const QString &directory) const
+{
+    QMutexLocker locker(&m_throughputMutex);
+    return m_writeThroughput.value(videoDirectory(directory), -1);
+}
+
+QString StorageManager::videoDirectory(const QString &directory) const
+{
+    if (!directory.isEmpty())
+        return QDir(directory).absolutePath();
+
+    return QStandardPaths::writableLocation(QStandardPaths::MoviesLocation) + "/" + QCoreApplication::applicationName();
+}
+
+void StorageManager::runThroughputTest(const QString &directory)
+{
+    if (!checkDirectory(directory)) {
+        qWarning() << "Can't measure write throughput of" << directory;
+        forgetThroughputTest(directory);
+        return;
+    }
+
+    QTemporaryFile file(directory + "/.throughputXXXXXX");
+    if (!file.open()) {
+        qWarning() << "Can't measure write throughput of" << directory;
+        forgetThroughputTest(directory);
+        return;
+    }
+
+    // Write the way the muxer does, in large blocks, and include the time
+    // needed to get the data out of the page cache
+    const QByteArray block(1024 * 1024, '\0');
+    QElapsedTimer timer;
+    timer.start();
+    qint64 written = 0;
+    while (written < THROUGHPUT_TEST_SIZE) {
+        if (file.write(block) != block.size())
+            break;
+        written += block.size();
+    }
+    file.flush();
+    fdatasync(file.handle());
+    const qint64 elapsed = qMax(qint64(1), timer.elapsed());
+    file.close();
+
+    if (written < THROUGHPUT_TEST_SIZE) {
+        qWarning() << "Failed to measure write throughput of" << directory;
+        forgetThroughputTest(directory);
+        return;
+    }
+
+    QMutexLocker locker(&m_throughputMutex);
+    m_writeThroughput.insert(directory, written * 1000 / elapsed);
+}
+
+/*!
+ * \brief StorageManager::forgetThroughputTest drops the mark of the failed
+ * measurement of \p directory, so that it can be measured again
+ */
+void StorageManager::forgetThroughputTest(const QString &directory)
+{
+    QMutexLocker locker(&m_throughputMutex);
+    m_writeThroughput.remove(directory);
+}
+
 QString StorageManager::fileNameGenerator(const QString &base, const QString& extension)
 {
     QString date = QDateTime::currentDateTime().toString(dateFormat);
@@ -129,6 +303,23 @@ bool StorageManager::updateJpegMetadata(QByteArray data, QVariantMap metadata, Q
         ed["Exif.Photo.DateTimeOriginal"].setValue(now.toStdString());
         ed["Exif.Photo.DateTimeDigitized"].setValue(now.toStdString());
 
+        // A lossless crop leaves the dimensions and the thumbnail of the
+        // whole picture behind
+        Exiv2::ExifKey widthKey("Exif.Photo.PixelXDimension");
+        Exiv2::ExifKey heightKey("Exif.Photo.PixelYDimension");
+        if (ed.findKey(widthKey) != ed.end() && ed.findKey(heightKey) != ed.end() &&
+            ed[widthKey.key()].toLong() != image->pixelWidth()) {
+            ed[widthKey.key()] = uint32_t(image->pixelWidth());
+            ed[heightKey.key()] = uint32_t(image->pixelHeight());
+            Exiv2::ExifThumb thumbnail(ed);
+            thumbnail.erase();
+        }
+
+        // The picture was left as the sensor took it, viewers rotate it
+        if (metadata.contains("Orientation")) {
+            ed["Exif.Image.Orientation"] = exifOrientation(metadata.value("Orientation").toInt());
+        }
+
         if (metadata.contains("GPSLatitude") &&
             metadata.contains("GPSLongitude") &&
             metadata.contains("GPSTimeStamp")) {
@@ -202,39 +393,86 @@ bool StorageManager::updateJpegMetadata(QByteArray data, QVariantMap metadata, Q
     }
 }
 
-SaveToDiskResult StorageManager::saveJpegImage(QByteArray data, QVariantMap metadata, QString fileName,
-                                               QSize previewResolution, int captureID)
+/*!
+ * \brief StorageManager::captureFileName returns \p fileName, or a new file
+ * name in the directory \p fileName if it is one or in the default directory
+ * if it is empty. Like nextPhotoFileName(), it is only to be called from the
+ * thread owning the storage manager.
+ */
+QString StorageManager::captureFileName(const QString &fileName)
 {
-    SaveToDiskResult result;
-
-    QString captureFile;
     QFileInfo fi(fileName);
     if (fileName.isEmpty() || fi.isDir()) {
-        captureFile = nextPhotoFileName(fileName);
-    } else {
-        captureFile = fileName;
-    }
-    result.fileName = captureFile;
-
-    bool diskOk = checkDirectory(captureFile);
-    if (!diskOk) {
-        result.errorMessage = QString("Won't be able to save file %1 to disk").arg(captureFile);
-        return result;
+        return nextPhotoFileName(fileName);
     }
+    return fileName;
+}
 
+/*!
+ * \brief StorageManager::createPreview decodes the JPEG \p data, or the file
+ * \p fileName if there is no data, scaled down to fit \p resolution and turned
+ * clockwise by \p rotation degrees, and emits it as the preview of the capture
+ * \p captureID
+ */
+void StorageManager::createPreview(QByteArray data, QString fileName, int rotation,
+                                   QSize resolution, int captureID)
+{
     QBuffer buffer(&data);
-    QImageReader reader(&buffer, "jpg");
+    QImageReader reader;
+    if (data.isEmpty()) {
+        reader.setFileName(fileName);
+    } else {
+        reader.setDevice(&buffer);
+    }
+    reader.setFormat("jpg");
 
+    const bool transposed = rotation % 180 != 0;
     QSize scaledSize = reader.size(); // fast, as it does not decode the JPEG
-    scaledSize.scale(previewResolution, Qt::KeepAspectRatio);
+    scaledSize.scale(transposed ? resolution.transposed() : resolution, Qt::KeepAspectRatio);
     reader.setScaledSize(scaledSize);
     reader.setQuality(25);
     QImage image = reader.read();
+    if (rotation != 0) {
+        image = image.transformed(QTransform().rotate(rotation));
+    }
     Q_EMIT previewReady(captureID, image);
+}
+
+/*!
+ * \brief StorageManager::saveJpegImage saves the JPEG \p data to \p fileName,
+ * or to a new file in the directory \p fileName if it is one. The time and the
+ * GPS data of \p metadata are written into its EXIF data, unless \p
+ * updateMetadata is false because the camera wrote them already. An
+ * "Orientation" in \p metadata is the clockwise rotation in degrees the picture
+ * needs, it goes into the EXIF data and is applied to the preview.
+ *
+ * The preview is decoded on another thread while the file is written, and
+ * previewReady() is emitted as soon as it is done. This returns once both are.
+ */
+SaveToDiskResult StorageManager::saveJpegImage(QByteArray data, QVariantMap metadata, QString fileName,
+                                               QSize previewResolution, int captureID, bool updateMetadata)
+{
+    SaveToDiskResult result;
+
+    // Waits for the preview on every return
+    QFutureSynchronizer<void> previewStage;
+    const int rotation = metadata.value("Orientation").toInt() % 360;
+    previewStage.addFuture(QtConcurrent::run(this, &StorageManager::createPreview, data, QString(),
+                                             rotation, previewResolution, captureID));
+
+    QString captureFile = captureFileName(fileName);
+    result.fileName = captureFile;
+
+    bool diskOk = checkDirectory(captureFile);
+    if (!diskOk) {
+        result.errorMessage = QString("Won't be able to save file %1 to disk").arg(captureFile);
+        return result;
+    }
 
     QTemporaryFile file;
-    if (!updateJpegMetadata(data, metadata, &file)) {
-        qWarning() << "Failed to update EXIF timestamps. Picture will be saved as UTC timezone.";
+    if (!updateMetadata || !updateJpegMetadata(data, metadata, &file)) {
+        if (updateMetadata)
+            qWarning() << "Failed to update EXIF timestamps. Picture will be saved as UTC timezone.";
         if (!file.open()) {
             result.errorMessage = QString("Could not open temprary file %1").arg(file.fileName());
             return result;
@@ -259,6 +497,399 @@ SaveToDiskResult StorageManager::saveJpegImage(QByteArray data, QVariantMap meta
     return result;
 }
 
+/*!
+ * \brief StorageManager::spillJpegImage writes the JPEG \p data as it is to a
+ * hidden file next to \p captureFile, so that it doesn't have to be held in
+ * memory until it is saved. The kernel writes it back to the disk when memory
+ * gets short, unlike a file on tmpfs.
+ * \return the name of the spilled file, or an empty string if it could not be
+ * written
+ */
+QString StorageManager::spillJpegImage(const QByteArray &data, const QString &captureFile)
+{
+    if (!checkDirectory(captureFile)) {
+        return QString();
+    }
+
+    QFileInfo fi(captureFile);
+    QFile spill(fi.absolutePath() + "/." + fi.fileName() + ".spill");
+    if (!spill.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to spill" << captureFile << ":" << spill.errorString();
+        return QString();
+    }
+    const qint64 writtenSize = spill.write(data);
+    spill.close();
+    if (writtenSize != data.size()) {
+        qWarning() << "Failed to spill" << captureFile << ":" << spill.errorString();
+        spill.remove();
+        return QString();
+    }
+    return spill.fileName();
+}
+
+/*!
+ * \brief StorageManager::saveSpilledJpegImage saves the JPEG written by
+ * spillJpegImage() to \p spillFile as \p captureFile, like saveJpegImage()
+ * does with one in memory. Unless its EXIF data has to be rewritten, the file
+ * is only renamed.
+ */
+SaveToDiskResult StorageManager::saveSpilledJpegImage(QString spillFile, QVariantMap metadata,
+                                                      QString captureFile, QSize previewResolution,
+                                                      int captureID, bool updateMetadata)
+{
+    SaveToDiskResult result;
+    result.fileName = captureFile;
+
+    const int rotation = metadata.value("Orientation").toInt() % 360;
+    QFuture<void> preview = QtConcurrent::run(this, &StorageManager::createPreview, QByteArray(),
+                                              spillFile, rotation, previewResolution, captureID);
+
+    // The new file goes next to the spilled one rather than to tmpfs
+    QTemporaryFile file(QFileInfo(captureFile).absolutePath() + "/.XXXXXX.jpg");
+    bool rewritten = false;
+    if (updateMetadata) {
+        QFile spill(spillFile);
+        if (spill.open(QIODevice::ReadOnly)) {
+            rewritten = updateJpegMetadata(spill.readAll(), metadata, &file);
+            spill.close();
+        }
+        if (!rewritten)
+            qWarning() << "Failed to update EXIF timestamps. Picture will be saved as UTC timezone.";
+    }
+
+    // The preview is read from the spilled file
+    preview.waitForFinished();
+
+    bool ok;
+    if (rewritten) {
+        ok = QFile::rename(file.fileName(), captureFile);
+        QFile::remove(spillFile);
+    } else {
+        ok = QFile::rename(spillFile, captureFile);
+    }
+    if (!ok) {
+        QFile::remove(spillFile);
+        result.errorMessage = QString("Could not save image to %1").arg(captureFile);
+        return result;
+    }
+
+    result.success = true;
+    return result;
+}
+
+/*!
+ * \brief StorageManager::saveImage encodes \p image as a JPEG of the given
+ * \p quality, rotated clockwise by \p rotation degrees, and saves it like a
+ * picture coming from the camera
+ */
+SaveToDiskResult StorageManager::saveImage(QImage image, int rotation, int quality,
+                                           QVariantMap metadata, QString fileName,
+                                           QSize previewResolution, int captureID)
+{
+    if (image.isNull()) {
+        SaveToDiskResult result;
+        result.errorMessage = QString("No image to save");
+        return result;
+    }
+
+    if (rotation != 0) {
+        image = image.transformed(QTransform().rotate(rotation));
+    }
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    if (!image.save(&buffer, "jpg", quality)) {
+        SaveToDiskResult result;
+        result.errorMessage = QString("Could not encode the image as JPEG");
+        return result;
+    }
+    buffer.close();
+
+    return saveJpegImage(data, metadata, fileName, previewResolution, captureID);
+}
+
+/*!
+ * \brief StorageManager::normalizeOrientation turns the saved picture \p
+ * fileName upright in the background, for the viewers that ignore its EXIF
+ * Orientation. One picture is done at a time at idle I/O priority, so that
+ * capturing is not held up. imageNormalized() is emitted once it is done.
+ */
+void StorageManager::normalizeOrientation(const QString &fileName, int captureID)
+{
+    QtConcurrent::run(&m_postProcessing, this, &StorageManager::runNormalization, fileName, captureID);
+}
+
+void StorageManager::runNormalization(const QString &fileName, int captureID)
+{
+    QThread::currentThread()->setPriority(QThread::IdlePriority);
+    setIdleIoPriority();
+
+    if (rotateLossless(fileName)) {
+        Q_EMIT imageNormalized(captureID, fileName);
+    }
+}
+
+/*!
+ * \brief StorageManager::rotateLossless turns the JPEG \p fileName upright as
+ * its EXIF Orientation says, the way jpegtran does: the DCT blocks are moved
+ * around without decoding or encoding the picture again. The edge blocks which
+ * don't fill a whole MCU are trimmed off. The EXIF Orientation is reset and the
+ * EXIF thumbnail, which isn't turned, is dropped.
+ * \return false if the picture could not be turned, it is left as it was then
+ */
+bool StorageManager::rotateLossless(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed to open" << fileName << "for rotating:" << file.errorString();
+        return false;
+    }
+    QByteArray data = file.readAll();
+    file.close();
+
+    int rotation = 0;
+    try {
+        Exiv2::Image::AutoPtr image = Exiv2::ImageFactory::open(
+                    reinterpret_cast<const Exiv2::byte*>(data.constData()), data.size());
+        image->readMetadata();
+        Exiv2::ExifData &ed = image->exifData();
+        Exiv2::ExifData::const_iterator orientation = ed.findKey(Exiv2::ExifKey("Exif.Image.Orientation"));
+        if (orientation != ed.end()) {
+            rotation = rotationOfExifOrientation(orientation->toLong());
+        }
+    } catch(const Exiv2::AnyError&) {
+        qWarning() << "Failed to read the orientation of" << fileName;
+        return false;
+    }
+
+    if (rotation == 0) {
+        return true;
+    }
+    if (rotation < 0) {
+        qWarning() << "Not rotating the mirrored picture" << fileName;
+        return false;
+    }
+
+    tjhandle handle = tjInitTransform();
+    if (!handle) {
+        qWarning() << "Failed to rotate" << fileName << ":" << tjGetErrorStr();
+        return false;
+    }
+
+    tjtransform transform;
+    memset(&transform, 0, sizeof(transform));
+    transform.op = rotation == 90 ? TJXOP_ROT90 : rotation == 180 ? TJXOP_ROT180 : TJXOP_ROT270;
+    transform.options = TJXOPT_TRIM;
+
+    unsigned char *rotatedData = 0;
+    unsigned long rotatedSize = 0;
+    const int status = tjTransform(handle, reinterpret_cast<unsigned char*>(data.data()), data.size(),
+                                   1, &rotatedData, &rotatedSize, &transform, 0);
+    if (status != 0) {
+        qWarning() << "Failed to rotate" << fileName << ":" << tjGetErrorStr();
+        tjFree(rotatedData);
+        tjDestroy(handle);
+        return false;
+    }
+    const QByteArray rotated(reinterpret_cast<const char*>(rotatedData), rotatedSize);
+    tjFree(rotatedData);
+    tjDestroy(handle);
+
+    // The EXIF data was copied along, it has to describe the turned picture
+    QSaveFile destination(fileName);
+    try {
+        Exiv2::Image::AutoPtr image = Exiv2::ImageFactory::open(
+                    reinterpret_cast<const Exiv2::byte*>(rotated.constData()), rotated.size());
+        image->readMetadata();
+        Exiv2::ExifData ed = image->exifData();
+        ed["Exif.Image.Orientation"] = uint16_t(1);
+
+        // Trimming drops the partial MCUs at the edges, so the size is taken
+        // from the turned picture rather than swapped
+        Exiv2::ExifKey widthKey("Exif.Photo.PixelXDimension");
+        Exiv2::ExifKey heightKey("Exif.Photo.PixelYDimension");
+        if (ed.findKey(widthKey) != ed.end() && ed.findKey(heightKey) != ed.end()) {
+            ed[widthKey.key()] = uint32_t(image->pixelWidth());
+            ed[heightKey.key()] = uint32_t(image->pixelHeight());
+        }
+
+        Exiv2::ExifThumb thumbnail(ed);
+        thumbnail.erase();
+
+        image->setExifData(ed);
+        image->writeMetadata();
+
+        if (!destination.open(QIODevice::WriteOnly)) {
+            qWarning() << "Failed to write the rotated" << fileName << ":" << destination.errorString();
+            return false;
+        }
+        Exiv2::BasicIo& io = image->io();
+        const long size = io.size();
+        const char* modified = reinterpret_cast<const char*>(io.mmap());
+        const qint64 writtenSize = destination.write(modified, size);
+        io.munmap();
+        if (writtenSize != size) {
+            qWarning() << "Failed to write the rotated" << fileName << ":" << destination.errorString();
+            destination.cancelWriting();
+            return false;
+        }
+    } catch(const Exiv2::AnyError&) {
+        qWarning() << "Failed to update the EXIF data of the rotated" << fileName;
+        return false;
+    }
+
+    if (!destination.commit()) {
+        qWarning() << "Failed to replace" << fileName << "by the rotated picture:" << destination.errorString();
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief StorageManager::cropLossless returns the middle of the JPEG \p data
+ * magnified \p zoom times, cut out without decoding or encoding it again. The
+ * cut is moved to the nearest MCU boundary above and left of the middle, as a
+ * lossless crop can only start there.
+ * \return the cut out JPEG, or \p data if it could not be cut
+ */
+QByteArray StorageManager::cropLossless(const QByteArray &data, qreal zoom)
+{
+    if (zoom <= 1.0) {
+        return data;
+    }
+
+    tjhandle handle = tjInitTransform();
+    if (!handle) {
+        qWarning() << "Failed to crop the picture:" << tjGetErrorStr();
+        return data;
+    }
+
+    QByteArray source = data;
+    unsigned char *sourceData = reinterpret_cast<unsigned char*>(source.data());
+    int width = 0;
+    int height = 0;
+    int subsampling = 0;
+    if (tjDecompressHeader2(handle, sourceData, source.size(), &width, &height, &subsampling) != 0) {
+        qWarning() << "Failed to crop the picture:" << tjGetErrorStr();
+        tjDestroy(handle);
+        return data;
+    }
+
+    const int mcuWidth = tjMCUWidth[subsampling];
+    const int mcuHeight = tjMCUHeight[subsampling];
+    tjtransform transform;
+    memset(&transform, 0, sizeof(transform));
+    transform.op = TJXOP_NONE;
+    transform.options = TJXOPT_CROP;
+    transform.r.w = qMax(mcuWidth, qRound(width / zoom));
+    transform.r.h = qMax(mcuHeight, qRound(height / zoom));
+    transform.r.x = (width - transform.r.w) / 2 / mcuWidth * mcuWidth;
+    transform.r.y = (height - transform.r.h) / 2 / mcuHeight * mcuHeight;
+
+    unsigned char *croppedData = 0;
+    unsigned long croppedSize = 0;
+    const int status = tjTransform(handle, sourceData, source.size(), 1, &croppedData, &croppedSize, &transform, 0);
+    QByteArray cropped;
+    if (status == 0) {
+        cropped = QByteArray(reinterpret_cast<const char*>(croppedData), croppedSize);
+    } else {
+        qWarning() << "Failed to crop the picture:" << tjGetErrorStr();
+    }
+    tjFree(croppedData);
+    tjDestroy(handle);
+
+    return cropped.isEmpty() ? data : cropped;
+}
+
+/*!
+ * \brief StorageManager::setCaptureMemoryBudget sets how many \p bytes the
+ * captures being saved may hold in memory together
+ */
+void StorageManager::setCaptureMemoryBudget(qint64 bytes)
+{
+    QMutexLocker locker(&m_memoryMutex);
+    m_memoryBudget = bytes;
+}
+
+qint64 StorageManager::captureMemoryBudget() const
+{
+    QMutexLocker locker(&m_memoryMutex);
+    return m_memoryBudget;
+}
+
+/*!
+ * \brief StorageManager::captureMemoryInUse returns how many bytes the captures
+ * being saved hold in memory together
+ */
+qint64 StorageManager::captureMemoryInUse() const
+{
+    QMutexLocker locker(&m_memoryMutex);
+    return m_memoryInUse;
+}
+
+/*!
+ * \brief StorageManager::captureMemoryCost returns how many bytes saving a JPEG
+ * of \p jpegSize bytes takes, with a preview of \p previewResolution. Held in
+ * memory there are its copy, the new JPEG Exiv2 writes when \p updateMetadata
+ * and the temporary file if that is on tmpfs. Once \p spilled, only the
+ * preview is, and the JPEG read back for Exiv2.
+ */
+qint64 StorageManager::captureMemoryCost(qint64 jpegSize, const QSize &previewResolution,
+                                         bool updateMetadata, bool spilled) const
+{
+    // The preview is decoded in 32 bits per pixel
+    qint64 cost = qint64(previewResolution.width()) * previewResolution.height() * 4;
+    if (spilled) {
+        return updateMetadata ? cost + 2 * jpegSize : cost;
+    }
+
+    cost += jpegSize;
+    if (updateMetadata) {
+        cost += jpegSize;
+    }
+    if (temporaryFilesInMemory()) {
+        cost += jpegSize;
+    }
+    return cost;
+}
+
+/*!
+ * \brief StorageManager::fitsCaptureMemory returns true if \p bytes more fit
+ * into the budget. A capture always fits when there is no other, so that one
+ * bigger than the whole budget can still be taken.
+ */
+bool StorageManager::fitsCaptureMemory(qint64 bytes) const
+{
+    QMutexLocker locker(&m_memoryMutex);
+    return m_memoryInUse == 0 || m_memoryInUse + bytes <= m_memoryBudget;
+}
+
+/*!
+ * \brief StorageManager::reserveCaptureMemory accounts \p bytes to a capture
+ * being saved if they fit into the budget, or anyway if \p force is true
+ * \return true if the bytes were reserved
+ */
+bool StorageManager::reserveCaptureMemory(qint64 bytes, bool force)
+{
+    QMutexLocker locker(&m_memoryMutex);
+    if (!force && m_memoryInUse != 0 && m_memoryInUse + bytes > m_memoryBudget) {
+        return false;
+    }
+    m_memoryInUse += bytes;
+    return true;
+}
+
+/*!
+ * \brief StorageManager::releaseCaptureMemory gives back the \p bytes reserved
+ * for a capture that was saved
+ */
+void StorageManager::releaseCaptureMemory(qint64 bytes)
+{
+    QMutexLocker locker(&m_memoryMutex);
+    m_memoryInUse = qMax(qint64(0), m_memoryInUse - bytes);
+}
+
 QString StorageManager::decimalToExifRational(double decimal)
 {
     decimal = fabs(decimal);
@@ -17,10 +17,14 @@
 #ifndef STORAGEMANAGER_H
 #define STORAGEMANAGER_H
 
+#include <QHash>
+#include <QMutex>
 #include <QString>
 #include <QVariantMap>
 #include <QByteArray>
+#include <QFutureSynchronizer>
 #include <QTemporaryFile>
+#include <QThreadPool>
 #include <QImage>
 
 class SaveToDiskResult
@@ -44,19 +48,62 @@ public:
 
     bool checkDirectory(const QString &path) const;
 
+    void measureWriteThroughput(const QString &directory = QString());
+    qint64 writeThroughput(const QString &directory = QString()) const;
+
+    QString captureFileName(const QString &fileName);
     SaveToDiskResult saveJpegImage(QByteArray data, QVariantMap metadata,
                                    QString fileName, QSize previewResolution,
-                                   int captureID);
+                                   int captureID, bool updateMetadata = true);
+    QString spillJpegImage(const QByteArray &data, const QString &captureFile);
+    SaveToDiskResult saveSpilledJpegImage(QString spillFile, QVariantMap metadata,
+                                          QString captureFile, QSize previewResolution,
+                                          int captureID, bool updateMetadata = true);
+    SaveToDiskResult saveImage(QImage image, int rotation, int quality,
+                               QVariantMap metadata, QString fileName,
+                               QSize previewResolution, int captureID);
+
+    void normalizeOrientation(const QString &fileName, int captureID);
+    bool rotateLossless(const QString &fileName);
+    QByteArray cropLossless(const QByteArray &data, qreal zoom);
+
+    void setCaptureMemoryBudget(qint64 bytes);
+    qint64 captureMemoryBudget() const;
+    qint64 captureMemoryInUse() const;
+    qint64 captureMemoryCost(qint64 jpegSize, const QSize &previewResolution,
+                             bool updateMetadata, bool spilled) const;
+    bool fitsCaptureMemory(qint64 bytes) const;
+    bool reserveCaptureMemory(qint64 bytes, bool force = false);
+    void releaseCaptureMemory(qint64 bytes);
 
 Q_SIGNALS:
     void previewReady(int captureID, QImage image);
+    void imageNormalized(int captureID, QString fileName);
 
 private:
     QString fileNameGenerator(const QString &base, const QString &extension);
     bool updateJpegMetadata(QByteArray data, QVariantMap metadata, QTemporaryFile* destination);
     QString decimalToExifRational(double decimal);
+    QString videoDirectory(const QString &directory) const;
+    void runThroughputTest(const QString &directory);
+    void forgetThroughputTest(const QString &directory);
+    void runNormalization(const QString &fileName, int captureID);
+    void createPreview(QByteArray data, QString fileName, int rotation,
+                       QSize resolution, int captureID);
 
     QString m_directory;
+    mutable QMutex m_throughputMutex;
+    QHash<QString, qint64> m_writeThroughput;
+    mutable QMutex m_memoryMutex;
+    qint64 m_memoryBudget;
+    qint64 m_memoryInUse;
+    // Declared last so that running measurements and post-processing finish
+    // before the rest goes
+    QFutureSynchronizer<void> m_throughputTests;
+    QThreadPool m_postProcessing;
+
+    static const qint64 THROUGHPUT_TEST_SIZE = 8 * 1024 * 1024;
+    static const qint64 DEFAULT_CAPTURE_MEMORY_BUDGET = 64 * 1024 * 1024;
 };
 
 #endif // STORAGEMANAGER_H
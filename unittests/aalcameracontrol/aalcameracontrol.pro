@@ -13,6 +13,8 @@ HEADERS += ../../src/aalcameracontrol.h \
 
 SOURCES += tst_aalcameracontrol.cpp \
     ../../src/aalcameracontrol.cpp \
+    ../../src/halrecorder.cpp \
+    ../../src/haltrace.cpp \
     aalcameraservice.cpp
 
 check.depends = $${TARGET}
@@ -15,8 +15,7 @@
  */
 
 #include "aalcameraservice.h"
-
-AalCameraService *AalCameraService::m_service = 0;
+#include "haleventqueue.h"
 
 class CameraControl {};
 
@@ -104,3 +103,13 @@ QSize AalCameraService::selectSizeWithAspectRatio(const QList<QSize> &sizes, flo
     Q_UNUSED(targetAspectRatio);
     return QSize();
 }
+
+void AalCameraService::postHalEvent(HalEvent *event)
+{
+    delete event;
+}
+
+void AalCameraService::customEvent(QEvent *event)
+{
+    QMediaService::customEvent(event);
+}
@@ -13,6 +13,8 @@ HEADERS += ../../src/aalcameraexposurecontrol.h \
 
 SOURCES += tst_aalcameraexposurecontrol.cpp \
     ../../src/aalcameraexposurecontrol.cpp \
+    ../../src/halrecorder.cpp \
+    ../../src/haltrace.cpp \
     aalcameraservice.cpp
 
 check.depends = $${TARGET}
@@ -15,12 +15,11 @@
  */
 
 #include "aalcameraservice.h"
+#include "haleventqueue.h"
 #include "aalcameraexposurecontrol.h"
 #include "camera_control.h"
 #include "camera_compatibility_layer.h"
 
-AalCameraService *AalCameraService::m_service = 0;
-
 AalCameraService::AalCameraService(QObject *parent) :
     QMediaService(parent),
     m_androidControl(0),
@@ -94,3 +93,13 @@ QSize AalCameraService::selectSizeWithAspectRatio(const QList<QSize> &sizes, flo
     Q_UNUSED(targetAspectRatio);
     return QSize();
 }
+
+void AalCameraService::postHalEvent(HalEvent *event)
+{
+    delete event;
+}
+
+void AalCameraService::customEvent(QEvent *event)
+{
+    QMediaService::customEvent(event);
+}
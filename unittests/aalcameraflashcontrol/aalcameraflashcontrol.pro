@@ -14,6 +14,8 @@ HEADERS += ../../src/aalcameraflashcontrol.h \
 
 SOURCES += tst_aalcameraflashcontrol.cpp \
     ../../src/aalcameraflashcontrol.cpp \
+    ../../src/halrecorder.cpp \
+    ../../src/haltrace.cpp \
     ../stubs/aalcameracontrol_stub.cpp \
     aalcameraservice.cpp
 
@@ -15,10 +15,9 @@
  */
 
 #include "aalcameraservice.h"
+#include "haleventqueue.h"
 #include "aalcameracontrol.h"
 
-AalCameraService *AalCameraService::m_service = 0;
-
 AalCameraService::AalCameraService(QObject *parent) :
     QMediaService(parent),
     m_androidControl(0),
@@ -96,3 +95,13 @@ QSize AalCameraService::selectSizeWithAspectRatio(const QList<QSize> &sizes, flo
     Q_UNUSED(targetAspectRatio);
     return QSize();
 }
+
+void AalCameraService::postHalEvent(HalEvent *event)
+{
+    delete event;
+}
+
+void AalCameraService::customEvent(QEvent *event)
+{
+    QMediaService::customEvent(event);
+}
@@ -15,6 +15,8 @@ HEADERS += ../../src/aalcamerafocuscontrol.h \
 
 SOURCES += tst_aalcamerafocuscontrol.cpp \
     ../../src/aalcamerafocuscontrol.cpp \
+    ../../src/halrecorder.cpp \
+    ../../src/haltrace.cpp \
     storagemanager.cpp \
     aalcameraservice.cpp \
     aalimagecapturecontrol.cpp
@@ -15,8 +15,8 @@
  */
 
 #include "aalcameraservice.h"
-
-AalCameraService *AalCameraService::m_service = 0;
+#include "aalcamerafocuscontrol.h"
+#include "haleventqueue.h"
 
 AalCameraService::AalCameraService(QObject *parent) :
     QMediaService(parent),
@@ -83,3 +83,15 @@ QSize AalCameraService::selectSizeWithAspectRatio(const QList<QSize> &sizes, flo
     Q_UNUSED(targetAspectRatio);
     return QSize();
 }
+
+void AalCameraService::postHalEvent(HalEvent *event)
+{
+    if (event->type == HalEvent::Focus)
+        m_focusControl->m_focusRunning = false;
+    delete event;
+}
+
+void AalCameraService::customEvent(QEvent *event)
+{
+    QMediaService::customEvent(event);
+}
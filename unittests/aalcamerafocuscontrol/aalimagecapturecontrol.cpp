@@ -68,3 +68,7 @@ void AalImageCaptureControl::saveJpeg(const QByteArray& data)
     Q_UNUSED(data);
 }
 
+void AalImageCaptureControl::onPreviewReady()
+{
+}
+
@@ -55,13 +55,15 @@ bool StorageManager::updateJpegMetadata(QByteArray data, QVariantMap metadata, Q
 }
 
 SaveToDiskResult StorageManager::saveJpegImage(QByteArray data, QVariantMap metadata,
-                                               QString fileName, QSize previewResolution, int captureID)
+                                               QString fileName, QSize previewResolution, int captureID,
+                                               bool updateMetadata)
 {
     Q_UNUSED(data);
     Q_UNUSED(metadata);
     Q_UNUSED(fileName);
     Q_UNUSED(captureID);
     Q_UNUSED(previewResolution);
+    Q_UNUSED(updateMetadata);
     return SaveToDiskResult();
 }
 
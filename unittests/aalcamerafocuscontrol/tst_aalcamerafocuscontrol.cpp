@@ -17,9 +17,8 @@
 #include <QtTest/QtTest>
 #include <QSignalSpy>
 
-#include "aalcameraservice.h"
-
 #define private public
+#include "aalcameraservice.h"
 #include "aalcamerafocuscontrol.h"
 
 class tst_AalCameraFocusControl : public QObject
@@ -35,6 +34,7 @@ private slots:
     void focusPointMode();
     void point2Region_data();
     void point2Region();
+    void focusCallbackPerService();
 
 private:
     AalCameraFocusControl *m_focusControl;
@@ -157,6 +157,25 @@ void tst_AalCameraFocusControl::point2Region()
 }
 
 
+void tst_AalCameraFocusControl::focusCallbackPerService()
+{
+    AalCameraService otherService;
+    AalCameraFocusControl otherFocusControl(&otherService);
+    m_service->m_focusControl = m_focusControl;
+    otherService.m_focusControl = &otherFocusControl;
+
+    m_focusControl->m_focusRunning = true;
+    otherFocusControl.m_focusRunning = true;
+
+    // The HAL hands back the service the listener was registered by
+    AalCameraFocusControl::focusCB(&otherService);
+    QCOMPARE(otherFocusControl.m_focusRunning, false);
+    QCOMPARE(m_focusControl->m_focusRunning, true);
+
+    AalCameraFocusControl::focusCB(m_service);
+    QCOMPARE(m_focusControl->m_focusRunning, false);
+}
+
 QTEST_GUILESS_MAIN(tst_AalCameraFocusControl)
 
 #include "tst_aalcamerafocuscontrol.moc"
@@ -14,6 +14,8 @@ HEADERS += ../../src/aalcamerazoomcontrol.h \
 
 SOURCES += tst_aalcamerazoomcontrol.cpp \
     ../../src/aalcamerazoomcontrol.cpp \
+    ../../src/halrecorder.cpp \
+    ../../src/haltrace.cpp \
     ../stubs/aalcameracontrol_stub.cpp \
     aalcameraservice.cpp
 
@@ -9,16 +9,27 @@ INCLUDEPATH += ../../src
 INCLUDEPATH += ../mocks/aal
 
 HEADERS += ../../src/aalmediarecordercontrol.h \
+    ../../src/aalaudioencodersettingscontrol.h \
     ../../src/aalcameraservice.h \
     ../../src/aalvideoencodersettingscontrol.h \
     ../../src/aalmetadatawritercontrol.h \
     ../../src/audiocapture.h \
+    ../../src/audiolevelmeter.h \
+    ../../src/replaybuffer.h \
     ../../src/storagemanager.h \
     ../../src/rotationhandler.h
 
 SOURCES += tst_aalmediarecordercontrol.cpp \
     ../stubs/audiocapture_stub.cpp \
+    ../stubs/replaybuffer_stub.cpp \
     ../../src/aalmediarecordercontrol.cpp \
+    ../../src/audiolevelmeter.cpp \
+    ../../src/audiopipewriter.cpp \
+    ../../src/audioringbuffer.cpp \
+    ../../src/bitratepolicy.cpp \
+    ../../src/halrecorder.cpp \
+    ../../src/haltrace.cpp \
+    ../stubs/aalaudioencodersettingscontrol_stub.cpp \
     ../stubs/aalcameraservice_stub.cpp \
     ../stubs/aalvideoencodersettingscontrol_stub.cpp \
     ../stubs/aalmetadatawritercontrol_stub.cpp \
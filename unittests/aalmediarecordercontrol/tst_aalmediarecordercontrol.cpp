@@ -18,6 +18,8 @@
 #include <QtTest/QtTest>
 #include <QUrl>
 
+#include <limits>
+
 #include "aalcameraservice.h"
 
 #define private public
@@ -31,6 +33,13 @@ private slots:
     void cleanupTestCase();
 
     void setState();
+    void durationFollowsClock();
+    void durationExcludesPause();
+    void notEnoughStorage();
+    void segmentRollover();
+    void audioSyncSettings();
+    void audioCapturePersists();
+    void audioLevel();
 
 private:
     AalMediaRecorderControl *m_recorderControl;
@@ -64,14 +73,193 @@ void tst_AalMediaRecorderControl::setState()
     QCOMPARE(m_recorderControl->status(), QMediaRecorder::RecordingStatus);
 
     m_recorderControl->setState(QMediaRecorder::PausedState);
+    QCOMPARE(m_recorderControl->state(), QMediaRecorder::PausedState);
+    QCOMPARE(m_recorderControl->status(), QMediaRecorder::PausedStatus);
+
+    m_recorderControl->setState(QMediaRecorder::RecordingState);
     QCOMPARE(m_recorderControl->state(), QMediaRecorder::RecordingState);
     QCOMPARE(m_recorderControl->status(), QMediaRecorder::RecordingStatus);
 
+    m_recorderControl->setState(QMediaRecorder::PausedState);
     m_recorderControl->setState(QMediaRecorder::StoppedState);
     QCOMPARE(m_recorderControl->state(), QMediaRecorder::StoppedState);
     QCOMPARE(m_recorderControl->status(), QMediaRecorder::UnloadedStatus);
 }
 
+void tst_AalMediaRecorderControl::durationFollowsClock()
+{
+    QString fileName("/tmp/videotest.avi");
+    QFile::remove(fileName);
+    m_recorderControl->setOutputLocation(QUrl(fileName));
+
+    m_recorderControl->setState(QMediaRecorder::RecordingState);
+    QCOMPARE(m_recorderControl->state(), QMediaRecorder::RecordingState);
+
+    // Block the event loop so the duration timer can't tick in time
+    QTest::qSleep(300);
+    m_recorderControl->updateDuration();
+    QVERIFY(m_recorderControl->duration() >= 300);
+
+    m_recorderControl->setState(QMediaRecorder::StoppedState);
+    QVERIFY(m_recorderControl->duration() >= 300);
+
+    RecordingStatistics statistics = m_recorderControl->statistics();
+    QCOMPARE(statistics.bytesWritten, qint64(0));
+    QVERIFY(statistics.freeSpace > 0);
+}
+
+void tst_AalMediaRecorderControl::durationExcludesPause()
+{
+    QString fileName("/tmp/videotest.avi");
+    QFile::remove(fileName);
+    m_recorderControl->setOutputLocation(QUrl(fileName));
+
+    m_recorderControl->setState(QMediaRecorder::RecordingState);
+    QTest::qSleep(200);
+    m_recorderControl->setState(QMediaRecorder::PausedState);
+    QCOMPARE(m_recorderControl->state(), QMediaRecorder::PausedState);
+    qint64 pausedDuration = m_recorderControl->duration();
+    QVERIFY(pausedDuration >= 200);
+
+    QTest::qSleep(500);
+    m_recorderControl->updateDuration();
+    QCOMPARE(m_recorderControl->duration(), pausedDuration);
+
+    m_recorderControl->setState(QMediaRecorder::RecordingState);
+    QTest::qSleep(200);
+    m_recorderControl->setState(QMediaRecorder::StoppedState);
+    QVERIFY(m_recorderControl->duration() >= pausedDuration + 200);
+    QVERIFY(m_recorderControl->duration() < pausedDuration + 500);
+}
+
+void tst_AalMediaRecorderControl::notEnoughStorage()
+{
+    QString fileName("/tmp/videotest.avi");
+    QFile::remove(fileName);
+    m_recorderControl->setOutputLocation(QUrl(fileName));
+
+    QSignalSpy errorSpy(m_recorderControl, SIGNAL(error(int,QString)));
+    m_recorderControl->setStorageReserve(std::numeric_limits<qint64>::max() / 2);
+
+    m_recorderControl->setState(QMediaRecorder::RecordingState);
+    QCOMPARE(m_recorderControl->state(), QMediaRecorder::StoppedState);
+    QCOMPARE(m_recorderControl->status(), QMediaRecorder::UnloadedStatus);
+    QCOMPARE(errorSpy.count(), 1);
+    QCOMPARE(errorSpy.at(0).at(0).toInt(), AalMediaRecorderControl::RECORDER_STORAGE_FULL_ERROR);
+
+    m_recorderControl->setStorageReserve(AalMediaRecorderControl::DEFAULT_STORAGE_RESERVE);
+}
+
+void tst_AalMediaRecorderControl::segmentRollover()
+{
+    QString fileName("/tmp/videotest.avi");
+    m_recorderControl->setOutputLocation(QUrl(fileName));
+    m_recorderControl->setSegmentDuration(100);
+
+    QSignalSpy startedSpy(m_recorderControl, SIGNAL(segmentStarted(int,QUrl)));
+    QSignalSpy finishedSpy(m_recorderControl, SIGNAL(segmentFinished(int,QUrl)));
+
+    m_recorderControl->setState(QMediaRecorder::RecordingState);
+    QCOMPARE(m_recorderControl->state(), QMediaRecorder::RecordingState);
+    QCOMPARE(startedSpy.count(), 1);
+    QCOMPARE(startedSpy.at(0).at(1).toUrl(), QUrl::fromLocalFile("/tmp/videotest_00000.avi"));
+
+    QTRY_VERIFY(startedSpy.count() >= 2);
+    QCOMPARE(startedSpy.at(1).at(0).toInt(), 1);
+    QCOMPARE(startedSpy.at(1).at(1).toUrl(), QUrl::fromLocalFile("/tmp/videotest_00001.avi"));
+    QCOMPARE(m_recorderControl->state(), QMediaRecorder::RecordingState);
+    QCOMPARE(m_recorderControl->status(), QMediaRecorder::RecordingStatus);
+
+    m_recorderControl->setState(QMediaRecorder::StoppedState);
+    QCOMPARE(m_recorderControl->state(), QMediaRecorder::StoppedState);
+    QCOMPARE(finishedSpy.count(), startedSpy.count());
+    QVERIFY(QFile::exists("/tmp/videotest_00000.avi"));
+
+    for (int i = 0; i < startedSpy.count(); ++i)
+        QFile::remove(startedSpy.at(i).at(1).toUrl().toLocalFile());
+    m_recorderControl->setSegmentDuration(0);
+}
+
+void tst_AalMediaRecorderControl::audioSyncSettings()
+{
+    QCOMPARE(m_recorderControl->audioSyncCorrection(), true);
+    QCOMPARE(m_recorderControl->audioSyncTolerance(), qint64(AudioCapture::DEFAULT_SYNC_TOLERANCE / 1000));
+
+    m_recorderControl->setAudioSyncCorrection(false);
+    m_recorderControl->setAudioSyncTolerance(100);
+
+    QString fileName("/tmp/videotest.avi");
+    QFile::remove(fileName);
+    m_recorderControl->setOutputLocation(QUrl(fileName));
+    m_recorderControl->setState(QMediaRecorder::RecordingState);
+
+    AudioCapture *audioCapture = m_recorderControl->audioCapture();
+    QVERIFY(audioCapture != 0);
+    QCOMPARE(audioCapture->syncCorrection(), false);
+    QCOMPARE(audioCapture->syncTolerance(), 100000);
+
+    m_recorderControl->setState(QMediaRecorder::StoppedState);
+    QCOMPARE(m_recorderControl->audioSyncStatistics().gaps, 0);
+
+    m_recorderControl->setAudioSyncCorrection(true);
+    m_recorderControl->setAudioSyncTolerance(AudioCapture::DEFAULT_SYNC_TOLERANCE / 1000);
+}
+
+void tst_AalMediaRecorderControl::audioCapturePersists()
+{
+    QString fileName("/tmp/videotest.avi");
+    QFile::remove(fileName);
+    m_recorderControl->setOutputLocation(QUrl(fileName));
+
+    m_recorderControl->prepareAudioCapture();
+    AudioCapture *audioCapture = m_recorderControl->audioCapture();
+    QVERIFY(audioCapture != 0);
+
+    for (int i = 0; i < 2; ++i) {
+        m_recorderControl->setState(QMediaRecorder::RecordingState);
+        QVERIFY(m_recorderControl->m_audioCaptureAvailable);
+        m_recorderControl->setState(QMediaRecorder::StoppedState);
+        QCOMPARE(m_recorderControl->audioCapture(), audioCapture);
+    }
+
+    m_recorderControl->releaseAudioCapture();
+    QVERIFY(m_recorderControl->audioCapture() == 0);
+}
+
+void tst_AalMediaRecorderControl::audioLevel()
+{
+    QString fileName("/tmp/videotest.avi");
+    QFile::remove(fileName);
+    m_recorderControl->setOutputLocation(QUrl(fileName));
+    QSignalSpy spy(m_recorderControl, SIGNAL(audioLevelChanged()));
+
+    QCOMPARE(m_recorderControl->audioLevelMetering(), false);
+    m_recorderControl->setAudioLevelMetering(true);
+    m_recorderControl->setState(QMediaRecorder::RecordingState);
+
+    AudioCapture *audioCapture = m_recorderControl->audioCapture();
+    QVERIFY(audioCapture != 0);
+    QCOMPARE(audioCapture->levelMetering(), true);
+    QVERIFY(m_recorderControl->m_audioLevelTimer->isActive());
+
+    // Full scale peak, half scale RMS
+    audioCapture->m_levels[0].store(int(0xffff | (0x8000 << 16)));
+    QCOMPARE(m_recorderControl->audioLevel().peak, qreal(1));
+    QVERIFY(qAbs(m_recorderControl->audioLevel().rms - 0.5) < 0.001);
+    QTRY_VERIFY(spy.count() > 0);
+
+    // Stopping lets the display fall back to silence, once
+    spy.clear();
+    m_recorderControl->setState(QMediaRecorder::StoppedState);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(m_recorderControl->audioLevel().peak, qreal(0));
+    QVERIFY(!m_recorderControl->m_audioLevelTimer->isActive());
+
+    audioCapture->m_levels[0].store(0);
+    m_recorderControl->setAudioLevelMetering(false);
+    QCOMPARE(spy.count(), 1);
+}
+
 QTEST_GUILESS_MAIN(tst_AalMediaRecorderControl)
 
 #include "tst_aalmediarecordercontrol.moc"
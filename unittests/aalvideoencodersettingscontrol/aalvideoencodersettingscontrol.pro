@@ -0,0 +1,28 @@
+include(../../coverage.pri)
+
+TARGET = tst_aalvideoencodersettingscontrol
+
+QT += testlib multimedia opengl
+
+LIBS += -L../mocks/aal -laal
+INCLUDEPATH += ../../src
+INCLUDEPATH += ../mocks/aal
+
+HEADERS += ../../src/aalvideoencodersettingscontrol.h \
+    ../../src/aalcameracontrol.h \
+    ../../src/aalcameraservice.h
+
+SOURCES += tst_aalvideoencodersettingscontrol.cpp \
+    ../../src/aalvideoencodersettingscontrol.cpp \
+    ../../src/bitratepolicy.cpp \
+    ../../src/devicequirks.cpp \
+    ../../src/halrecorder.cpp \
+    ../../src/haltrace.cpp \
+    ../stubs/aalcameracontrol_stub.cpp \
+    ../stubs/aalvideodeviceselectorcontrol_stub.cpp \
+    aalcameraservice.cpp \
+    aalviewfindersettingscontrol.cpp
+
+check.depends = $${TARGET}
+check.commands = ./$${TARGET}
+QMAKE_EXTRA_TARGETS += check
@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+
+#include "aalcameraservice.h"
+#include "bitratepolicy.h"
+#include "halsimulation.h"
+#include "properties.h"
+
+#define private public
+#include "aalvideodeviceselectorcontrol.h"
+#include "aalvideoencodersettingscontrol.h"
+
+class tst_AalVideoEncoderSettingsControl : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+    void queryFrameRates();
+    void highFrameRates();
+    void highFrameRatesPerDevice();
+    void malformedHighFrameRates();
+    void supportedResolutions();
+    void hasEncoder();
+    void derivedBitRate();
+
+private:
+    void writeFile(const QString &fileName, const QByteArray &content);
+
+    AalVideoEncoderSettingsControl *m_encoderControl;
+    AalCameraService *m_service;
+    QTemporaryDir m_codecsDir;
+};
+
+void tst_AalVideoEncoderSettingsControl::initTestCase()
+{
+    // Reports a preview frame rate range of up to 30 fps
+    HalSimulation::setDeviceSimulated(true);
+    m_service = new AalCameraService();
+    m_service->connectCamera();
+    m_encoderControl = new AalVideoEncoderSettingsControl(m_service);
+}
+
+void tst_AalVideoEncoderSettingsControl::cleanupTestCase()
+{
+    delete m_encoderControl;
+    delete m_service;
+    HalSimulation::setDeviceSimulated(false);
+}
+
+void tst_AalVideoEncoderSettingsControl::init()
+{
+    m_encoderControl->m_frameRates.clear();
+    m_encoderControl->m_highFrameRates.clear();
+    m_service->deviceSelector()->m_currentDevice = 0;
+}
+
+void tst_AalVideoEncoderSettingsControl::cleanup()
+{
+    property_set("aal.camera.hfr.0", "");
+    property_set("aal.camera.hfr.1", "");
+}
+
+void tst_AalVideoEncoderSettingsControl::queryFrameRates()
+{
+    QList<qreal> expected;
+    expected << 15 << 24 << 25 << 30;
+    QCOMPARE(m_encoderControl->supportedFrameRates(QVideoEncoderSettings()), expected);
+    QVERIFY(!m_encoderControl->isHighFrameRate(30));
+    QCOMPARE(m_encoderControl->maximumResolution(30), QSize());
+}
+
+void tst_AalVideoEncoderSettingsControl::highFrameRates()
+{
+    property_set("aal.camera.hfr.0", "240:640x480,120:1280x720");
+
+    QList<qreal> expected;
+    expected << 15 << 24 << 25 << 30 << 120 << 240;
+    QCOMPARE(m_encoderControl->supportedFrameRates(QVideoEncoderSettings()), expected);
+    QVERIFY(m_encoderControl->isHighFrameRate(120));
+    QVERIFY(m_encoderControl->isHighFrameRate(240));
+    QCOMPARE(m_encoderControl->maximumResolution(120), QSize(1280, 720));
+    QCOMPARE(m_encoderControl->maximumResolution(240), QSize(640, 480));
+
+    // Only the frame rates available at the resolution are offered
+    QVideoEncoderSettings settings;
+    settings.setResolution(1280, 720);
+    expected.removeAll(240);
+    QCOMPARE(m_encoderControl->supportedFrameRates(settings), expected);
+
+    settings.setResolution(1920, 1080);
+    expected.removeAll(120);
+    QCOMPARE(m_encoderControl->supportedFrameRates(settings), expected);
+}
+
+void tst_AalVideoEncoderSettingsControl::highFrameRatesPerDevice()
+{
+    property_set("aal.camera.hfr.1", "120:1280x720");
+
+    QVERIFY(!m_encoderControl->supportedFrameRates(QVideoEncoderSettings()).contains(120));
+
+    m_service->deviceSelector()->m_currentDevice = 1;
+    QVERIFY(m_encoderControl->supportedFrameRates(QVideoEncoderSettings()).contains(120));
+    QVERIFY(m_encoderControl->isHighFrameRate(120));
+}
+
+void tst_AalVideoEncoderSettingsControl::malformedHighFrameRates()
+{
+    property_set("aal.camera.hfr.0", "abc, 120:1280, 60x:1x1, 0:640x480, 90:640x480:1, 120:1280x720");
+    for (int i = 0; i < 5; ++i)
+        QTest::ignoreMessage(QtWarningMsg, QRegularExpression("^Invalid high frame rate mode"));
+
+    QList<qreal> expected;
+    expected << 15 << 24 << 25 << 30 << 120;
+    QCOMPARE(m_encoderControl->supportedFrameRates(QVideoEncoderSettings()), expected);
+    QCOMPARE(m_encoderControl->maximumResolution(120), QSize(1280, 720));
+    QVERIFY(!m_encoderControl->isHighFrameRate(60));
+    QVERIFY(!m_encoderControl->isHighFrameRate(90));
+}
+
+void tst_AalVideoEncoderSettingsControl::supportedResolutions()
+{
+    property_set("aal.camera.hfr.0", "120:1280x720");
+
+    QList<QSize> sizes;
+    sizes << QSize(1920, 1080) << QSize(1280, 720) << QSize(640, 480);
+    m_encoderControl->m_availableSizes = sizes;
+
+    QVideoEncoderSettings settings;
+    settings.setFrameRate(30);
+    QCOMPARE(m_encoderControl->supportedResolutions(settings), sizes);
+
+    settings.setFrameRate(120);
+    sizes.removeFirst();
+    QCOMPARE(m_encoderControl->supportedResolutions(settings), sizes);
+}
+
+void tst_AalVideoEncoderSettingsControl::writeFile(const QString &fileName, const QByteArray &content)
+{
+    QFile file(m_codecsDir.path() + "/" + fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(content);
+}
+
+void tst_AalVideoEncoderSettingsControl::hasEncoder()
+{
+    QVERIFY(m_codecsDir.isValid());
+    const QString dir = m_codecsDir.path() + "/";
+
+    writeFile("decoders.xml",
+              "<MediaCodecs><Decoders>"
+              "<MediaCodec name=\"OMX.hevc.decoder\" type=\"video/hevc\"/>"
+              "</Decoders></MediaCodecs>");
+    QVERIFY(!AalVideoEncoderSettingsControl::hasEncoder(dir + "decoders.xml", "video/hevc"));
+
+    writeFile("encoders.xml",
+              "<MediaCodecs><Encoders>"
+              "<MediaCodec name=\"OMX.avc.encoder\" type=\"video/avc\"/>"
+              "<MediaCodec name=\"OMX.multi.encoder\"><Type name=\"video/hevc\"/></MediaCodec>"
+              "</Encoders></MediaCodecs>");
+    QVERIFY(AalVideoEncoderSettingsControl::hasEncoder(dir + "encoders.xml", "video/hevc"));
+    QVERIFY(AalVideoEncoderSettingsControl::hasEncoder(dir + "encoders.xml", "video/avc"));
+    QVERIFY(!AalVideoEncoderSettingsControl::hasEncoder(dir + "encoders.xml", "video/mp4v-es"));
+
+    // Vendors split the list into included files
+    writeFile("media_codecs.xml",
+              "<MediaCodecs><Include href=\"decoders.xml\"/><Include href=\"encoders.xml\"/></MediaCodecs>");
+    QVERIFY(AalVideoEncoderSettingsControl::hasEncoder(dir + "media_codecs.xml", "video/hevc"));
+
+    // Includes going round in circles end
+    writeFile("loop.xml", "<MediaCodecs><Include href=\"loop.xml\"/></MediaCodecs>");
+    QVERIFY(!AalVideoEncoderSettingsControl::hasEncoder(dir + "loop.xml", "video/hevc"));
+
+    writeFile("broken.xml", "<MediaCodecs><Encoders><MediaCodec");
+    QVERIFY(!AalVideoEncoderSettingsControl::hasEncoder(dir + "broken.xml", "video/hevc"));
+    QVERIFY(!AalVideoEncoderSettingsControl::hasEncoder(dir + "missing.xml", "video/hevc"));
+}
+
+void tst_AalVideoEncoderSettingsControl::derivedBitRate()
+{
+    QList<QSize> sizes;
+    sizes << QSize(1920, 1080) << QSize(1280, 720);
+    m_encoderControl->m_availableSizes = sizes;
+
+    QVideoEncoderSettings settings;
+    settings.setCodec("H.264");
+    settings.setFrameRate(30);
+    settings.setResolution(1920, 1080);
+    settings.setQuality(QMultimedia::NormalQuality);
+    settings.setEncodingMode(QMultimedia::AverageBitRateEncoding);
+    settings.setBitRate(1234567);
+    m_encoderControl->setVideoSettings(settings);
+    QCOMPARE(m_encoderControl->videoSettings().bitRate(), 1234567);
+
+    // Without a bitrate it is derived from the new resolution again
+    settings.setResolution(1280, 720);
+    settings.setBitRate(0);
+    m_encoderControl->setVideoSettings(settings);
+    QCOMPARE(m_encoderControl->videoSettings().bitRate(),
+             BitratePolicy::videoBitRate(QSize(1280, 720), 30, QMultimedia::NormalQuality));
+}
+
+QTEST_GUILESS_MAIN(tst_AalVideoEncoderSettingsControl)
+
+#include "tst_aalvideoencodersettingscontrol.moc"
@@ -0,0 +1,26 @@
+include(../../coverage.pri)
+
+TARGET = tst_aalvideorenderercontrol
+
+QT += testlib multimedia opengl
+
+CONFIG += link_pkgconfig
+PKGCONFIG += libqtubuntu-media-signals
+
+LIBS += -L../mocks/aal -laal
+INCLUDEPATH += ../../src
+INCLUDEPATH += ../mocks/aal
+
+HEADERS += ../../src/aalvideorenderercontrol.h \
+    ../../src/aalcameraservice.h
+
+SOURCES += tst_aalvideorenderercontrol.cpp \
+    ../../src/aalvideorenderercontrol.cpp \
+    ../../src/halrecorder.cpp \
+    ../../src/haltrace.cpp \
+    aalcameraservice.cpp \
+    aalviewfindersettingscontrol.cpp
+
+check.depends = $${TARGET}
+check.commands = ./$${TARGET}
+QMAKE_EXTRA_TARGETS += check
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "aalviewfindersettingscontrol.h"
+#include "aalcameraservice.h"
+
+AalViewfinderSettingsControl::AalViewfinderSettingsControl(AalCameraService *service, QObject *parent)
+    :QCameraViewfinderSettingsControl(parent),
+      m_service(service),
+      m_currentSize(),
+      m_aspectRatio(0.0),
+      m_currentFPS(30),
+      m_minFPS(10),
+      m_maxFPS(30),
+      m_requestedFPS(0)
+{
+}
+
+AalViewfinderSettingsControl::~AalViewfinderSettingsControl()
+{
+}
+
+bool AalViewfinderSettingsControl::isViewfinderParameterSupported(ViewfinderParameter parameter) const
+{
+    Q_UNUSED(parameter);
+    return false;
+}
+
+void AalViewfinderSettingsControl::setViewfinderParameter(ViewfinderParameter parameter, const QVariant &value)
+{
+    Q_UNUSED(parameter);
+    Q_UNUSED(value);
+}
+
+QVariant AalViewfinderSettingsControl::viewfinderParameter(ViewfinderParameter parameter) const
+{
+    Q_UNUSED(parameter);
+    return QVariant();
+}
+
+QSize AalViewfinderSettingsControl::currentSize() const
+{
+    return m_currentSize;
+}
+
+const QList<QSize> &AalViewfinderSettingsControl::supportedSizes() const
+{
+    return m_availableSizes;
+}
+
+void AalViewfinderSettingsControl::setAspectRatio(float ratio)
+{
+    m_aspectRatio = ratio;
+}
+
+void AalViewfinderSettingsControl::setFrameRate(int fps, const QSize &maximumSize)
+{
+    m_requestedFPS = fps;
+    m_maximumSize = maximumSize;
+}
+
+void AalViewfinderSettingsControl::resetAllSettings()
+{
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest/QtTest>
+#include <QAbstractVideoSurface>
+
+#include <qtubuntu_media_signals.h>
+
+#define private public
+#include "aalcameraservice.h"
+#include "aalvideorenderercontrol.h"
+#include "aalviewfindersettingscontrol.h"
+
+class TestSurface : public QAbstractVideoSurface
+{
+public:
+    QList<QVideoFrame::PixelFormat> supportedPixelFormats(
+            QAbstractVideoBuffer::HandleType handleType = QAbstractVideoBuffer::NoHandle) const
+    {
+        Q_UNUSED(handleType);
+        return QList<QVideoFrame::PixelFormat>() << QVideoFrame::Format_RGB32;
+    }
+
+    bool present(const QVideoFrame &frame)
+    {
+        Q_UNUSED(frame);
+        return true;
+    }
+};
+
+class tst_AalVideoRendererControl : public QObject
+{
+    Q_OBJECT
+private slots:
+    void textureCallbackPerService();
+    void snapshotCallbackPerService();
+
+private:
+    void setUp(AalCameraService *service, AalVideoRendererControl *renderer, QAbstractVideoSurface *surface);
+};
+
+void tst_AalVideoRendererControl::textureCallbackPerService()
+{
+    AalCameraService service;
+    AalCameraService otherService;
+    AalVideoRendererControl renderer(&service);
+    AalVideoRendererControl otherRenderer(&otherService);
+    TestSurface surface;
+    TestSurface otherSurface;
+    setUp(&service, &renderer, &surface);
+    setUp(&otherService, &otherRenderer, &otherSurface);
+
+    // Both viewfinders show a frame without a texture and wait for one
+    renderer.updateViewfinderFrame();
+    otherRenderer.updateViewfinderFrame();
+
+    Q_EMIT SharedSignal::instance()->textureCreated(1);
+    QTRY_COMPARE(renderer.m_textureId, GLuint(1));
+    QCOMPARE(otherRenderer.m_textureId, GLuint(0));
+
+    Q_EMIT SharedSignal::instance()->textureCreated(2);
+    QTRY_COMPARE(otherRenderer.m_textureId, GLuint(2));
+    QCOMPARE(renderer.m_textureId, GLuint(1));
+
+    // A texture neither of them waits for is left to other video nodes
+    Q_EMIT SharedSignal::instance()->textureCreated(3);
+    QTest::qWait(50);
+    QCOMPARE(renderer.m_textureId, GLuint(1));
+    QCOMPARE(otherRenderer.m_textureId, GLuint(2));
+}
+
+void tst_AalVideoRendererControl::snapshotCallbackPerService()
+{
+    AalCameraService service;
+    AalCameraService otherService;
+    AalVideoRendererControl renderer(&service);
+    AalVideoRendererControl otherRenderer(&otherService);
+    TestSurface surface;
+    TestSurface otherSurface;
+    setUp(&service, &renderer, &surface);
+    setUp(&otherService, &otherRenderer, &otherSurface);
+    renderer.m_textureId = 1;
+    otherRenderer.m_textureId = 2;
+
+    QSignalSpy previewSpy(&renderer, SIGNAL(previewReady()));
+    QSignalSpy otherPreviewSpy(&otherRenderer, SIGNAL(previewReady()));
+
+    QVERIFY(renderer.createPreview());
+    QImage image(640, 480, QImage::Format_RGB32);
+    image.fill(Qt::red);
+    Q_EMIT SharedSignal::instance()->snapshotTaken(image);
+    QTRY_COMPARE(previewSpy.count(), 1);
+    QCOMPARE(renderer.preview(), image);
+    QCOMPARE(otherPreviewSpy.count(), 0);
+    QVERIFY(otherRenderer.preview().isNull());
+
+    QVERIFY(otherRenderer.createPreview());
+    QImage otherImage(640, 480, QImage::Format_RGB32);
+    otherImage.fill(Qt::blue);
+    Q_EMIT SharedSignal::instance()->snapshotTaken(otherImage);
+    QTRY_COMPARE(otherPreviewSpy.count(), 1);
+    QCOMPARE(otherRenderer.preview(), otherImage);
+    QCOMPARE(previewSpy.count(), 1);
+    QCOMPARE(renderer.preview(), image);
+
+    // A snapshot neither of them asked for is dropped
+    Q_EMIT SharedSignal::instance()->snapshotTaken(otherImage);
+    QTest::qWait(50);
+    QCOMPARE(previewSpy.count(), 1);
+    QCOMPARE(otherPreviewSpy.count(), 1);
+}
+
+void tst_AalVideoRendererControl::setUp(AalCameraService *service, AalVideoRendererControl *renderer,
+                                        QAbstractVideoSurface *surface)
+{
+    QVERIFY(service->connectCamera());
+    service->m_viewfinderControl->m_currentSize = QSize(640, 480);
+    renderer->setSurface(surface);
+}
+
+QTEST_GUILESS_MAIN(tst_AalVideoRendererControl)
+
+#include "tst_aalvideorenderercontrol.moc"
@@ -15,10 +15,9 @@
  */
 
 #include "aalcameraservice.h"
+#include "haleventqueue.h"
 #include <cmath>
 
-AalCameraService *AalCameraService::m_service = 0;
-
 AalCameraService::AalCameraService(QObject *parent) :
     QMediaService(parent),
     m_androidControl(0),
@@ -112,3 +111,13 @@ QSize AalCameraService::selectSizeWithAspectRatio(const QList<QSize> &sizes, flo
     return selectedSize;
 }
 
+void AalCameraService::postHalEvent(HalEvent *event)
+{
+    delete event;
+}
+
+void AalCameraService::customEvent(QEvent *event)
+{
+    QMediaService::customEvent(event);
+}
+
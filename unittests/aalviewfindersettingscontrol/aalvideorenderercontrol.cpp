@@ -73,3 +73,13 @@ void AalVideoRendererControl::onSnapshotTaken(QImage snapshotImage)
 {
     Q_UNUSED(snapshotImage);
 }
+
+void AalSharedSignalDispatcher::onTextureCreated(unsigned int textureID)
+{
+    Q_UNUSED(textureID);
+}
+
+void AalSharedSignalDispatcher::onSnapshotTaken(QImage snapshotImage)
+{
+    Q_UNUSED(snapshotImage);
+}
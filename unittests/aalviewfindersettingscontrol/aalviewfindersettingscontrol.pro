@@ -14,6 +14,8 @@ HEADERS += ../../src/aalviewfindersettingscontrol.h \
 
 SOURCES += tst_aalviewfindersettingscontrol.cpp \
     ../../src/aalviewfindersettingscontrol.cpp \
+    ../../src/halrecorder.cpp \
+    ../../src/haltrace.cpp \
     aalcameraservice.cpp \
     aalvideorenderercontrol.cpp
 
@@ -36,6 +36,7 @@ private slots:
     void chooseOptimalSizeEmpty();
     void chooseOptimalSize0AspectRatio();
     void chooseOptimalSize0AspectRatioEmpty();
+    void chooseOptimalSizeMaximumSize();
 
 private:
     AalViewfinderSettingsControl *m_vfControl;
@@ -124,6 +125,24 @@ void tst_AalViewfinderSettingsControl::chooseOptimalSize0AspectRatioEmpty()
     QCOMPARE(m_vfControl->chooseOptimalSize(resolutions), QSize());
 }
 
+void tst_AalViewfinderSettingsControl::chooseOptimalSizeMaximumSize()
+{
+    m_vfControl->m_aspectRatio = (float)16 / (float)9;
+    m_vfControl->m_maximumSize = QSize(1280, 720);
+    QList<QSize> resolutions;
+    resolutions.append(QSize(1920, 1080));
+    resolutions.append(QSize(1280, 720));
+    resolutions.append(QSize(960, 720));
+
+    QCOMPARE(m_vfControl->chooseOptimalSize(resolutions), QSize(1280, 720));
+
+    m_vfControl->m_maximumSize = QSize(640, 480);
+    QCOMPARE(m_vfControl->chooseOptimalSize(resolutions), QSize());
+
+    m_vfControl->m_maximumSize = QSize();
+    QCOMPARE(m_vfControl->chooseOptimalSize(resolutions), QSize(1920, 1080));
+}
+
 QTEST_GUILESS_MAIN(tst_AalViewfinderSettingsControl)
 
 #include "tst_aalviewfindersettingscontrol.moc"
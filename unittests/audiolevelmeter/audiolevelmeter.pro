@@ -0,0 +1,16 @@
+include(../../coverage.pri)
+
+TARGET = tst_audiolevelmeter
+
+QT += testlib
+
+HEADERS += ../../src/audiolevelmeter.h
+
+SOURCES += tst_audiolevelmeter.cpp \
+    ../../src/audiolevelmeter.cpp
+
+INCLUDEPATH += ../../src
+
+check.depends = $${TARGET}
+check.commands = ./$${TARGET}
+QMAKE_EXTRA_TARGETS += check
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest/QtTest>
+
+#include <limits>
+
+#include "audiolevelmeter.h"
+
+class tst_AudioLevelMeter : public QObject
+{
+    Q_OBJECT
+private slots:
+    void silence();
+    void fullScale();
+    void matchesReference_data();
+    void matchesReference();
+    void perChannel();
+    void throughput();
+};
+
+static void referenceLevels(const QVector<int16_t> &samples, int channels,
+                            int *peaks, qint64 *sumsOfSquares)
+{
+    for (int i = 0; i < samples.size(); ++i) {
+        const int sample = samples[i];
+        peaks[i % channels] = qMax(peaks[i % channels], qMin(qAbs(sample), 32767));
+        sumsOfSquares[i % channels] += sample * sample;
+    }
+}
+
+void tst_AudioLevelMeter::silence()
+{
+    QVector<int16_t> samples(960, 0);
+    AudioLevel level;
+    AudioLevelMeter::measure(samples.constData(), samples.size(), 1, &level);
+    QCOMPARE(level.peak, qreal(0));
+    QCOMPARE(level.rms, qreal(0));
+
+    AudioLevelMeter::measure(samples.constData(), 0, 1, &level);
+    QCOMPARE(level.rms, qreal(0));
+}
+
+void tst_AudioLevelMeter::fullScale()
+{
+    // The most negative sample must not wrap around when taking its absolute value
+    QVector<int16_t> samples(64, std::numeric_limits<int16_t>::min());
+    AudioLevel level;
+    AudioLevelMeter::measure(samples.constData(), samples.size(), 1, &level);
+    QCOMPARE(level.peak, qreal(1));
+    QCOMPARE(level.rms, qreal(1));
+
+    // A full scale square wave
+    for (int i = 0; i < samples.size(); ++i)
+        samples[i] = i % 2 ? 32767 : -32767;
+    AudioLevelMeter::measure(samples.constData(), samples.size(), 1, &level);
+    QCOMPARE(level.peak, qreal(1));
+    QCOMPARE(level.rms, qreal(1));
+}
+
+void tst_AudioLevelMeter::matchesReference_data()
+{
+    QTest::addColumn<int>("channels");
+    QTest::addColumn<int>("frames");
+
+    QTest::newRow("mono, less than a vector") << 1 << 7;
+    QTest::newRow("mono, with a tail") << 1 << 961;
+    QTest::newRow("stereo") << 2 << 480;
+    QTest::newRow("stereo, with a tail") << 2 << 483;
+    QTest::newRow("three channels") << 3 << 100;
+    QTest::newRow("four channels") << 4 << 101;
+}
+
+void tst_AudioLevelMeter::matchesReference()
+{
+    QFETCH(int, channels);
+    QFETCH(int, frames);
+
+    qsrand(frames);
+    QVector<int16_t> samples(frames * channels);
+    for (int i = 0; i < samples.size(); ++i)
+        samples[i] = int16_t(qrand() - RAND_MAX / 2);
+    samples[samples.size() / 2] = std::numeric_limits<int16_t>::min();
+
+    int expectedPeaks[AudioLevelMeter::MAX_CHANNELS] = { 0 };
+    qint64 expectedSums[AudioLevelMeter::MAX_CHANNELS] = { 0 };
+    referenceLevels(samples, channels, expectedPeaks, expectedSums);
+
+    int peaks[AudioLevelMeter::MAX_CHANNELS] = { 0 };
+    qint64 sums[AudioLevelMeter::MAX_CHANNELS] = { 0 };
+    AudioLevelMeter::accumulate(samples.constData(), frames, channels, peaks, sums);
+
+    for (int c = 0; c < channels; ++c) {
+        QCOMPARE(peaks[c], expectedPeaks[c]);
+        QCOMPARE(sums[c], expectedSums[c]);
+    }
+}
+
+void tst_AudioLevelMeter::perChannel()
+{
+    // Left at half scale, right silent
+    QVector<int16_t> samples(2 * 480);
+    for (int i = 0; i < samples.size(); i += 2) {
+        samples[i] = (i / 2) % 2 ? 16384 : -16384;
+        samples[i + 1] = 0;
+    }
+
+    AudioLevel levels[2];
+    AudioLevelMeter::measure(samples.constData(), samples.size() / 2, 2, levels);
+    QVERIFY(qAbs(levels[0].peak - 0.5) < 0.001);
+    QVERIFY(qAbs(levels[0].rms - 0.5) < 0.001);
+    QCOMPARE(levels[1].peak, qreal(0));
+    QCOMPARE(levels[1].rms, qreal(0));
+}
+
+void tst_AudioLevelMeter::throughput()
+{
+    // One 20ms fragment at 48kHz, as the microphone delivers it
+    QVector<int16_t> samples(960);
+    for (int i = 0; i < samples.size(); ++i)
+        samples[i] = int16_t(qrand());
+
+    AudioLevel level;
+    QBENCHMARK {
+        AudioLevelMeter::measure(samples.constData(), samples.size(), 1, &level);
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_AudioLevelMeter)
+
+#include "tst_audiolevelmeter.moc"
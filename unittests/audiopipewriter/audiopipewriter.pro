@@ -0,0 +1,18 @@
+include(../../coverage.pri)
+
+TARGET = tst_audiopipewriter
+
+QT += testlib
+
+HEADERS += ../../src/audiopipewriter.h \
+    ../../src/audioringbuffer.h
+
+SOURCES += tst_audiopipewriter.cpp \
+    ../../src/audiopipewriter.cpp \
+    ../../src/audioringbuffer.cpp
+
+INCLUDEPATH += ../../src
+
+check.depends = $${TARGET}
+check.commands = ./$${TARGET}
+QMAKE_EXTRA_TARGETS += check
@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest/QtTest>
+#include <QThread>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "audiopipewriter.h"
+#include "audioringbuffer.h"
+
+// 48 kHz mono 16 bit, as captured by AudioCapture
+static const int BYTES_PER_SECOND = 48000 * 2;
+// One 20 msec Pulseaudio fragment
+static const int FRAGMENT_SIZE = BYTES_PER_SECOND / 50;
+
+class PipeReader : public QThread
+{
+public:
+    PipeReader(int fd) : m_fd(fd), m_received(0), m_corrupted(false) {}
+
+    qint64 received() const { return m_received; }
+    bool corrupted() const { return m_corrupted; }
+
+protected:
+    void run()
+    {
+        char buffer[4096];
+        unsigned char expected = 0;
+        ssize_t size;
+        while ((size = read(m_fd, buffer, sizeof(buffer))) > 0) {
+            for (int i = 0; i < size; ++i) {
+                if ((unsigned char)buffer[i] != expected++)
+                    m_corrupted = true;
+            }
+            m_received += size;
+        }
+    }
+
+private:
+    int m_fd;
+    qint64 m_received;
+    bool m_corrupted;
+};
+
+class tst_AudioPipeWriter : public QObject
+{
+    Q_OBJECT
+private slots:
+    void init();
+    void cleanup();
+    void transfer_data();
+    void transfer();
+    void cpuPerAudioSecond_data();
+    void cpuPerAudioSecond();
+
+private:
+    void transferAudio(AudioRingBuffer *buffer, AudioPipeWriter *writer, qint64 size);
+    void closeWriteEnd();
+
+    int m_pipe[2];
+    unsigned char m_value;
+};
+
+void tst_AudioPipeWriter::init()
+{
+    QVERIFY(pipe2(m_pipe, O_NONBLOCK) == 0);
+    // Only the writer side is non-blocking, like /dev/socket/micshm
+    fcntl(m_pipe[0], F_SETFL, 0);
+    m_value = 0;
+}
+
+void tst_AudioPipeWriter::cleanup()
+{
+    closeWriteEnd();
+    close(m_pipe[0]);
+}
+
+void tst_AudioPipeWriter::closeWriteEnd()
+{
+    if (m_pipe[1] >= 0) {
+        close(m_pipe[1]);
+        m_pipe[1] = -1;
+    }
+}
+
+/*!
+ * \brief Produces \p size bytes of audio in Pulseaudio sized fragments and
+ * writes them to the pipe as AudioCapture::run() does
+ */
+void tst_AudioPipeWriter::transferAudio(AudioRingBuffer *buffer, AudioPipeWriter *writer, qint64 size)
+{
+    char fragment[FRAGMENT_SIZE];
+    qint64 produced = 0;
+
+    while (produced < size || writer->unwritten() > 0) {
+        if (produced < size) {
+            int count = qMin(qint64(FRAGMENT_SIZE), size - produced);
+            for (int i = 0; i < count; ++i)
+                fragment[i] = char(m_value + i);
+            count = buffer->write(fragment, count);
+            m_value += count;
+            produced += count;
+        }
+
+        ssize_t num = writer->write();
+        QVERIFY(num >= 0);
+        if (num == 0 && writer->unwritten() > 0) {
+            struct pollfd pipeFd = { writer->pipe(), POLLOUT, 0 };
+            poll(&pipeFd, 1, 10);
+        }
+    }
+}
+
+void tst_AudioPipeWriter::transfer_data()
+{
+    QTest::addColumn<bool>("zeroCopy");
+
+    QTest::newRow("write") << false;
+    QTest::newRow("vmsplice") << true;
+}
+
+void tst_AudioPipeWriter::transfer()
+{
+    QFETCH(bool, zeroCopy);
+
+    AudioRingBuffer buffer(64 * 1024);
+    AudioPipeWriter writer(&buffer);
+    writer.setPipe(m_pipe[1]);
+    writer.setZeroCopy(zeroCopy);
+
+    PipeReader reader(m_pipe[0]);
+    reader.start();
+
+    const qint64 size = 30 * BYTES_PER_SECOND;
+    transferAudio(&buffer, &writer, size);
+    closeWriteEnd();
+
+    QVERIFY(reader.wait(10000));
+    QCOMPARE(reader.received(), size);
+    QVERIFY(!reader.corrupted());
+    QCOMPARE(writer.zeroCopy(), zeroCopy);
+}
+
+void tst_AudioPipeWriter::cpuPerAudioSecond_data()
+{
+    transfer_data();
+}
+
+/*!
+ * \brief Measures the CPU time the writer side needs per second of audio.
+ * Run with -tickcounter or -perf for cycle counts.
+ */
+void tst_AudioPipeWriter::cpuPerAudioSecond()
+{
+    QFETCH(bool, zeroCopy);
+
+    AudioRingBuffer buffer(256 * 1024);
+    AudioPipeWriter writer(&buffer);
+    writer.setPipe(m_pipe[1]);
+    writer.setZeroCopy(zeroCopy);
+
+    PipeReader reader(m_pipe[0]);
+    reader.start();
+
+    int seconds = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+    QBENCHMARK {
+        transferAudio(&buffer, &writer, BYTES_PER_SECOND);
+        seconds++;
+    }
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+
+    closeWriteEnd();
+    QVERIFY(reader.wait(10000));
+    QVERIFY(!reader.corrupted());
+
+    const double cpuUsec = (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+    qDebug("%s: %.1f usec of CPU per second of audio", QTest::currentDataTag(), cpuUsec / seconds);
+}
+
+QTEST_GUILESS_MAIN(tst_AudioPipeWriter);
+
+#include "tst_audiopipewriter.moc"
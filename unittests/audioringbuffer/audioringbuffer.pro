@@ -0,0 +1,16 @@
+include(../../coverage.pri)
+
+TARGET = tst_audioringbuffer
+
+QT += testlib
+
+HEADERS += ../../src/audioringbuffer.h
+
+SOURCES += tst_audioringbuffer.cpp \
+    ../../src/audioringbuffer.cpp
+
+INCLUDEPATH += ../../src
+
+check.depends = $${TARGET}
+check.commands = ./$${TARGET}
+QMAKE_EXTRA_TARGETS += check
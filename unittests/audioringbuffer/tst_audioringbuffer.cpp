@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest/QtTest>
+#include <QThread>
+
+#include <unistd.h>
+
+#include "audioringbuffer.h"
+
+class Producer : public QThread
+{
+public:
+    Producer(AudioRingBuffer *buffer, int total)
+        : m_buffer(buffer), m_total(total) {}
+
+protected:
+    void run()
+    {
+        char chunk[333];
+        unsigned char value = 0;
+        int written = 0;
+        while (written < m_total) {
+            int size = qMin(int(sizeof(chunk)), m_total - written);
+            for (int i = 0; i < size; ++i)
+                chunk[i] = char(value + i);
+            int count = m_buffer->write(chunk, size);
+            value += count;
+            written += count;
+            if (count == 0)
+                yieldCurrentThread();
+        }
+    }
+
+private:
+    AudioRingBuffer *m_buffer;
+    int m_total;
+};
+
+class tst_AudioRingBuffer : public QObject
+{
+    Q_OBJECT
+private slots:
+    void capacity();
+    void wrapAround();
+    void fullBuffer();
+    void producerConsumer();
+};
+
+void tst_AudioRingBuffer::capacity()
+{
+    const int pageSize = sysconf(_SC_PAGESIZE);
+
+    AudioRingBuffer small(8);
+    QCOMPARE(small.capacity(), pageSize);
+
+    AudioRingBuffer buffer(pageSize * 3);
+    QCOMPARE(buffer.capacity(), pageSize * 4);
+    QCOMPARE(buffer.available(), 0);
+    QCOMPARE(buffer.freeSpace(), pageSize * 4);
+}
+
+void tst_AudioRingBuffer::wrapAround()
+{
+    AudioRingBuffer buffer(8);
+    const int capacity = buffer.capacity();
+    const QByteArray head(capacity - 2, 'a');
+    const char *data = 0;
+
+    QCOMPARE(buffer.write(head.constData(), head.size()), head.size());
+    QCOMPARE(buffer.peek(&data), head.size());
+    buffer.consume(head.size() - 2);
+    QCOMPARE(buffer.available(), 2);
+
+    // Wraps around the end of the storage
+    QCOMPARE(buffer.write("bcdef", 5), 5);
+    QCOMPARE(buffer.available(), 7);
+    QCOMPARE(buffer.peek(&data), 4);
+    QCOMPARE(QByteArray(data, 4), QByteArray("aabc"));
+    QCOMPARE(buffer.peek(&data, 4), 3);
+    QCOMPARE(QByteArray(data, 3), QByteArray("def"));
+    QCOMPARE(buffer.peek(&data, 7), 0);
+    buffer.consume(4);
+    QCOMPARE(buffer.peek(&data), 3);
+    QCOMPARE(QByteArray(data, 3), QByteArray("def"));
+    buffer.consume(3);
+    QCOMPARE(buffer.available(), 0);
+}
+
+void tst_AudioRingBuffer::fullBuffer()
+{
+    AudioRingBuffer buffer(8);
+    const QByteArray data(buffer.capacity() + 10, 'x');
+
+    QCOMPARE(buffer.write(data.constData(), data.size()), buffer.capacity());
+    QCOMPARE(buffer.freeSpace(), 0);
+    QCOMPARE(buffer.write("x", 1), 0);
+
+    buffer.clear();
+    QCOMPARE(buffer.available(), 0);
+    QCOMPARE(buffer.write("x", 1), 1);
+}
+
+void tst_AudioRingBuffer::producerConsumer()
+{
+    const int total = 4 * 1024 * 1024;
+    AudioRingBuffer buffer(4096);
+    Producer producer(&buffer, total);
+    producer.start();
+
+    unsigned char expected = 0;
+    int read = 0;
+    while (read < total) {
+        const char *data = 0;
+        int size = buffer.peek(&data);
+        for (int i = 0; i < size; ++i) {
+            if ((unsigned char)data[i] != expected)
+                QFAIL(qPrintable(QString("Unexpected byte at offset %1").arg(read + i)));
+            expected++;
+        }
+        buffer.consume(size);
+        read += size;
+        if (size == 0)
+            QThread::yieldCurrentThread();
+    }
+
+    QVERIFY(producer.wait(10000));
+    QCOMPARE(buffer.available(), 0);
+}
+
+QTEST_GUILESS_MAIN(tst_AudioRingBuffer);
+
+#include "tst_audioringbuffer.moc"
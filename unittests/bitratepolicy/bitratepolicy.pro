@@ -0,0 +1,16 @@
+include(../../coverage.pri)
+
+TARGET = tst_bitratepolicy
+
+QT += testlib multimedia
+
+HEADERS += ../../src/bitratepolicy.h
+
+SOURCES += tst_bitratepolicy.cpp \
+    ../../src/bitratepolicy.cpp
+
+INCLUDEPATH += ../../src
+
+check.depends = $${TARGET}
+check.commands = ./$${TARGET}
+QMAKE_EXTRA_TARGETS += check
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest/QtTest>
+
+#include "bitratepolicy.h"
+
+class tst_BitratePolicy : public QObject
+{
+    Q_OBJECT
+private slots:
+    void videoBitRate_data();
+    void videoBitRate();
+    void qualityOrdering();
+    void audioBitRate();
+    void capToThroughput();
+};
+
+void tst_BitratePolicy::videoBitRate_data()
+{
+    QTest::addColumn<QSize>("resolution");
+    QTest::addColumn<qreal>("frameRate");
+    QTest::addColumn<int>("minimum");
+    QTest::addColumn<int>("maximum");
+
+    QTest::newRow("720p30") << QSize(1280, 720) << qreal(30) << 6451200 << 6451200;
+    QTest::newRow("invalid") << QSize() << qreal(0) << 6451200 << 6451200;
+    QTest::newRow("VGA") << QSize(640, 480) << qreal(30) << 2500000 << 3200000;
+    QTest::newRow("1080p30") << QSize(1920, 1080) << qreal(30) << 11000000 << 12500000;
+    QTest::newRow("720p60") << QSize(1280, 720) << qreal(60) << 9500000 << 10000000;
+    QTest::newRow("2160p30") << QSize(3840, 2160) << qreal(30) << 32000000 << 35000000;
+    QTest::newRow("tiny") << QSize(16, 16) << qreal(1) << BitratePolicy::MINIMUM_VIDEO_BITRATE
+                          << BitratePolicy::MINIMUM_VIDEO_BITRATE;
+}
+
+void tst_BitratePolicy::videoBitRate()
+{
+    QFETCH(QSize, resolution);
+    QFETCH(qreal, frameRate);
+    QFETCH(int, minimum);
+    QFETCH(int, maximum);
+
+    int bitRate = BitratePolicy::videoBitRate(resolution, frameRate);
+    QVERIFY2(bitRate >= minimum && bitRate <= maximum, qPrintable(QString::number(bitRate)));
+}
+
+void tst_BitratePolicy::qualityOrdering()
+{
+    QSize size(1920, 1080);
+    int low = BitratePolicy::videoBitRate(size, 30, QMultimedia::LowQuality);
+    int normal = BitratePolicy::videoBitRate(size, 30, QMultimedia::NormalQuality);
+    int high = BitratePolicy::videoBitRate(size, 30, QMultimedia::HighQuality);
+
+    QVERIFY(low < normal);
+    QVERIFY(normal < high);
+}
+
+void tst_BitratePolicy::audioBitRate()
+{
+    QCOMPARE(BitratePolicy::audioBitRate(2), 48000);
+    QCOMPARE(BitratePolicy::audioBitRate(1), 24000);
+    QCOMPARE(BitratePolicy::audioBitRate(0), 24000);
+    QVERIFY(BitratePolicy::audioBitRate(2, QMultimedia::HighQuality) > 48000);
+}
+
+void tst_BitratePolicy::capToThroughput()
+{
+    // Unknown throughput
+    QCOMPARE(BitratePolicy::capVideoBitRate(20000000, 48000, -1), 20000000);
+
+    // 10 MB/s is plenty for 20 Mb/s
+    QCOMPARE(BitratePolicy::capVideoBitRate(20000000, 48000, 10000000), 20000000);
+
+    // 2 MB/s leaves 8 Mb/s for the recording
+    QCOMPARE(BitratePolicy::capVideoBitRate(20000000, 48000, 2000000), 8000000 - 48000);
+
+    // Never below the minimum
+    QCOMPARE(BitratePolicy::capVideoBitRate(20000000, 48000, 1000),
+             BitratePolicy::MINIMUM_VIDEO_BITRATE);
+}
+
+QTEST_GUILESS_MAIN(tst_BitratePolicy)
+
+#include "tst_bitratepolicy.moc"
@@ -0,0 +1,18 @@
+include(../../coverage.pri)
+
+TARGET = tst_devicequirks
+
+QT += testlib
+
+LIBS += -L../mocks/aal -laal
+INCLUDEPATH += ../../src
+INCLUDEPATH += ../mocks/aal
+
+HEADERS += ../../src/devicequirks.h
+
+SOURCES += tst_devicequirks.cpp \
+    ../../src/devicequirks.cpp
+
+check.depends = $${TARGET}
+check.commands = ./$${TARGET}
+QMAKE_EXTRA_TARGETS += check
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest/QtTest>
+
+#include "devicequirks.h"
+#include "properties.h"
+
+class tst_DeviceQuirks : public QObject
+{
+    Q_OBJECT
+private slots:
+    void cleanup();
+
+    void value();
+    void isEnabled_data();
+    void isEnabled();
+    void list();
+};
+
+void tst_DeviceQuirks::cleanup()
+{
+    property_set("aal.camera.quirk.0", "");
+    property_set("aal.camera.quirk.1", "");
+}
+
+void tst_DeviceQuirks::value()
+{
+    QCOMPARE(DeviceQuirks::value("quirk", 0), QString());
+    QCOMPARE(DeviceQuirks::value("quirk", 0, "default"), QString("default"));
+
+    property_set("aal.camera.quirk.1", "  front  ");
+    QCOMPARE(DeviceQuirks::value("quirk", 1), QString("front"));
+    QCOMPARE(DeviceQuirks::value("quirk", 0, "default"), QString("default"));
+
+    // Only blanks is the same as not set
+    property_set("aal.camera.quirk.0", "   ");
+    QCOMPARE(DeviceQuirks::value("quirk", 0, "default"), QString("default"));
+}
+
+void tst_DeviceQuirks::isEnabled_data()
+{
+    QTest::addColumn<QString>("property");
+    QTest::addColumn<bool>("defaultValue");
+    QTest::addColumn<bool>("enabled");
+
+    QTest::newRow("unset") << QString() << false << false;
+    QTest::newRow("unset, on by default") << QString() << true << true;
+    QTest::newRow("1") << QString("1") << false << true;
+    QTest::newRow("true") << QString("true") << false << true;
+    QTest::newRow("TRUE") << QString("TRUE") << false << true;
+    QTest::newRow("0") << QString("0") << true << false;
+    QTest::newRow("false") << QString("false") << true << false;
+    QTest::newRow("malformed") << QString("yes") << true << false;
+}
+
+void tst_DeviceQuirks::isEnabled()
+{
+    QFETCH(QString, property);
+    QFETCH(bool, defaultValue);
+    QFETCH(bool, enabled);
+
+    property_set("aal.camera.quirk.0", property.toLatin1().constData());
+    QCOMPARE(DeviceQuirks::isEnabled("quirk", 0, defaultValue), enabled);
+}
+
+void tst_DeviceQuirks::list()
+{
+    QCOMPARE(DeviceQuirks::list("quirk", 0), QStringList());
+
+    property_set("aal.camera.quirk.0", "120:1280x720, 240:640x480,,  ,60:1920x1080");
+    QStringList expected;
+    expected << "120:1280x720" << "240:640x480" << "60:1920x1080";
+    QCOMPARE(DeviceQuirks::list("quirk", 0), expected);
+}
+
+QTEST_GUILESS_MAIN(tst_DeviceQuirks)
+
+#include "tst_devicequirks.moc"
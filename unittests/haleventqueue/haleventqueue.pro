@@ -0,0 +1,16 @@
+include(../../coverage.pri)
+
+TARGET = tst_haleventqueue
+
+QT += testlib
+
+HEADERS += ../../src/haleventqueue.h
+
+SOURCES += tst_haleventqueue.cpp \
+    ../../src/haleventqueue.cpp
+
+INCLUDEPATH += ../../src
+
+check.depends = $${TARGET}
+check.commands = ./$${TARGET}
+QMAKE_EXTRA_TARGETS += check
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest/QtTest>
+#include <QThread>
+
+#include "haleventqueue.h"
+
+class Producer : public QThread
+{
+public:
+    Producer(HalEventQueue *queue, int id, int count)
+        : m_queue(queue), m_id(id), m_count(count), m_wakeups(0) {}
+
+    int wakeups() const { return m_wakeups; }
+
+protected:
+    void run()
+    {
+        for (int i = 0; i < m_count; ++i) {
+            // The zoom level carries the producer and its sequence number
+            if (m_queue->push(new HalEvent(HalEvent::Zoom, m_id * m_count + i)))
+                m_wakeups++;
+        }
+    }
+
+private:
+    HalEventQueue *m_queue;
+    int m_id;
+    int m_count;
+    int m_wakeups;
+};
+
+class tst_HalEventQueue : public QObject
+{
+    Q_OBJECT
+private slots:
+    void emptyQueue();
+    void order();
+    void wakeOncePerBatch();
+    void payload();
+    void concurrentProducers();
+};
+
+void tst_HalEventQueue::emptyQueue()
+{
+    HalEventQueue queue;
+    QVERIFY(queue.isEmpty());
+    QVERIFY(queue.takeAll() == 0);
+}
+
+void tst_HalEventQueue::order()
+{
+    HalEventQueue queue;
+    queue.push(new HalEvent(HalEvent::Focus));
+    queue.push(new HalEvent(HalEvent::Shutter));
+    queue.push(new HalEvent(HalEvent::Jpeg));
+
+    HalEvent *event = queue.takeAll();
+    QVERIFY(queue.isEmpty());
+
+    QList<HalEvent::Type> types;
+    while (event != 0) {
+        HalEvent *next = event->next;
+        types.append(event->type);
+        delete event;
+        event = next;
+    }
+    QCOMPARE(types, QList<HalEvent::Type>() << HalEvent::Focus << HalEvent::Shutter << HalEvent::Jpeg);
+}
+
+void tst_HalEventQueue::wakeOncePerBatch()
+{
+    HalEventQueue queue;
+    QCOMPARE(queue.push(new HalEvent(HalEvent::ViewfinderFrame)), true);
+    QCOMPARE(queue.push(new HalEvent(HalEvent::ViewfinderFrame)), false);
+    QCOMPARE(queue.push(new HalEvent(HalEvent::Shutter)), false);
+
+    HalEvent *event = queue.takeAll();
+    while (event != 0) {
+        HalEvent *next = event->next;
+        delete event;
+        event = next;
+    }
+
+    // The next batch needs a new wake up
+    QCOMPARE(queue.push(new HalEvent(HalEvent::Focus)), true);
+    // Left for the destructor to delete
+}
+
+void tst_HalEventQueue::payload()
+{
+    HalEventQueue queue;
+    HalEvent *jpeg = new HalEvent(HalEvent::Jpeg);
+    jpeg->data = QByteArray("\xff\xd8\xff\xd9", 4);
+    queue.push(jpeg);
+
+    HalEvent *event = queue.takeAll();
+    QCOMPARE(event->type, HalEvent::Jpeg);
+    QCOMPARE(event->data.size(), 4);
+    QVERIFY(event->next == 0);
+    delete event;
+}
+
+void tst_HalEventQueue::concurrentProducers()
+{
+    const int producerCount = 4;
+    const int eventCount = 20000;
+
+    HalEventQueue queue;
+    QList<Producer*> producers;
+    for (int i = 0; i < producerCount; ++i)
+        producers.append(new Producer(&queue, i, eventCount));
+    Q_FOREACH (Producer *producer, producers)
+        producer->start();
+
+    // Drain while producing, every producer's events must come out complete
+    // and in the order it pushed them
+    QVector<int> expected(producerCount, 0);
+    int received = 0;
+    int batches = 0;
+    while (received < producerCount * eventCount) {
+        HalEvent *event = queue.takeAll();
+        if (event == 0) {
+            QThread::yieldCurrentThread();
+            continue;
+        }
+        batches++;
+        while (event != 0) {
+            HalEvent *next = event->next;
+            const int producer = event->value / eventCount;
+            QCOMPARE(event->value % eventCount, expected[producer]);
+            expected[producer]++;
+            received++;
+            delete event;
+            event = next;
+        }
+    }
+
+    int wakeups = 0;
+    Q_FOREACH (Producer *producer, producers) {
+        QVERIFY(producer->wait(10000));
+        wakeups += producer->wakeups();
+        delete producer;
+    }
+    QVERIFY(queue.isEmpty());
+    // Exactly one wake up per batch
+    QCOMPARE(wakeups, batches);
+}
+
+QTEST_GUILESS_MAIN(tst_HalEventQueue)
+
+#include "tst_haleventqueue.moc"
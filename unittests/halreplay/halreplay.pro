@@ -0,0 +1,14 @@
+include(../../coverage.pri)
+
+TARGET = tst_halreplay
+
+QT += testlib
+
+LIBS += -L../mocks/aal -laal
+INCLUDEPATH += ../mocks/aal
+
+SOURCES += tst_halreplay.cpp
+
+check.depends = $${TARGET}
+check.commands = ./$${TARGET}
+QMAKE_EXTRA_TARGETS += check
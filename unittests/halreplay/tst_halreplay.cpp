@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTemporaryDir>
+
+#include "camera_compatibility_layer.h"
+#include "camera_compatibility_layer_capabilities.h"
+#include "halreplay.h"
+#include "media_recorder_layer.h"
+
+static QMutex callbacksMutex;
+static QStringList callbacks;
+
+static void addCallback(const QString &callback)
+{
+    QMutexLocker locker(&callbacksMutex);
+    callbacks.append(callback);
+}
+
+static QStringList takeCallbacks()
+{
+    QMutexLocker locker(&callbacksMutex);
+    QStringList taken = callbacks;
+    callbacks.clear();
+    return taken;
+}
+
+static void shutterCB(void *context)
+{
+    Q_UNUSED(context);
+    addCallback(QLatin1String("shutter"));
+}
+
+static void jpegCB(void *data, uint32_t dataSize, void *context)
+{
+    Q_UNUSED(context);
+    const QByteArray jpeg(static_cast<const char*>(data), dataSize);
+    addCallback(QString("jpeg %1").arg(QString::fromLatin1(jpeg)));
+}
+
+static void zoomCB(void *context, int32_t level)
+{
+    Q_UNUSED(context);
+    addCallback(QString("zoom %1").arg(level));
+}
+
+static void sizeCB(void *context, int width, int height)
+{
+    Q_UNUSED(context);
+    addCallback(QString("size %1x%2").arg(width).arg(height));
+}
+
+class tst_HalReplay : public QObject
+{
+    Q_OBJECT
+private slots:
+    void init();
+    void cleanup();
+
+    void replayCalls();
+    void replayCallbacks();
+    void dropCallbacksAfterDisconnect();
+    void unrecordedCalls();
+
+private:
+    bool startSession(const QByteArray &session);
+
+    QTemporaryDir m_dir;
+    CameraControlListener m_listener;
+};
+
+void tst_HalReplay::init()
+{
+    memset(&m_listener, 0, sizeof(m_listener));
+    m_listener.on_msg_shutter_cb = &shutterCB;
+    m_listener.on_msg_zoom_cb = &zoomCB;
+    m_listener.on_data_compressed_image_cb = &jpegCB;
+    takeCallbacks();
+}
+
+void tst_HalReplay::cleanup()
+{
+    HalReplay::stop();
+}
+
+bool tst_HalReplay::startSession(const QByteArray &session)
+{
+    QFile file(m_dir.path() + QLatin1String("/session"));
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write("# aalcamera HAL session 1\n");
+    file.write(session);
+    file.close();
+    return HalReplay::start(file.fileName());
+}
+
+void tst_HalReplay::replayCalls()
+{
+    QVERIFY(startSession("call 100 1000 android_camera_connect_by_id - 0 -\n"
+                         "call 2000 20000 android_camera_get_max_zoom - - *9\n"
+                         "callback 2500 size_callback android_camera_enumerate_supported_preview_sizes - 1280 720\n"
+                         "callback 2600 size_callback android_camera_enumerate_supported_preview_sizes - 1920 1080\n"
+                         "call 2400 300 android_camera_enumerate_supported_preview_sizes - - - -\n"
+                         "call 3000 10 android_recorder_start -4 -\n"));
+    QVERIFY(HalReplay::isActive());
+
+    CameraControl *control = android_camera_connect_by_id(0, &m_listener);
+
+    QElapsedTimer timer;
+    timer.start();
+    int maxZoom = 0;
+    android_camera_get_max_zoom(control, &maxZoom);
+    QVERIFY(timer.elapsed() >= 20);
+    QCOMPARE(maxZoom, 9);
+
+    // Callbacks from within a call are made before it returns
+    android_camera_enumerate_supported_preview_sizes(control, &sizeCB, 0);
+    QCOMPARE(takeCallbacks(), QStringList() << "size 1280x720" << "size 1920x1080");
+
+    MediaRecorderWrapper *recorder = android_media_new_recorder();
+    QCOMPARE(android_recorder_start(recorder), -4);
+
+    android_camera_disconnect(control);
+    android_camera_delete(control);
+}
+
+void tst_HalReplay::replayCallbacks()
+{
+    QFile payload(m_dir.path() + QLatin1String("/session.0.payload"));
+    QVERIFY(payload.open(QIODevice::WriteOnly));
+    payload.write("JPEG");
+    payload.close();
+
+    QVERIFY(startSession("call 100 10 android_camera_connect_by_id - 0 -\n"
+                         "call 1000 100 android_camera_take_snapshot - -\n"
+                         "callback 11000 on_msg_shutter - -\n"
+                         "callback 51000 on_data_compressed_image - 4:session.0.payload\n"
+                         "callback 61000 on_msg_zoom - - 5\n"));
+
+    CameraControl *control = android_camera_connect_by_id(0, &m_listener);
+    QElapsedTimer timer;
+    timer.start();
+    android_camera_take_snapshot(control);
+    QCOMPARE(takeCallbacks(), QStringList());
+
+    QStringList made;
+    QTRY_COMPARE((made << takeCallbacks()).count(), 3);
+    QVERIFY(timer.elapsed() >= 60);
+    QCOMPARE(made, QStringList() << "shutter" << "jpeg JPEG" << "zoom 5");
+
+    android_camera_disconnect(control);
+    android_camera_delete(control);
+}
+
+void tst_HalReplay::dropCallbacksAfterDisconnect()
+{
+    QVERIFY(startSession("call 100 10 android_camera_connect_by_id - 0 -\n"
+                         "call 1000 10 android_camera_take_snapshot - -\n"
+                         "callback 50000 on_msg_shutter - -\n"));
+
+    CameraControl *control = android_camera_connect_by_id(0, &m_listener);
+    android_camera_take_snapshot(control);
+    android_camera_disconnect(control);
+    android_camera_delete(control);
+
+    QTest::qWait(100);
+    QCOMPARE(takeCallbacks(), QStringList());
+}
+
+void tst_HalReplay::unrecordedCalls()
+{
+    QVERIFY(startSession("call 100 10 android_camera_get_number_of_devices 1\n"));
+
+    // Calls missing from the session act like the plain mock
+    CameraControl *control = android_camera_connect_by_id(0, &m_listener);
+    int maxZoom = 0;
+    android_camera_get_max_zoom(control, &maxZoom);
+    QCOMPARE(maxZoom, 4);
+
+    QCOMPARE(android_camera_get_number_of_devices(), 1);
+    QCOMPARE(android_camera_get_number_of_devices(), 2);
+
+    android_camera_disconnect(control);
+    android_camera_delete(control);
+}
+
+QTEST_GUILESS_MAIN(tst_HalReplay)
+
+#include "tst_halreplay.moc"
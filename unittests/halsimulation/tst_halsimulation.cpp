@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTemporaryDir>
+
+#include "camera_compatibility_layer.h"
+#include "camera_compatibility_layer_capabilities.h"
+#include "halsimulation.h"
+
+static QMutex callbacksMutex;
+static QStringList callbacks;
+static QByteArray lastJpeg;
+
+static void addCallback(const QString &callback)
+{
+    QMutexLocker locker(&callbacksMutex);
+    callbacks.append(callback);
+}
+
+static QStringList takeCallbacks()
+{
+    QMutexLocker locker(&callbacksMutex);
+    QStringList taken = callbacks;
+    callbacks.clear();
+    return taken;
+}
+
+static void frameCB(void *context)
+{
+    Q_UNUSED(context);
+    addCallback(QLatin1String("frame"));
+}
+
+static void shutterCB(void *context)
+{
+    Q_UNUSED(context);
+    addCallback(QLatin1String("shutter"));
+}
+
+static void focusCB(void *context)
+{
+    Q_UNUSED(context);
+    addCallback(QLatin1String("focus"));
+}
+
+static void jpegCB(void *data, uint32_t dataSize, void *context)
+{
+    Q_UNUSED(context);
+    QMutexLocker locker(&callbacksMutex);
+    lastJpeg = QByteArray(static_cast<const char*>(data), dataSize);
+    callbacks.append(QLatin1String("jpeg"));
+}
+
+static void sizeCB(void *context, int width, int height)
+{
+    static_cast<QList<QSize>*>(context)->append(QSize(width, height));
+}
+
+class tst_HalSimulation : public QObject
+{
+    Q_OBJECT
+private slots:
+    void init();
+    void cleanup();
+
+    void offByDefault();
+    void latencies();
+    void loadLatencies();
+    void deviceCapabilities();
+    void previewFrames();
+    void snapshot();
+    void focus();
+
+private:
+    CameraControl *connectCamera();
+    void disconnectCamera(CameraControl *control);
+
+    CameraControlListener m_listener;
+};
+
+void tst_HalSimulation::init()
+{
+    memset(&m_listener, 0, sizeof(m_listener));
+    m_listener.on_preview_texture_needs_update_cb = &frameCB;
+    m_listener.on_msg_shutter_cb = &shutterCB;
+    m_listener.on_msg_focus_cb = &focusCB;
+    m_listener.on_data_compressed_image_cb = &jpegCB;
+    takeCallbacks();
+}
+
+void tst_HalSimulation::cleanup()
+{
+    HalSimulation::reset();
+}
+
+CameraControl *tst_HalSimulation::connectCamera()
+{
+    return android_camera_connect_to(BACK_FACING_CAMERA_TYPE, &m_listener);
+}
+
+void tst_HalSimulation::disconnectCamera(CameraControl *control)
+{
+    android_camera_disconnect(control);
+    android_camera_delete(control);
+}
+
+void tst_HalSimulation::offByDefault()
+{
+    CameraControl *control = connectCamera();
+    QElapsedTimer timer;
+    timer.start();
+    android_camera_start_preview(control);
+    android_camera_start_autofocus(control);
+    android_camera_take_snapshot(control);
+    QVERIFY(timer.elapsed() < 10);
+
+    QList<QSize> sizes;
+    android_camera_enumerate_supported_picture_sizes(control, &sizeCB, &sizes);
+    QVERIFY(sizes.isEmpty());
+
+    QTest::qWait(100);
+    QCOMPARE(takeCallbacks(), QStringList());
+    disconnectCamera(control);
+}
+
+void tst_HalSimulation::latencies()
+{
+    HalSimulation::setLatency("android_camera_start_preview", 30000);
+    CameraControl *control = connectCamera();
+
+    QElapsedTimer timer;
+    timer.start();
+    android_camera_start_preview(control);
+    QVERIFY(timer.elapsed() >= 30);
+
+    timer.start();
+    android_camera_stop_preview(control);
+    QVERIFY(timer.elapsed() < 30);
+    disconnectCamera(control);
+}
+
+void tst_HalSimulation::loadLatencies()
+{
+    QTemporaryDir dir;
+    QFile profile(dir.path() + QLatin1String("/latencies"));
+    QVERIFY(profile.open(QIODevice::WriteOnly));
+    profile.write("# A comment\n"
+                  "*    20000\n"
+                  "android_camera_stop_preview 0\n");
+    profile.close();
+    QVERIFY(HalSimulation::loadLatencies(profile.fileName()));
+    QVERIFY(HalSimulation::hasLatencies());
+
+    CameraControl *control = connectCamera();
+    QElapsedTimer timer;
+    timer.start();
+    android_camera_start_preview(control);
+    QVERIFY(timer.elapsed() >= 20);
+
+    timer.start();
+    android_camera_stop_preview(control);
+    QVERIFY(timer.elapsed() < 20);
+    disconnectCamera(control);
+
+    QVERIFY(profile.open(QIODevice::WriteOnly));
+    profile.write("android_camera_stop_preview fast\n");
+    profile.close();
+    QVERIFY(!HalSimulation::loadLatencies(profile.fileName()));
+    QVERIFY(!HalSimulation::loadLatencies(dir.path() + QLatin1String("/missing")));
+}
+
+void tst_HalSimulation::deviceCapabilities()
+{
+    HalSimulation::setDeviceSimulated(true);
+    CameraControl *control = connectCamera();
+
+    QList<QSize> pictureSizes;
+    android_camera_enumerate_supported_picture_sizes(control, &sizeCB, &pictureSizes);
+    QVERIFY(pictureSizes.contains(QSize(4160, 3120)));
+
+    QList<QSize> previewSizes;
+    android_camera_enumerate_supported_preview_sizes(control, &sizeCB, &previewSizes);
+    QVERIFY(previewSizes.contains(QSize(1920, 1080)));
+    QVERIFY(!previewSizes.contains(QSize(4160, 3120)));
+
+    int min = 0;
+    int max = 0;
+    android_camera_get_preview_fps_range(control, &min, &max);
+    QCOMPARE(min, 15000);
+    QCOMPARE(max, 30000);
+    disconnectCamera(control);
+}
+
+void tst_HalSimulation::previewFrames()
+{
+    HalSimulation::setDeviceSimulated(true);
+    CameraControl *control = connectCamera();
+    android_camera_set_preview_fps(control, 50);
+
+    android_camera_start_preview(control);
+    QTest::qWait(210);
+    android_camera_stop_preview(control);
+    const int frames = takeCallbacks().count(QLatin1String("frame"));
+    QVERIFY2(frames >= 5 && frames <= 12, qPrintable(QString::number(frames)));
+
+    QTest::qWait(50);
+    QCOMPARE(takeCallbacks(), QStringList());
+    disconnectCamera(control);
+}
+
+void tst_HalSimulation::snapshot()
+{
+    HalSimulation::setDeviceSimulated(true);
+    HalSimulation::setSnapshotDelays(10000, 30000);
+    CameraControl *control = connectCamera();
+    android_camera_set_picture_size(control, 320, 240);
+
+    android_camera_take_snapshot(control);
+    QStringList made;
+    QTRY_COMPARE((made << takeCallbacks()).count(), 2);
+    QCOMPARE(made, QStringList() << "shutter" << "jpeg");
+
+    QMutexLocker locker(&callbacksMutex);
+    QImage image = QImage::fromData(lastJpeg, "JPG");
+    QCOMPARE(image.size(), QSize(320, 240));
+    locker.unlock();
+
+    disconnectCamera(control);
+}
+
+void tst_HalSimulation::focus()
+{
+    HalSimulation::setDeviceSimulated(true);
+    HalSimulation::setFocusDelay(20000);
+    CameraControl *control = connectCamera();
+
+    android_camera_start_autofocus(control);
+    QTRY_COMPARE(takeCallbacks(), QStringList() << "focus");
+
+    // Stopping autofocus drops the focus callback
+    android_camera_start_autofocus(control);
+    android_camera_stop_autofocus(control);
+    QTest::qWait(50);
+    QCOMPARE(takeCallbacks(), QStringList());
+    disconnectCamera(control);
+}
+
+QTEST_GUILESS_MAIN(tst_HalSimulation)
+
+#include "tst_halsimulation.moc"
@@ -0,0 +1,18 @@
+include(../../coverage.pri)
+
+TARGET = tst_haltrace
+
+QT += testlib
+
+HEADERS += ../../src/halrecorder.h \
+    ../../src/haltrace.h
+
+SOURCES += tst_haltrace.cpp \
+    ../../src/halrecorder.cpp \
+    ../../src/haltrace.cpp
+
+INCLUDEPATH += ../../src
+
+check.depends = $${TARGET}
+check.commands = ./$${TARGET}
+QMAKE_EXTRA_TARGETS += check
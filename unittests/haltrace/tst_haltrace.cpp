@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest/QtTest>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QThread>
+
+#include "haltrace.h"
+
+static int halCall(int value)
+{
+    QThread::usleep(1000);
+    return value * 2;
+}
+
+typedef void (*SizeCallback)(void *context, int width, int height);
+
+static void sizeCB(void *context, int width, int height)
+{
+    Q_UNUSED(context);
+    halRecordCallback("size_callback", width, height);
+}
+
+static void enumerateSizes(SizeCallback callback, void *context)
+{
+    callback(context, 640, 480);
+}
+
+static int getZoom(int *zoom, const char *parameters)
+{
+    Q_UNUSED(parameters);
+    *zoom = 7;
+    return 0;
+}
+
+class TracingThread : public QThread
+{
+protected:
+    void run()
+    {
+        HalTraceSpan span("TracingThread::run");
+        HAL_TRACE(halCall, 1);
+    }
+};
+
+class tst_HalTrace : public QObject
+{
+    Q_OBJECT
+private slots:
+    void disabledByDefault();
+    void traceCalls();
+    void recordSession();
+};
+
+void tst_HalTrace::disabledByDefault()
+{
+    if (!qgetenv("AAL_CAMERA_TRACE").isEmpty())
+        QSKIP("Tracing is enabled from the environment");
+
+    QCOMPARE(HalTrace::isEnabled(), false);
+    QCOMPARE(HalTrace::flush(), false);
+    // Calls go through untouched
+    QCOMPARE(HAL_TRACE(halCall, 2), 4);
+}
+
+void tst_HalTrace::traceCalls()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.path() + QLatin1String("/trace.json");
+    HalTrace::start(fileName);
+    QVERIFY(HalTrace::isEnabled());
+
+    QCOMPARE(HAL_TRACE(halCall, 3), 6);
+    TracingThread thread;
+    thread.start();
+    QVERIFY(thread.wait(5000));
+
+    QVERIFY(HalTrace::flush());
+
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &error);
+    QCOMPARE(error.error, QJsonParseError::NoError);
+
+    QMap<QString, QJsonObject> spans;
+    Q_FOREACH (const QJsonValue &value, document.object().value(QLatin1String("traceEvents")).toArray())
+        spans.insertMulti(value.toObject().value(QLatin1String("name")).toString(), value.toObject());
+
+    QCOMPARE(spans.count(QLatin1String("halCall")), 2);
+    QVERIFY(spans.contains(QLatin1String("TracingThread::run")));
+
+    const QJsonObject outer = spans.value(QLatin1String("TracingThread::run"));
+    QCOMPARE(outer.value(QLatin1String("ph")).toString(), QLatin1String("X"));
+    QVERIFY(outer.value(QLatin1String("dur")).toDouble() >= 1000);
+
+    // The call made from the thread nests in its span, on the same thread id
+    int threadCalls = 0;
+    Q_FOREACH (const QJsonObject &call, spans.values(QLatin1String("halCall"))) {
+        QVERIFY(call.value(QLatin1String("dur")).toDouble() >= 1000);
+        if (call.value(QLatin1String("tid")) != outer.value(QLatin1String("tid")))
+            continue;
+        threadCalls++;
+        QVERIFY(call.value(QLatin1String("ts")).toDouble() >= outer.value(QLatin1String("ts")).toDouble());
+    }
+    QCOMPARE(threadCalls, 1);
+}
+
+void tst_HalTrace::recordSession()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.path() + QLatin1String("/session");
+    QVERIFY(HalRecorder::start(fileName));
+
+    int zoom = 0;
+    QCOMPARE(HAL_TRACE(getZoom, &zoom, "a b"), 0);
+    QCOMPARE(zoom, 7);
+    HAL_TRACE(enumerateSizes, &sizeCB, NULL);
+    const char jpeg[] = "JPEG";
+    HalRecorder::recordCallback("on_data_compressed_image", QByteArray(), jpeg, 4);
+    HalRecorder::stop();
+
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QList<QList<QByteArray> > lines;
+    Q_FOREACH (const QByteArray &line, file.readAll().split('\n')) {
+        if (!line.isEmpty() && !line.startsWith('#'))
+            lines.append(line.split(' '));
+    }
+    QCOMPARE(lines.count(), 4);
+
+    // Out parameters are recorded after the call
+    QCOMPARE(lines.at(0).at(0), QByteArray("call"));
+    QCOMPARE(lines.at(0).mid(3), QList<QByteArray>() << "getZoom" << "0" << "*7" << "\"a%20b\"");
+
+    // A callback from within a call is written before the call returns
+    QCOMPARE(lines.at(1).mid(2), QList<QByteArray>() << "size_callback" << "enumerateSizes" << "-"
+                                                     << "640" << "480");
+    QCOMPARE(lines.at(2).mid(3), QList<QByteArray>() << "enumerateSizes" << "-" << "-" << "-");
+    QVERIFY(lines.at(2).at(1).toLongLong() <= lines.at(1).at(1).toLongLong());
+
+    QCOMPARE(lines.at(3).mid(2), QList<QByteArray>() << "on_data_compressed_image" << "-"
+                                                     << "4:session.0.payload");
+    QFile payload(fileName + QLatin1String(".0.payload"));
+    QVERIFY(payload.open(QIODevice::ReadOnly));
+    QCOMPARE(payload.readAll(), QByteArray("JPEG"));
+}
+
+QTEST_GUILESS_MAIN(tst_HalTrace)
+
+#include "tst_haltrace.moc"
@@ -6,7 +6,15 @@ CONFIG += staticlib
 HEADERS =  camera_compatibility_layer.h \
            camera_compatibility_layer_capabilities.h \
            camera_control.h \
-           media_recorder_layer.h
+           halcallbacks.h \
+           halreplay.h \
+           halsimulation.h \
+           media_recorder_layer.h \
+           properties.h
 
 SOURCES += camera_compatibility_layer.cpp \
-           media_recorder_layer.cpp
+           halcallbacks.cpp \
+           halreplay.cpp \
+           halsimulation.cpp \
+           media_recorder_layer.cpp \
+           properties.cpp
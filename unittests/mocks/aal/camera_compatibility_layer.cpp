@@ -20,6 +20,9 @@
 #include "camera_compatibility_layer_capabilities.h"
 
 #include "camera_control.h"
+#include "halcallbacks.h"
+#include "halreplay.h"
+#include "halsimulation.h"
 
 #include <QtGlobal>
 #include <QDebug>
@@ -33,12 +36,37 @@ void crashTest(CameraControl* control)
 
 int android_camera_get_number_of_devices()
 {
-    return 2;
+    HalReplayCall replay(__func__);
+    return replay.result(2);
+}
+
+int android_camera_get_device_info(int32_t camera_id, int* facing, int* orientation)
+{
+    HalReplayCall replay(__func__);
+    *facing = camera_id == 1 ? FRONT_FACING_CAMERA_TYPE : BACK_FACING_CAMERA_TYPE;
+    *orientation = 0;
+    replay.output(facing);
+    replay.output(orientation);
+    return replay.result(0);
 }
 
 CameraControl* android_camera_connect_to(CameraType camera_type, CameraControlListener* listener)
 {
     Q_UNUSED(camera_type);
+    // Before the call, for the callbacks a replayed connect schedules
+    HalCallbacks::setCameraListener(listener);
+    HalReplayCall replay(__func__);
+    CameraControl* cc = new CameraControl();
+    cc->listener = listener;
+    return cc;
+}
+
+CameraControl* android_camera_connect_by_id(int32_t camera_id, CameraControlListener* listener)
+{
+    Q_UNUSED(camera_id);
+    // Before the call, for the callbacks a replayed connect schedules
+    HalCallbacks::setCameraListener(listener);
+    HalReplayCall replay(__func__);
     CameraControl* cc = new CameraControl();
     cc->listener = listener;
     return cc;
@@ -46,68 +74,85 @@ CameraControl* android_camera_connect_to(CameraType camera_type, CameraControlLi
 
 void android_camera_disconnect(CameraControl* control)
 {
+    HalReplayCall replay(__func__);
     crashTest(control);
+    HalSimulation::previewStopped();
+    HalCallbacks::setCameraListener(0);
 }
 
 int android_camera_lock(CameraControl* control)
 {
     Q_UNUSED(control);
-    return 0;
+    HalReplayCall replay(__func__);
+    return replay.result(0);
 }
 
 int android_camera_unlock(CameraControl* control)
 {
     Q_UNUSED(control);
-    return 0;
+    HalReplayCall replay(__func__);
+    return replay.result(0);
 }
 
 void android_camera_delete(CameraControl* control)
 {
+    HalReplayCall replay(__func__);
     delete control;
 }
 
 void android_camera_dump_parameters(CameraControl* control)
 {
+    HalReplayCall replay(__func__);
     crashTest(control);
 }
 
 void android_camera_set_flash_mode(CameraControl* control, FlashMode mode)
 {
     Q_UNUSED(mode);
+    HalReplayCall replay(__func__);
     crashTest(control);
 }
 
 void android_camera_get_flash_mode(CameraControl* control, FlashMode* mode)
 {
-    Q_UNUSED(mode);
+    HalReplayCall replay(__func__);
     crashTest(control);
+    replay.output(mode);
 }
 
 void android_camera_set_white_balance_mode(CameraControl* control, WhiteBalanceMode mode)
 {
     Q_UNUSED(mode);
+    HalReplayCall replay(__func__);
     crashTest(control);
 }
 
 void android_camera_get_white_balance_mode(CameraControl* control, WhiteBalanceMode* mode)
 {
-    Q_UNUSED(mode);
+    HalReplayCall replay(__func__);
     crashTest(control);
+    replay.output(mode);
 }
 
 void android_camera_enumerate_supported_scene_modes(CameraControl* control, scene_mode_callback cb, void* ctx)
 {
-    Q_UNUSED(cb);
-    Q_UNUSED(ctx);
+    HalReplayCall replay(__func__);
     crashTest(control);
+    if (replay.isReplayed()) {
+        replay.callbacks(cb, ctx);
+        return;
+    }
     cb(ctx, SCENE_MODE_ACTION);
 }
 
 void android_camera_enumerate_supported_flash_modes(CameraControl* control, flash_mode_callback cb, void* ctx)
 {
-    Q_UNUSED(cb);
-    Q_UNUSED(ctx);
+    HalReplayCall replay(__func__);
     crashTest(control);
+    if (replay.isReplayed()) {
+        replay.callbacks(cb, ctx);
+        return;
+    }
     cb(ctx, FLASH_MODE_ON);
     cb(ctx, FLASH_MODE_AUTO);
     cb(ctx, FLASH_MODE_RED_EYE);
@@ -118,219 +163,300 @@ void android_camera_enumerate_supported_flash_modes(CameraControl* control, flas
 void android_camera_set_scene_mode(CameraControl* control, SceneMode mode)
 {
     Q_UNUSED(mode);
+    HalReplayCall replay(__func__);
     crashTest(control);
 }
 
 void android_camera_get_scene_mode(CameraControl* control, SceneMode* mode)
 {
-    Q_UNUSED(mode);
+    HalReplayCall replay(__func__);
     crashTest(control);
+    replay.output(mode);
 }
 
 void android_camera_set_auto_focus_mode(CameraControl* control, AutoFocusMode mode)
 {
     Q_UNUSED(mode);
+    HalReplayCall replay(__func__);
     crashTest(control);
 }
 
 void android_camera_get_auto_focus_mode(CameraControl* control, AutoFocusMode* mode)
 {
+    HalReplayCall replay(__func__);
     crashTest(control);
     *mode = AUTO_FOCUS_MODE_AUTO;
+    replay.output(mode);
 }
 
 void android_camera_set_jpeg_quality(CameraControl* control, int quality)
 {
-    Q_UNUSED(quality);
+    HalReplayCall replay(__func__);
     crashTest(control);
+    if (!replay.isReplayed())
+        HalSimulation::jpegQualitySet(quality);
 }
 
 void android_camera_get_jpeg_quality(CameraControl* control, int* quality)
 {
-    Q_UNUSED(quality);
+    HalReplayCall replay(__func__);
     crashTest(control);
+    replay.output(quality);
 }
 
 void android_camera_set_effect_mode(CameraControl* control, EffectMode mode)
 {
     Q_UNUSED(mode);
+    HalReplayCall replay(__func__);
     crashTest(control);
 }
 
 void android_camera_get_effect_mode(CameraControl* control, EffectMode* mode)
 {
-    Q_UNUSED(mode);
+    HalReplayCall replay(__func__);
     crashTest(control);
+    replay.output(mode);
 }
 
 void android_camera_get_preview_fps_range(CameraControl* control, int* min, int* max)
 {
-    Q_UNUSED(min);
-    Q_UNUSED(max);
+    HalReplayCall replay(__func__);
     crashTest(control);
+    if (!replay.isReplayed())
+        HalSimulation::previewFpsRange(min, max);
+    replay.output(min);
+    replay.output(max);
 }
 
 void android_camera_set_preview_fps(CameraControl* control, int fps)
 {
-    Q_UNUSED(fps);
+    HalReplayCall replay(__func__);
     crashTest(control);
+    if (!replay.isReplayed())
+        HalSimulation::previewFpsSet(fps);
 }
 
 void android_camera_get_preview_fps(CameraControl* control, int* fps)
 {
-    Q_UNUSED(fps);
+    HalReplayCall replay(__func__);
     crashTest(control);
+    replay.output(fps);
 }
 
 void android_camera_enumerate_supported_preview_sizes(CameraControl* control, size_callback cb, void* ctx)
 {
-    Q_UNUSED(cb);
-    Q_UNUSED(ctx);
+    HalReplayCall replay(__func__);
     crashTest(control);
+    if (!replay.isReplayed())
+        HalSimulation::supportedSizes(__func__, cb, ctx);
+    replay.callbacks(cb, ctx);
 }
 
 void android_camera_enumerate_supported_picture_sizes(CameraControl* control, size_callback cb, void* ctx)
 {
-    Q_UNUSED(cb);
-    Q_UNUSED(ctx);
+    HalReplayCall replay(__func__);
+    crashTest(control);
+    if (!replay.isReplayed())
+        HalSimulation::supportedSizes(__func__, cb, ctx);
+    replay.callbacks(cb, ctx);
+}
+
+void android_camera_enumerate_supported_thumbnail_sizes(CameraControl* control, size_callback cb, void* ctx)
+{
+    HalReplayCall replay(__func__);
+    crashTest(control);
+    if (!replay.isReplayed())
+        HalSimulation::supportedSizes(__func__, cb, ctx);
+    replay.callbacks(cb, ctx);
+}
+
+void android_camera_enumerate_supported_video_sizes(CameraControl* control, size_callback cb, void* ctx)
+{
+    HalReplayCall replay(__func__);
     crashTest(control);
+    if (!replay.isReplayed())
+        HalSimulation::supportedSizes(__func__, cb, ctx);
+    replay.callbacks(cb, ctx);
 }
 
 void android_camera_get_preview_size(CameraControl* control, int* width, int* height)
 {
-    Q_UNUSED(width);
-    Q_UNUSED(height);
+    HalReplayCall replay(__func__);
     crashTest(control);
+    replay.output(width);
+    replay.output(height);
 }
 
 void android_camera_set_preview_size(CameraControl* control, int width, int height)
 {
     Q_UNUSED(width);
     Q_UNUSED(height);
+    HalReplayCall replay(__func__);
     crashTest(control);
 }
 
-void android_camera_get_picture_size(CameraControl* control, int* width, int* height)
+void android_camera_set_thumbnail_size(CameraControl* control, int width, int height)
 {
     Q_UNUSED(width);
     Q_UNUSED(height);
+    HalReplayCall replay(__func__);
     crashTest(control);
 }
 
+void android_camera_get_picture_size(CameraControl* control, int* width, int* height)
+{
+    HalReplayCall replay(__func__);
+    crashTest(control);
+    replay.output(width);
+    replay.output(height);
+}
+
 void android_camera_set_picture_size(CameraControl* control, int width, int height)
 {
-    Q_UNUSED(width);
-    Q_UNUSED(height);
+    HalReplayCall replay(__func__);
     crashTest(control);
+    if (!replay.isReplayed())
+        HalSimulation::pictureSizeSet(width, height);
 }
 
 void android_camera_get_current_zoom(CameraControl* control, int* zoom)
 {
-    Q_UNUSED(zoom);
+    HalReplayCall replay(__func__);
     crashTest(control);
+    replay.output(zoom);
 }
 
 void android_camera_get_max_zoom(CameraControl* control, int* zoom)
 {
+    HalReplayCall replay(__func__);
     crashTest(control);
     *zoom = 4;
+    replay.output(zoom);
 }
 
 void android_camera_set_display_orientation(CameraControl* control, int32_t clockwise_rotation_degree)
 {
     Q_UNUSED(clockwise_rotation_degree);
+    HalReplayCall replay(__func__);
     crashTest(control);
 }
 
 void android_camera_get_preview_texture_transformation(CameraControl* control, float m[16])
 {
     Q_UNUSED(m);
+    HalReplayCall replay(__func__);
     crashTest(control);
 }
 
 void android_camera_update_preview_texture(CameraControl* control)
 {
+    HalReplayCall replay(__func__);
     crashTest(control);
 }
 
 void android_camera_set_preview_texture(CameraControl* control, int texture_id)
 {
     Q_UNUSED(texture_id);
+    HalReplayCall replay(__func__);
     crashTest(control);
 }
 
 void android_camera_start_preview(CameraControl* control)
 {
+    HalReplayCall replay(__func__);
     crashTest(control);
+    if (!replay.isReplayed())
+        HalSimulation::previewStarted();
 }
 
 void android_camera_stop_preview(CameraControl* control)
 {
+    HalReplayCall replay(__func__);
     crashTest(control);
+    if (!replay.isReplayed())
+        HalSimulation::previewStopped();
 }
 
 void android_camera_start_autofocus(CameraControl* control)
 {
+    HalReplayCall replay(__func__);
     crashTest(control);
+    if (!replay.isReplayed())
+        HalSimulation::autofocusStarted();
 }
 
 void android_camera_stop_autofocus(CameraControl* control)
 {
+    HalReplayCall replay(__func__);
     crashTest(control);
+    if (!replay.isReplayed())
+        HalSimulation::autofocusStopped();
 }
 
 void android_camera_start_zoom(CameraControl* control, int32_t zoom)
 {
     Q_UNUSED(zoom);
+    HalReplayCall replay(__func__);
     crashTest(control);
 }
 
 void android_camera_set_zoom(CameraControl* control, int32_t zoom)
 {
     Q_UNUSED(zoom);
+    HalReplayCall replay(__func__);
     crashTest(control);
 }
 
 void android_camera_stop_zoom(CameraControl* control)
 {
+    HalReplayCall replay(__func__);
     crashTest(control);
 }
 
 void android_camera_take_snapshot(CameraControl* control)
 {
+    HalReplayCall replay(__func__);
     crashTest(control);
+    if (!replay.isReplayed())
+        HalSimulation::snapshotTaken();
 }
 
 void android_camera_set_focus_region(CameraControl* control, FocusRegion* region)
 {
     Q_UNUSED(region);
+    HalReplayCall replay(__func__);
     crashTest(control);
 }
 
 void android_camera_set_metering_region(CameraControl* control, MeteringRegion* region)
 {
     Q_UNUSED(region);
+    HalReplayCall replay(__func__);
     crashTest(control);
 }
 
 void android_camera_reset_focus_region(CameraControl* control)
 {
+    HalReplayCall replay(__func__);
     crashTest(control);
 }
 
 void android_camera_reset_metering_region(CameraControl* control)
 {
+    HalReplayCall replay(__func__);
     crashTest(control);
 }
 
 void android_camera_set_rotation(CameraControl* control, int rotation)
 {
     Q_UNUSED(rotation);
+    HalReplayCall replay(__func__);
     crashTest(control);
 }
 
 void android_camera_set_location(CameraControl* control, const float* latitude, const float* longitude, const float* altitude, int timestamp, const char* method)
 {
     Q_UNUSED(latitude);
+    HalReplayCall replay(__func__);
     crashTest(control);
 }
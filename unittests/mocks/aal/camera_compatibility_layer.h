@@ -80,6 +80,9 @@ extern "C" {
     // Initializes a connection to the camera, returns NULL on error.
     CameraControl* android_camera_connect_to(CameraType camera_type, CameraControlListener* listener);
 
+    // Initializes a connection to the camera with the given id, returns NULL on error.
+    CameraControl* android_camera_connect_by_id(int32_t camera_id, CameraControlListener* listener);
+
     // Disconnects the camera and deletes the pointer
     void android_camera_disconnect(CameraControl* control);
 
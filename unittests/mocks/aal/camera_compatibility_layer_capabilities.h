@@ -115,10 +115,13 @@ void android_camera_dump_parameters(CameraControl* control);
 // Query camera parameters
 
 int android_camera_get_number_of_devices();
+int android_camera_get_device_info(int32_t camera_id, int* facing, int* orientation);
 void android_camera_enumerate_supported_preview_sizes(CameraControl* control, size_callback cb, void* ctx);
 void android_camera_get_preview_fps_range(CameraControl* control, int* min, int* max);
 void android_camera_get_preview_fps(CameraControl* control, int* fps);
 void android_camera_enumerate_supported_picture_sizes(CameraControl* control, size_callback cb, void* ctx);
+void android_camera_enumerate_supported_thumbnail_sizes(CameraControl* control, size_callback cb, void* ctx);
+void android_camera_enumerate_supported_video_sizes(CameraControl* control, size_callback cb, void* ctx);
 void android_camera_get_preview_size(CameraControl* control, int* width, int* height);
 void android_camera_get_picture_size(CameraControl* control, int* width, int* height);
 
@@ -139,6 +142,7 @@ void android_camera_get_jpeg_quality(struct CameraControl* control, int* quality
 void android_camera_set_preview_size(CameraControl* control, int width, int height);
 void android_camera_set_preview_fps(CameraControl* control, int fps);
 void android_camera_set_picture_size(CameraControl* control, int width, int height);
+void android_camera_set_thumbnail_size(CameraControl* control, int width, int height);
 void android_camera_set_effect_mode(CameraControl* control, EffectMode mode);
 void android_camera_set_flash_mode(CameraControl* control, FlashMode mode);
 void android_camera_set_white_balance_mode(CameraControl* control, WhiteBalanceMode mode);
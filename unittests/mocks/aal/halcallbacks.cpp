@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "halcallbacks.h"
+#include "halsimulation.h"
+#include "camera_compatibility_layer.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMultiMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QWaitCondition>
+
+namespace {
+
+struct ScheduledCallback
+{
+    HalCallback callback;
+    qint64 period;
+};
+
+bool isRecorderCallback(const QByteArray &name)
+{
+    return name.startsWith("on_recorder_");
+}
+
+class CallbackThread : public QThread
+{
+public:
+    CallbackThread()
+        : m_listener(0),
+          m_recorderError(0),
+          m_recorderErrorContext(0),
+          m_readAudio(0),
+          m_readAudioContext(0)
+    {
+        m_clock.start();
+    }
+
+    qint64 now() const { return m_clock.nsecsElapsed() / 1000; }
+
+    void schedule(qint64 due, const ScheduledCallback &callback)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_pending.insert(due, callback);
+        m_wakeUp.wakeOne();
+    }
+
+    void cancel(const QByteArray &name)
+    {
+        QMutexLocker locker(&m_mutex);
+        drop(name, false);
+    }
+
+    void clear()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_pending.clear();
+    }
+
+    void setCameraListener(CameraControlListener *listener)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (listener != m_listener)
+            drop(QByteArray(), false);
+        QMutexLocker firing(&m_firing);
+        m_listener = listener;
+    }
+
+    void setRecorderError(void (*callback)(void*), void *context)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (callback == 0)
+            drop(QByteArray(), true);
+        QMutexLocker firing(&m_firing);
+        m_recorderError = callback;
+        m_recorderErrorContext = context;
+    }
+
+    void setReadAudio(void (*callback)(void*), void *context)
+    {
+        QMutexLocker locker(&m_mutex);
+        QMutexLocker firing(&m_firing);
+        m_readAudio = callback;
+        m_readAudioContext = context;
+    }
+
+protected:
+    void run()
+    {
+        QMutexLocker locker(&m_mutex);
+        Q_FOREVER {
+            if (m_pending.isEmpty()) {
+                m_wakeUp.wait(&m_mutex);
+                continue;
+            }
+
+            const qint64 due = m_pending.firstKey();
+            const qint64 wait = due - now();
+            if (wait > 0) {
+                m_wakeUp.wait(&m_mutex, qMax<qint64>(1, wait / 1000));
+                continue;
+            }
+
+            const ScheduledCallback scheduled = m_pending.take(due);
+            if (scheduled.period > 0)
+                m_pending.insert(due + scheduled.period, scheduled);
+
+            QMutexLocker firing(&m_firing);
+            locker.unlock();
+            fire(scheduled.callback);
+            firing.unlock();
+            locker.relock();
+        }
+    }
+
+private:
+    // Drops the callbacks named name, or all camera or recorder callbacks
+    void drop(const QByteArray &name, bool recorder)
+    {
+        QMultiMap<qint64, ScheduledCallback>::iterator it = m_pending.begin();
+        while (it != m_pending.end()) {
+            const QByteArray &pending = it.value().callback.name;
+            const bool matches = name.isEmpty() ? isRecorderCallback(pending) == recorder
+                                                : pending == name;
+            if (matches)
+                it = m_pending.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    static QByteArray payload(const HalCallback &callback)
+    {
+        if (!callback.payload.isEmpty())
+            return callback.payload;
+
+        QFile file(callback.payloadFile);
+        if (!callback.payloadFile.isEmpty() && file.open(QIODevice::ReadOnly))
+            return file.readAll();
+
+        if (callback.imageSize.isValid())
+            return HalSimulation::createJpeg(callback.imageSize, callback.imageQuality);
+
+        // Keep the size realistic when there is no payload to hand
+        QByteArray data(callback.payloadSize, '\0');
+        if (data.size() >= 4) {
+            data[0] = '\xff';
+            data[1] = '\xd8';
+            data[data.size() - 2] = '\xff';
+            data[data.size() - 1] = '\xd9';
+        }
+        return data;
+    }
+
+    void fire(const HalCallback &callback)
+    {
+        const QByteArray &name = callback.name;
+        if (name == "on_recorder_msg_error") {
+            if (m_recorderError != 0)
+                m_recorderError(m_recorderErrorContext);
+            return;
+        }
+        if (name == "on_recorder_read_audio") {
+            if (m_readAudio != 0)
+                m_readAudio(m_readAudioContext);
+            return;
+        }
+
+        CameraControlListener *listener = m_listener;
+        if (listener == 0)
+            return;
+
+        if (name == "on_msg_error" && listener->on_msg_error_cb != 0) {
+            listener->on_msg_error_cb(listener->context);
+        } else if (name == "on_msg_shutter" && listener->on_msg_shutter_cb != 0) {
+            listener->on_msg_shutter_cb(listener->context);
+        } else if (name == "on_msg_focus" && listener->on_msg_focus_cb != 0) {
+            listener->on_msg_focus_cb(listener->context);
+        } else if (name == "on_msg_zoom" && listener->on_msg_zoom_cb != 0) {
+            listener->on_msg_zoom_cb(listener->context, callback.arguments.value(0).toInt());
+        } else if (name == "on_preview_texture_needs_update"
+                   && listener->on_preview_texture_needs_update_cb != 0) {
+            listener->on_preview_texture_needs_update_cb(listener->context);
+        } else if (name == "on_data_compressed_image"
+                   && listener->on_data_compressed_image_cb != 0) {
+            QByteArray data = payload(callback);
+            listener->on_data_compressed_image_cb(data.data(), data.size(), listener->context);
+        }
+    }
+
+    QMutex m_mutex;
+    QMutex m_firing;
+    QWaitCondition m_wakeUp;
+    QElapsedTimer m_clock;
+    QMultiMap<qint64, ScheduledCallback> m_pending;
+
+    CameraControlListener *m_listener;
+    void (*m_recorderError)(void*);
+    void *m_recorderErrorContext;
+    void (*m_readAudio)(void*);
+    void *m_readAudioContext;
+};
+
+/*
+ * Started on first use and never stopped, HAL threads outlive the tests as
+ * well. Callbacks must not set a listener, that would wait for themselves.
+ */
+CallbackThread *callbackThread()
+{
+    static CallbackThread *thread = 0;
+    static QMutex mutex;
+    QMutexLocker locker(&mutex);
+    if (thread == 0) {
+        thread = new CallbackThread;
+        thread->start();
+    }
+    return thread;
+}
+
+} // namespace
+
+/*!
+ * \brief HalCallbacks::now returns the time callbacks are scheduled in, in
+ * microseconds
+ */
+qint64 HalCallbacks::now()
+{
+    return callbackThread()->now();
+}
+
+/*!
+ * \brief HalCallbacks::schedule makes \p callback at \p due, and every \p
+ * period microseconds after that when period is positive
+ */
+void HalCallbacks::schedule(qint64 due, const HalCallback &callback, qint64 period)
+{
+    ScheduledCallback scheduled;
+    scheduled.callback = callback;
+    scheduled.period = period;
+    callbackThread()->schedule(due, scheduled);
+}
+
+/*!
+ * \brief HalCallbacks::cancel drops the scheduled callbacks named \p name
+ */
+void HalCallbacks::cancel(const QByteArray &name)
+{
+    callbackThread()->cancel(name);
+}
+
+/*!
+ * \brief HalCallbacks::clear drops all scheduled callbacks
+ */
+void HalCallbacks::clear()
+{
+    callbackThread()->clear();
+}
+
+void HalCallbacks::setCameraListener(CameraControlListener *listener)
+{
+    callbackThread()->setCameraListener(listener);
+}
+
+void HalCallbacks::setRecorderErrorCallback(void (*callback)(void *context), void *context)
+{
+    callbackThread()->setRecorderError(callback, context);
+}
+
+void HalCallbacks::setRecorderReadAudioCallback(void (*callback)(void *context), void *context)
+{
+    callbackThread()->setReadAudio(callback, context);
+}
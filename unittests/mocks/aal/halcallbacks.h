@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HALCALLBACKS_H
+#define HALCALLBACKS_H
+
+#include <QByteArray>
+#include <QList>
+#include <QSize>
+#include <QString>
+#include <QtGlobal>
+
+struct CameraControlListener;
+
+/*!
+ * \brief The HalCallback class is a callback the mock HAL makes later, named
+ * like the field of the listener it goes to
+ */
+class HalCallback
+{
+public:
+    explicit HalCallback(const QByteArray &name = QByteArray())
+        : name(name),
+          payloadSize(0),
+          imageQuality(0)
+    {
+    }
+
+    QByteArray name;
+    QList<QByteArray> arguments;
+    // The compressed image, else read from payloadFile, else a JPEG of
+    // imageSize encoded when the callback is made, else payloadSize made up bytes
+    QByteArray payload;
+    QString payloadFile;
+    int payloadSize;
+    QSize imageSize;
+    int imageQuality;
+};
+
+/*!
+ * \brief The HalCallbacks class makes the callbacks of the mock HAL from a
+ * thread of its own, like the HAL threads of a device do.
+ *
+ * A callback is never made after its listener is gone: setting a listener
+ * drops the callbacks for the old one and waits for the callback being made
+ * to return.
+ */
+class HalCallbacks
+{
+public:
+    static qint64 now();
+    static void schedule(qint64 due, const HalCallback &callback, qint64 period = 0);
+    static void cancel(const QByteArray &name);
+    static void clear();
+
+    static void setCameraListener(CameraControlListener *listener);
+    static void setRecorderErrorCallback(void (*callback)(void *context), void *context);
+    static void setRecorderReadAudioCallback(void (*callback)(void *context), void *context);
+};
+
+#endif // HALCALLBACKS_H
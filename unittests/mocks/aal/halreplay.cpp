@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "halreplay.h"
+#include "halcallbacks.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+
+#include <algorithm>
+
+struct ReplayCallback
+{
+    qint64 time;
+    HalCallback callback;
+};
+
+struct ReplayCall
+{
+    QByteArray name;
+    qint64 begin;
+    qint64 duration;
+    QByteArray result;
+    QList<QByteArray> outputs;
+    QList<ReplayCallback> nested;
+    QList<ReplayCallback> later;
+};
+
+namespace {
+
+class ReplaySession
+{
+public:
+    ReplaySession()
+        : firstUnused(0)
+    {
+    }
+
+    bool load(const QString &fileName);
+
+    QMutex mutex;
+    QList<ReplayCall> calls;
+    QList<bool> used;
+    int firstUnused;
+};
+
+ReplaySession *session = 0;
+
+bool parseCallback(const QList<QByteArray> &fields, const QDir &directory,
+                   ReplayCallback *callback, QByteArray *within)
+{
+    if (fields.size() < 5)
+        return false;
+
+    bool ok;
+    callback->time = fields.at(1).toLongLong(&ok);
+    callback->callback.name = fields.at(2);
+    *within = fields.at(3);
+    if (fields.at(4) != "-") {
+        const int separator = fields.at(4).indexOf(':');
+        callback->callback.payloadSize = fields.at(4).left(separator).toInt();
+        callback->callback.payloadFile = directory.filePath(QString::fromLocal8Bit(fields.at(4).mid(separator + 1)));
+    }
+    callback->callback.arguments = fields.mid(5);
+    return ok;
+}
+
+/*
+ * Callbacks made from within a call belong to that call. Any other callback
+ * belongs to the last call that started before it, and is replayed that long
+ * after the replayed call starts.
+ */
+bool ReplaySession::load(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed to open the HAL session" << fileName << ":" << file.errorString();
+        return false;
+    }
+
+    const QDir directory = QFileInfo(fileName).dir();
+    QList<ReplayCallback> callbacks;
+    QList<QByteArray> callbacksWithin;
+    int lineNumber = 0;
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine().trimmed();
+        lineNumber++;
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+
+        const QList<QByteArray> fields = line.split(' ');
+        bool ok = false;
+        if (fields.first() == "call" && fields.size() >= 5) {
+            ReplayCall call;
+            call.begin = fields.at(1).toLongLong(&ok);
+            call.duration = fields.at(2).toLongLong();
+            call.name = fields.at(3);
+            call.result = fields.at(4);
+            for (int i = 5; i < fields.size(); ++i) {
+                if (fields.at(i).startsWith('*'))
+                    call.outputs.append(fields.at(i).mid(1));
+            }
+            calls.append(call);
+        } else if (fields.first() == "callback") {
+            ReplayCallback callback;
+            QByteArray within;
+            ok = parseCallback(fields, directory, &callback, &within);
+            callbacks.append(callback);
+            callbacksWithin.append(within);
+        }
+        if (!ok) {
+            qWarning() << "Bad line" << lineNumber << "in the HAL session" << fileName;
+            return false;
+        }
+    }
+
+    // Calls are written when they return, order them by when they started
+    std::stable_sort(calls.begin(), calls.end(), [](const ReplayCall &a, const ReplayCall &b) {
+        return a.begin < b.begin;
+    });
+
+    for (int i = 0; i < callbacks.size(); ++i) {
+        const ReplayCallback &callback = callbacks.at(i);
+        int owner = calls.size() - 1;
+        while (owner >= 0 && calls.at(owner).begin > callback.time)
+            owner--;
+        if (callbacksWithin.at(i) != "-") {
+            while (owner >= 0 && calls.at(owner).name != callbacksWithin.at(i))
+                owner--;
+        }
+        if (owner < 0)
+            continue;
+
+        ReplayCall &call = calls[owner];
+        if (callbacksWithin.at(i) != "-")
+            call.nested.append(callback);
+        else
+            call.later.append(callback);
+    }
+
+    for (int i = 0; i < calls.size(); ++i)
+        used.append(false);
+    return true;
+}
+
+bool startFromEnvironment()
+{
+    const QByteArray fileName = qgetenv("AAL_CAMERA_REPLAY");
+    if (!fileName.isEmpty())
+        HalReplay::start(QString::fromLocal8Bit(fileName));
+    return HalReplay::isActive();
+}
+
+} // namespace
+
+bool HalReplay::m_active = false;
+static const bool startedFromEnvironment = startFromEnvironment();
+
+/*!
+ * \brief HalReplay::start loads the session recorded in \p fileName and
+ * replays it from its first call on
+ * \return false if the session could not be loaded
+ */
+bool HalReplay::start(const QString &fileName)
+{
+    stop();
+
+    ReplaySession *replay = new ReplaySession;
+    if (!replay->load(fileName)) {
+        delete replay;
+        return false;
+    }
+
+    session = replay;
+    m_active = true;
+    return true;
+}
+
+/*!
+ * \brief HalReplay::stop unloads the session, dropping the callbacks that
+ * have not been made yet
+ */
+void HalReplay::stop()
+{
+    if (session == 0)
+        return;
+
+    m_active = false;
+    HalCallbacks::clear();
+    delete session;
+    session = 0;
+}
+
+/*!
+ * \brief HalReplayCall::take finds the first call named \p name the replay
+ * has not made yet, schedules the callbacks arriving after it and takes as
+ * long as it did
+ */
+ReplayCall *HalReplayCall::take(const char *name)
+{
+    ReplaySession *replay = session;
+    if (replay == 0)
+        return 0;
+
+    QMutexLocker locker(&replay->mutex);
+    int index = replay->firstUnused;
+    while (index < replay->calls.size()
+           && (replay->used.at(index) || replay->calls.at(index).name != name))
+        index++;
+    if (index == replay->calls.size())
+        return 0;
+
+    replay->used[index] = true;
+    while (replay->firstUnused < replay->used.size() && replay->used.at(replay->firstUnused))
+        replay->firstUnused++;
+    locker.unlock();
+
+    ReplayCall *call = &replay->calls[index];
+    const qint64 start = HalCallbacks::now();
+    Q_FOREACH (const ReplayCallback &later, call->later)
+        HalCallbacks::schedule(start + later.time - call->begin, later.callback);
+
+    QThread::usleep(call->duration);
+    return call;
+}
+
+int HalReplayCall::result(int fallback) const
+{
+    bool ok = false;
+    const int recorded = m_call != 0 ? m_call->result.toInt(&ok) : 0;
+    return ok ? recorded : fallback;
+}
+
+QByteArray HalReplayCall::nextOutput()
+{
+    if (m_call == 0 || m_output >= m_call->outputs.size())
+        return QByteArray();
+    return m_call->outputs.at(m_output++);
+}
+
+int HalReplayCall::nestedCount() const
+{
+    return m_call != 0 ? m_call->nested.size() : 0;
+}
+
+qlonglong HalReplayCall::nestedArgument(int callback, int index) const
+{
+    return m_call->nested.at(callback).callback.arguments.value(index).toLongLong();
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HALREPLAY_H
+#define HALREPLAY_H
+
+#include <QByteArray>
+#include <QString>
+#include <QtGlobal>
+
+#include "halsimulation.h"
+
+#include <type_traits>
+
+struct ReplayCall;
+
+/*!
+ * \brief The HalReplay class plays a HAL session recorded on a device by
+ * HalRecorder back through the mock HAL.
+ *
+ * While a session is loaded, a mock call that matches the next recorded call
+ * of the same name takes as long as that call did, returns its result and out
+ * values and makes the callbacks it made from within. The callbacks that
+ * arrived after it, like the preview frames and the JPEG image, are made by
+ * HalCallbacks with the recorded delays and payloads. Calls that are
+ * not in the session keep the plain mock behaviour.
+ *
+ * The AAL_CAMERA_REPLAY environment variable names a session to load at
+ * startup.
+ */
+class HalReplay
+{
+public:
+    static bool start(const QString &fileName);
+    static void stop();
+    static bool isActive() { return m_active; }
+
+private:
+    static bool m_active;
+};
+
+/*!
+ * \brief The HalReplayCall class replays the recorded call a mock HAL function
+ * is making, if there is one, else takes the simulated latency of the call
+ */
+class HalReplayCall
+{
+public:
+    explicit HalReplayCall(const char *name)
+        : m_call(HalReplay::isActive() ? take(name) : 0),
+          m_output(0)
+    {
+        if (!m_call && HalSimulation::hasLatencies())
+            HalSimulation::delay(name);
+    }
+
+    bool isReplayed() const { return m_call != 0; }
+    int result(int fallback) const;
+
+    template<typename T>
+    void output(T *value)
+    {
+        const QByteArray recorded = nextOutput();
+        if (value != 0 && !recorded.isEmpty())
+            *value = parse<T>(recorded, typename std::is_floating_point<T>::type());
+    }
+
+    template<typename A>
+    void callbacks(void (*callback)(void*, A), void *context) const
+    {
+        for (int i = 0; i < nestedCount(); ++i)
+            callback(context, static_cast<A>(nestedArgument(i, 0)));
+    }
+
+    template<typename A, typename B>
+    void callbacks(void (*callback)(void*, A, B), void *context) const
+    {
+        for (int i = 0; i < nestedCount(); ++i)
+            callback(context, static_cast<A>(nestedArgument(i, 0)),
+                     static_cast<B>(nestedArgument(i, 1)));
+    }
+
+private:
+    Q_DISABLE_COPY(HalReplayCall)
+
+    static ReplayCall *take(const char *name);
+    QByteArray nextOutput();
+    int nestedCount() const;
+    qlonglong nestedArgument(int callback, int index) const;
+
+    template<typename T>
+    static T parse(const QByteArray &value, std::true_type) { return T(value.toDouble()); }
+    template<typename T>
+    static T parse(const QByteArray &value, std::false_type) { return static_cast<T>(value.toLongLong()); }
+
+    ReplayCall *m_call;
+    int m_output;
+};
+
+#endif // HALREPLAY_H
@@ -0,0 +1,435 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "halsimulation.h"
+#include "halcallbacks.h"
+
+#include <QBuffer>
+#include <QDebug>
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+
+/*
+ * A latency profile has one call per line, the HAL function name followed by
+ * its latency in microseconds. The name '*' sets the latency of the calls not
+ * listed. Lines starting with '#' are comments.
+ */
+
+namespace {
+
+// A typical phone camera
+const int DEVICE_FPS = 30;
+const int DEVICE_MIN_FPS = 15;
+const int DEVICE_JPEG_QUALITY = 95;
+const int DEVICE_SHUTTER_DELAY = 60000;
+const int DEVICE_IMAGE_DELAY = 350000;
+const int DEVICE_FOCUS_DELAY = 250000;
+const int DEVICE_PICTURE_SIZES[][2] = {
+    { 4160, 3120 }, { 4160, 2340 }, { 3264, 2448 }, { 1920, 1080 }, { 1280, 720 }, { 640, 480 }, { 0, 0 }
+};
+const int DEVICE_PREVIEW_SIZES[][2] = {
+    { 1920, 1080 }, { 1440, 1080 }, { 1280, 720 }, { 960, 720 }, { 640, 480 }, { 0, 0 }
+};
+const int DEVICE_VIDEO_SIZES[][2] = {
+    { 1920, 1080 }, { 1280, 720 }, { 640, 480 }, { 0, 0 }
+};
+const int DEVICE_THUMBNAIL_SIZES[][2] = {
+    { 320, 240 }, { 320, 180 }, { 0, 0 }
+};
+
+struct SimulationState
+{
+    SimulationState()
+        : defaultLatency(0),
+          frameInterval(0),
+          shutterDelay(-1),
+          imageDelay(-1),
+          focusDelay(-1),
+          previewRunning(false),
+          previewFps(DEVICE_FPS),
+          pictureSize(DEVICE_PICTURE_SIZES[0][0], DEVICE_PICTURE_SIZES[0][1]),
+          jpegQuality(DEVICE_JPEG_QUALITY),
+          jpegSizeQuality(0)
+    {
+    }
+
+    QMutex mutex;
+    QHash<QByteArray, int> latencies;
+    int defaultLatency;
+    int frameInterval;
+    int shutterDelay;
+    int imageDelay;
+    int focusDelay;
+    QByteArray image;
+    bool previewRunning;
+
+    // Set by the service on the simulated device
+    int previewFps;
+    QSize pictureSize;
+    int jpegQuality;
+
+    // The last JPEG created, captures of the same size reuse it
+    QMutex jpegMutex;
+    QSize jpegSize;
+    int jpegSizeQuality;
+    QByteArray jpeg;
+};
+
+SimulationState simulation;
+
+const QByteArray PREVIEW_FRAME("on_preview_texture_needs_update");
+const QByteArray FOCUS("on_msg_focus");
+
+// Called with the simulation locked
+int previewFrameInterval()
+{
+    if (simulation.frameInterval > 0)
+        return simulation.frameInterval;
+    if (HalSimulation::isDeviceSimulated() && simulation.previewFps > 0)
+        return 1000000 / simulation.previewFps;
+    return 0;
+}
+
+bool loadFromEnvironment()
+{
+    const QByteArray fileName = qgetenv("AAL_MOCK_HAL_LATENCIES");
+    if (!fileName.isEmpty())
+        HalSimulation::loadLatencies(QString::fromLocal8Bit(fileName));
+    if (!qgetenv("AAL_MOCK_HAL_DEVICE").isEmpty())
+        HalSimulation::setDeviceSimulated(true);
+    return true;
+}
+
+} // namespace
+
+bool HalSimulation::m_hasLatencies = false;
+bool HalSimulation::m_deviceSimulated = false;
+static const bool loadedFromEnvironment = loadFromEnvironment();
+
+/*!
+ * \brief HalSimulation::setLatency makes the HAL function \p call take \p
+ * latency microseconds, or every call not given a latency of its own when \p
+ * call is "*"
+ */
+void HalSimulation::setLatency(const QByteArray &call, int latency)
+{
+    QMutexLocker locker(&simulation.mutex);
+    if (call == "*")
+        simulation.defaultLatency = latency;
+    else
+        simulation.latencies.insert(call, latency);
+    m_hasLatencies = true;
+}
+
+/*!
+ * \brief HalSimulation::loadLatencies adds the latencies of the profile in \p
+ * fileName
+ * \return false if the profile could not be read
+ */
+bool HalSimulation::loadLatencies(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed to open the HAL latency profile" << fileName << ":" << file.errorString();
+        return false;
+    }
+
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine().simplified();
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+
+        const QList<QByteArray> fields = line.split(' ');
+        bool ok = false;
+        const int latency = fields.value(1).toInt(&ok);
+        if (fields.size() != 2 || !ok || latency < 0) {
+            qWarning() << "Bad line in the HAL latency profile" << fileName << ":" << line;
+            return false;
+        }
+        setLatency(fields.at(0), latency);
+    }
+    return true;
+}
+
+/*!
+ * \brief HalSimulation::clearLatencies makes every call instant again
+ */
+void HalSimulation::clearLatencies()
+{
+    QMutexLocker locker(&simulation.mutex);
+    simulation.latencies.clear();
+    simulation.defaultLatency = 0;
+    m_hasLatencies = false;
+}
+
+/*!
+ * \brief HalSimulation::delay takes as long as the HAL function \p call is
+ * set to take
+ */
+void HalSimulation::delay(const char *call)
+{
+    QMutexLocker locker(&simulation.mutex);
+    const int latency = simulation.latencies.value(QByteArray(call), simulation.defaultLatency);
+    locker.unlock();
+
+    if (latency > 0)
+        QThread::usleep(latency);
+}
+
+/*!
+ * \brief HalSimulation::setPreviewFrameInterval makes the preview deliver a
+ * frame every \p interval microseconds while it runs, or no frames when it is
+ * 0
+ */
+void HalSimulation::setPreviewFrameInterval(int interval)
+{
+    QMutexLocker locker(&simulation.mutex);
+    simulation.frameInterval = interval;
+}
+
+/*!
+ * \brief HalSimulation::setSnapshotDelays makes a snapshot call back the
+ * shutter \p shutterDelay and the compressed image \p imageDelay microseconds
+ * after it was taken. A negative delay leaves that callback out.
+ */
+void HalSimulation::setSnapshotDelays(int shutterDelay, int imageDelay)
+{
+    QMutexLocker locker(&simulation.mutex);
+    simulation.shutterDelay = shutterDelay;
+    simulation.imageDelay = imageDelay;
+}
+
+/*!
+ * \brief HalSimulation::setSnapshotImage sets the compressed image snapshots
+ * deliver
+ */
+void HalSimulation::setSnapshotImage(const QByteArray &jpeg)
+{
+    QMutexLocker locker(&simulation.mutex);
+    simulation.image = jpeg;
+}
+
+/*!
+ * \brief HalSimulation::setFocusDelay makes the focus callback come \p
+ * focusDelay microseconds after autofocus started, or never when it is negative
+ */
+void HalSimulation::setFocusDelay(int focusDelay)
+{
+    QMutexLocker locker(&simulation.mutex);
+    simulation.focusDelay = focusDelay;
+}
+
+/*!
+ * \brief HalSimulation::setDeviceSimulated turns the simulated device on or
+ * off. Turning it on sets the delays of a typical device, which can be changed
+ * afterwards.
+ */
+void HalSimulation::setDeviceSimulated(bool simulated)
+{
+    if (simulated) {
+        setSnapshotDelays(DEVICE_SHUTTER_DELAY, DEVICE_IMAGE_DELAY);
+        setFocusDelay(DEVICE_FOCUS_DELAY);
+    } else {
+        setSnapshotDelays(-1, -1);
+        setFocusDelay(-1);
+        previewStopped();
+    }
+
+    QMutexLocker locker(&simulation.mutex);
+    m_deviceSimulated = simulated;
+    simulation.previewFps = DEVICE_FPS;
+    simulation.pictureSize = QSize(DEVICE_PICTURE_SIZES[0][0], DEVICE_PICTURE_SIZES[0][1]);
+    simulation.jpegQuality = DEVICE_JPEG_QUALITY;
+}
+
+/*!
+ * \brief HalSimulation::reset turns the whole simulation off
+ */
+void HalSimulation::reset()
+{
+    clearLatencies();
+    setDeviceSimulated(false);
+    setPreviewFrameInterval(0);
+    setSnapshotImage(QByteArray());
+    previewStopped();
+}
+
+/*!
+ * \brief HalSimulation::createJpeg returns a JPEG of \p size, with enough
+ * detail to take about as long to encode and to be about as large as a photo
+ */
+QByteArray HalSimulation::createJpeg(const QSize &size, int quality)
+{
+    QMutexLocker locker(&simulation.jpegMutex);
+    if (size == simulation.jpegSize && quality == simulation.jpegSizeQuality)
+        return simulation.jpeg;
+
+    QImage image(size, QImage::Format_RGB32);
+    quint32 noise = 1;
+    for (int y = 0; y < image.height(); ++y) {
+        QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            noise = noise * 1664525u + 1013904223u;
+            const int grain = (noise >> 26) & 0x1f;
+            line[x] = qRgb(qMin(255, x * 224 / image.width() + grain),
+                           qMin(255, y * 224 / image.height() + grain),
+                           qMin(255, 128 + grain));
+        }
+    }
+
+    QByteArray jpeg;
+    QBuffer buffer(&jpeg);
+    buffer.open(QIODevice::WriteOnly);
+    if (!image.save(&buffer, "JPG", quality))
+        qWarning() << "Failed to encode a simulated JPEG of" << size;
+
+    simulation.jpegSize = size;
+    simulation.jpegSizeQuality = quality;
+    simulation.jpeg = jpeg;
+    return jpeg;
+}
+
+void HalSimulation::previewStarted()
+{
+    QMutexLocker locker(&simulation.mutex);
+    const int interval = previewFrameInterval();
+    if (simulation.previewRunning || interval <= 0)
+        return;
+
+    simulation.previewRunning = true;
+    HalCallbacks::schedule(HalCallbacks::now() + interval, HalCallback(PREVIEW_FRAME), interval);
+}
+
+void HalSimulation::previewStopped()
+{
+    QMutexLocker locker(&simulation.mutex);
+    if (!simulation.previewRunning)
+        return;
+
+    simulation.previewRunning = false;
+    HalCallbacks::cancel(PREVIEW_FRAME);
+}
+
+/*!
+ * \brief HalSimulation::snapshotTaken schedules the callbacks of a snapshot.
+ * Like on a device the preview stops for it.
+ */
+void HalSimulation::snapshotTaken()
+{
+    previewStopped();
+
+    QMutexLocker locker(&simulation.mutex);
+    const qint64 now = HalCallbacks::now();
+    if (simulation.shutterDelay >= 0)
+        HalCallbacks::schedule(now + simulation.shutterDelay, HalCallback("on_msg_shutter"));
+    if (simulation.imageDelay >= 0) {
+        HalCallback image("on_data_compressed_image");
+        image.payload = simulation.image;
+        if (image.payload.isEmpty() && m_deviceSimulated) {
+            image.imageSize = simulation.pictureSize;
+            image.imageQuality = simulation.jpegQuality;
+        }
+        HalCallbacks::schedule(now + simulation.imageDelay, image);
+    }
+}
+
+void HalSimulation::autofocusStarted()
+{
+    QMutexLocker locker(&simulation.mutex);
+    if (!m_deviceSimulated || simulation.focusDelay < 0)
+        return;
+
+    HalCallbacks::cancel(FOCUS);
+    HalCallbacks::schedule(HalCallbacks::now() + simulation.focusDelay, HalCallback(FOCUS));
+}
+
+void HalSimulation::autofocusStopped()
+{
+    HalCallbacks::cancel(FOCUS);
+}
+
+/*!
+ * \brief HalSimulation::previewFpsSet makes a running preview of the
+ * simulated device continue at \p fps
+ */
+void HalSimulation::previewFpsSet(int fps)
+{
+    QMutexLocker locker(&simulation.mutex);
+    if (!m_deviceSimulated || fps <= 0 || fps == simulation.previewFps)
+        return;
+
+    simulation.previewFps = fps;
+    if (simulation.previewRunning) {
+        const int interval = previewFrameInterval();
+        HalCallbacks::cancel(PREVIEW_FRAME);
+        HalCallbacks::schedule(HalCallbacks::now() + interval, HalCallback(PREVIEW_FRAME), interval);
+    }
+}
+
+void HalSimulation::pictureSizeSet(int width, int height)
+{
+    QMutexLocker locker(&simulation.mutex);
+    if (m_deviceSimulated && width > 0 && height > 0)
+        simulation.pictureSize = QSize(width, height);
+}
+
+void HalSimulation::jpegQualitySet(int quality)
+{
+    QMutexLocker locker(&simulation.mutex);
+    if (m_deviceSimulated && quality > 0 && quality <= 100)
+        simulation.jpegQuality = quality;
+}
+
+/*!
+ * \brief HalSimulation::previewFpsRange gives the preview frame rate range of
+ * the simulated device, in frames per 1000 seconds like Android
+ */
+void HalSimulation::previewFpsRange(int *min, int *max)
+{
+    if (!m_deviceSimulated)
+        return;
+
+    *min = DEVICE_MIN_FPS * 1000;
+    *max = DEVICE_FPS * 1000;
+}
+
+/*!
+ * \brief HalSimulation::supportedSizes reports the sizes of the simulated
+ * device the enumeration function \p call asks for
+ */
+void HalSimulation::supportedSizes(const char *call, void (*callback)(void *context, int width, int height),
+                                   void *context)
+{
+    if (!m_deviceSimulated)
+        return;
+
+    const QByteArray name(call);
+    const int (*sizes)[2] = DEVICE_PICTURE_SIZES;
+    if (name.endsWith("_preview_sizes"))
+        sizes = DEVICE_PREVIEW_SIZES;
+    else if (name.endsWith("_video_sizes"))
+        sizes = DEVICE_VIDEO_SIZES;
+    else if (name.endsWith("_thumbnail_sizes"))
+        sizes = DEVICE_THUMBNAIL_SIZES;
+
+    for (; (*sizes)[0] != 0; ++sizes)
+        callback(context, (*sizes)[0], (*sizes)[1]);
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HALSIMULATION_H
+#define HALSIMULATION_H
+
+#include <QByteArray>
+#include <QSize>
+#include <QString>
+#include <QtGlobal>
+
+/*!
+ * \brief The HalSimulation class makes the mock HAL behave more like a device,
+ * for benchmarks and load tests: calls take time, and the preview frames, the
+ * shutter, the compressed image and the focus arrive from another thread.
+ *
+ * In the simulated device mode the mock also reports the sizes and frame
+ * rates of a typical camera, the preview runs at the frame rate the service
+ * sets and a snapshot delivers a JPEG of the picture size the service sets,
+ * encoded on the callback thread.
+ *
+ * Everything is off by default, so the unit tests keep an instant mock. The
+ * AAL_MOCK_HAL_LATENCIES environment variable names a latency profile to load
+ * at startup, and setting AAL_MOCK_HAL_DEVICE turns the simulated device on.
+ */
+class HalSimulation
+{
+public:
+    static void setLatency(const QByteArray &call, int latency);
+    static bool loadLatencies(const QString &fileName);
+    static void clearLatencies();
+    static bool hasLatencies() { return m_hasLatencies; }
+    static void delay(const char *call);
+
+    static void setDeviceSimulated(bool simulated);
+    static bool isDeviceSimulated() { return m_deviceSimulated; }
+
+    static void setPreviewFrameInterval(int interval);
+    static void setSnapshotDelays(int shutterDelay, int imageDelay);
+    static void setSnapshotImage(const QByteArray &jpeg);
+    static void setFocusDelay(int focusDelay);
+    static void reset();
+
+    static QByteArray createJpeg(const QSize &size, int quality);
+
+    // Called by the mock HAL functions that are not replayed
+    static void previewStarted();
+    static void previewStopped();
+    static void snapshotTaken();
+    static void autofocusStarted();
+    static void autofocusStopped();
+    static void previewFpsSet(int fps);
+    static void pictureSizeSet(int width, int height);
+    static void jpegQualitySet(int quality);
+    static void previewFpsRange(int *min, int *max);
+    static void supportedSizes(const char *call, void (*callback)(void *context, int width, int height),
+                               void *context);
+
+private:
+    static bool m_hasLatencies;
+    static bool m_deviceSimulated;
+};
+
+#endif // HALSIMULATION_H
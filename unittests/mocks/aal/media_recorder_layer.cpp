@@ -17,6 +17,8 @@
 
 #include "media_recorder_layer.h"
 #include "camera_control.h"
+#include "halcallbacks.h"
+#include "halreplay.h"
 
 #include <qglobal.h>
 
@@ -40,12 +42,21 @@ void android_recorder_set_error_cb(MediaRecorderWrapper *mr, on_recorder_msg_err
                                    void *context)
 {
     Q_UNUSED(mr);
-    Q_UNUSED(cb);
-    Q_UNUSED(context);
+    HalReplayCall replay(__func__);
+    HalCallbacks::setRecorderErrorCallback(cb, context);
+}
+
+void android_recorder_set_audio_read_cb(MediaRecorderWrapper *mr, on_recorder_read_audio cb,
+                                        void *context)
+{
+    Q_UNUSED(mr);
+    HalReplayCall replay(__func__);
+    HalCallbacks::setRecorderReadAudioCallback(cb, context);
 }
 
 MediaRecorderWrapper *android_media_new_recorder()
 {
+    HalReplayCall replay(__func__);
     MediaRecorderWrapper *mr = new MediaRecorderWrapper;
     return mr;
 }
@@ -53,56 +64,64 @@ MediaRecorderWrapper *android_media_new_recorder()
 int android_recorder_initCheck(MediaRecorderWrapper *mr)
 {
     Q_UNUSED(mr);
-    return 0;
+    HalReplayCall replay(__func__);
+    return replay.result(0);
 }
 
 int android_recorder_setCamera(MediaRecorderWrapper *mr, CameraControl* control)
 {
     Q_UNUSED(mr);
     Q_UNUSED(control);
-    return 0;
+    HalReplayCall replay(__func__);
+    return replay.result(0);
 }
 
 int android_recorder_setVideoSource(MediaRecorderWrapper *mr, VideoSource vs)
 {
     Q_UNUSED(mr);
     Q_UNUSED(vs);
-    return 0;
+    HalReplayCall replay(__func__);
+    return replay.result(0);
 }
 
 int android_recorder_setAudioSource(MediaRecorderWrapper *mr, AudioSource as)
 {
     Q_UNUSED(mr);
     Q_UNUSED(as);
-    return 0;
+    HalReplayCall replay(__func__);
+    return replay.result(0);
 }
 
 int android_recorder_setOutputFormat(MediaRecorderWrapper *mr, OutputFormat of)
 {
     Q_UNUSED(mr);
     Q_UNUSED(of);
-    return 0;
+    HalReplayCall replay(__func__);
+    return replay.result(0);
 }
 
 int android_recorder_setVideoEncoder(MediaRecorderWrapper *mr, VideoEncoder ve)
 {
     Q_UNUSED(mr);
     Q_UNUSED(ve);
-    return 0;
+    HalReplayCall replay(__func__);
+    return replay.result(0);
 }
 
 int android_recorder_setAudioEncoder(MediaRecorderWrapper *mr, AudioEncoder ae)
 {
     Q_UNUSED(mr);
     Q_UNUSED(ae);
-    return 0;
+    HalReplayCall replay(__func__);
+    return replay.result(0);
 }
 
 int android_recorder_setOutputFile(MediaRecorderWrapper *mr, int fd)
 {
     Q_UNUSED(mr);
     Q_UNUSED(fd);
-    return 0;
+    HalReplayCall replay(__func__);
+    return replay.result(0);
 }
 
 int android_recorder_setVideoSize(MediaRecorderWrapper *mr, int width, int height)
@@ -110,55 +129,80 @@ int android_recorder_setVideoSize(MediaRecorderWrapper *mr, int width, int heigh
     Q_UNUSED(mr);
     Q_UNUSED(width);
     Q_UNUSED(height);
-    return 0;
+    HalReplayCall replay(__func__);
+    return replay.result(0);
 }
 
 int android_recorder_setVideoFrameRate(MediaRecorderWrapper *mr, int frames_per_second)
 {
     Q_UNUSED(mr);
     Q_UNUSED(frames_per_second);
-    return 0;
+    HalReplayCall replay(__func__);
+    return replay.result(0);
 }
 
 int android_recorder_setParameters(MediaRecorderWrapper *mr, const char* parameters)
 {
     Q_UNUSED(mr);
     Q_UNUSED(parameters);
-    return 0;
+    HalReplayCall replay(__func__);
+    return replay.result(0);
 }
 
 int android_recorder_start(MediaRecorderWrapper *mr)
 {
     Q_UNUSED(mr);
-    return 0;
+    HalReplayCall replay(__func__);
+    return replay.result(0);
 }
 
 int android_recorder_stop(MediaRecorderWrapper *mr)
 {
     Q_UNUSED(mr);
-    return 0;
+    HalReplayCall replay(__func__);
+    return replay.result(0);
+}
+
+int android_recorder_pause(MediaRecorderWrapper *mr)
+{
+    Q_UNUSED(mr);
+    HalReplayCall replay(__func__);
+    return replay.result(0);
+}
+
+int android_recorder_resume(MediaRecorderWrapper *mr)
+{
+    Q_UNUSED(mr);
+    HalReplayCall replay(__func__);
+    return replay.result(0);
 }
 
 int android_recorder_prepare(MediaRecorderWrapper *mr)
 {
     Q_UNUSED(mr);
-    return 0;
+    HalReplayCall replay(__func__);
+    return replay.result(0);
 }
 
 int android_recorder_reset(MediaRecorderWrapper *mr)
 {
     Q_UNUSED(mr);
-    return 0;
+    HalReplayCall replay(__func__);
+    return replay.result(0);
 }
 
 int android_recorder_close(MediaRecorderWrapper *mr)
 {
     Q_UNUSED(mr);
-    return 0;
+    HalReplayCall replay(__func__);
+    return replay.result(0);
 }
 
 int android_recorder_release(MediaRecorderWrapper *mr)
 {
     Q_UNUSED(mr);
-    return 0;
+    HalReplayCall replay(__func__);
+    HalCallbacks::setRecorderErrorCallback(0, 0);
+    HalCallbacks::setRecorderReadAudioCallback(0, 0);
+    return replay.result(0);
 }
@@ -92,10 +92,13 @@ extern "C" {
 
     // Callback types
     typedef void (*on_recorder_msg_error)(void *context);
+    typedef void (*on_recorder_read_audio)(void *context);
 
     // Callback setters
     void android_recorder_set_error_cb(MediaRecorderWrapper *mr, on_recorder_msg_error cb,
                                        void *context);
+    void android_recorder_set_audio_read_cb(MediaRecorderWrapper *mr, on_recorder_read_audio cb,
+                                            void *context);
 
     // Main recorder control API
     MediaRecorderWrapper *android_media_new_recorder();
@@ -112,6 +115,8 @@ extern "C" {
     int android_recorder_setParameters(MediaRecorderWrapper *mr, const char* parameters);
     int android_recorder_start(MediaRecorderWrapper *mr);
     int android_recorder_stop(MediaRecorderWrapper *mr);
+    int android_recorder_pause(MediaRecorderWrapper *mr);
+    int android_recorder_resume(MediaRecorderWrapper *mr);
     int android_recorder_prepare(MediaRecorderWrapper *mr);
     int android_recorder_reset(MediaRecorderWrapper *mr);
     int android_recorder_close(MediaRecorderWrapper *mr);
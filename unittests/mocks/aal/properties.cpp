@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "properties.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <string.h>
+
+/*
+ * The android properties of the tests, set with property_set() and empty
+ * until then, so that every device quirk has its default
+ */
+static QHash<QByteArray, QByteArray> properties;
+static QMutex propertiesMutex;
+
+int property_get(const char *key, char *value, const char *default_value)
+{
+    QMutexLocker locker(&propertiesMutex);
+    QByteArray result = properties.value(QByteArray(key), QByteArray(default_value ? default_value : ""));
+    result.truncate(PROP_VALUE_MAX - 1);
+    memcpy(value, result.constData(), result.size() + 1);
+    return result.size();
+}
+
+int property_set(const char *key, const char *value)
+{
+    QMutexLocker locker(&propertiesMutex);
+    if (value == 0 || *value == '\0')
+        properties.remove(QByteArray(key));
+    else
+        properties.insert(QByteArray(key), QByteArray(value));
+    return 0;
+}
@@ -0,0 +1,16 @@
+include(../../coverage.pri)
+
+TARGET = tst_replaybuffer
+
+QT += testlib concurrent
+
+HEADERS += ../../src/replaybuffer.h
+
+SOURCES += tst_replaybuffer.cpp \
+    ../../src/replaybuffer.cpp
+
+INCLUDEPATH += ../../src
+
+check.depends = $${TARGET}
+check.commands = ./$${TARGET}
+QMAKE_EXTRA_TARGETS += check
@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest/QtTest>
+#include <QFile>
+
+#include <unistd.h>
+
+#include "replaybuffer.h"
+
+const QLatin1String replayFile("/tmp/aalCameraReplayBufferTest.ts");
+const int programMapPid = 0x20;
+const int videoPid = 0x100;
+const int audioPid = 0x101;
+
+class tst_ReplayBuffer : public QObject
+{
+    Q_OBJECT
+private slots:
+    void cleanup();
+    void saveStartsAtProgramTable();
+    void saveStartsBeforeKeyFrame();
+    void saveStartsBeforeRequestedStart();
+    void windowDropsOldData();
+    void nothingToSave();
+
+private:
+    QByteArray packet(int pid, bool payloadUnitStart, char fill);
+    QByteArray programTables();
+    QByteArray keyFrame(int pid);
+    void writeAll(int fd, const QByteArray &data);
+};
+
+void tst_ReplayBuffer::cleanup()
+{
+    QFile::remove(replayFile);
+}
+
+void tst_ReplayBuffer::saveStartsAtProgramTable()
+{
+    ReplayBuffer buffer(10000);
+    QSignalSpy savedSpy(&buffer, SIGNAL(replaySaved(QString)));
+
+    int fd = buffer.start();
+    QVERIFY(fd >= 0);
+
+    // A partial packet must be held back until the rest of it arrives
+    QByteArray stream = packet(0x100, true, 'a') + packet(0, true, 'b') + packet(0x100, false, 'c');
+    writeAll(fd, stream.left(200));
+    writeAll(fd, stream.mid(200));
+    close(fd);
+    buffer.stop();
+
+    QCOMPARE(buffer.size(), qint64(stream.size()));
+    QVERIFY(buffer.saveReplay(replayFile, 10000));
+    QTRY_COMPARE(savedSpy.count(), 1);
+
+    QFile file(replayFile);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), stream.mid(ReplayBuffer::TS_PACKET_SIZE));
+}
+
+void tst_ReplayBuffer::saveStartsBeforeKeyFrame()
+{
+    ReplayBuffer buffer(10000);
+    QSignalSpy savedSpy(&buffer, SIGNAL(replaySaved(QString)));
+
+    int fd = buffer.start();
+    QVERIFY(fd >= 0);
+
+    // The audio is always a random access point, the replay waits for the video
+    QByteArray gop = programTables() + packet(videoPid, false, 'v') + keyFrame(audioPid);
+    QByteArray stream = gop + programTables() + packet(audioPid, true, 'a') +
+            keyFrame(videoPid) + packet(videoPid, false, 'v');
+    writeAll(fd, stream);
+    close(fd);
+    buffer.stop();
+
+    QVERIFY(buffer.saveReplay(replayFile, 10000));
+    QTRY_COMPARE(savedSpy.count(), 1);
+
+    QFile file(replayFile);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), stream.mid(gop.size()));
+}
+
+void tst_ReplayBuffer::saveStartsBeforeRequestedStart()
+{
+    ReplayBuffer buffer(10000);
+    QSignalSpy savedSpy(&buffer, SIGNAL(replaySaved(QString)));
+
+    int fd = buffer.start();
+    QVERIFY(fd >= 0);
+
+    // The requested part has no key frame, the one before it is needed
+    QByteArray gop = programTables() + keyFrame(videoPid) + packet(videoPid, false, 'v');
+    writeAll(fd, gop);
+    QTest::qSleep(300);
+    QByteArray requested = programTables() + packet(videoPid, false, 'w');
+    writeAll(fd, requested);
+    close(fd);
+    buffer.stop();
+
+    QVERIFY(buffer.saveReplay(replayFile, 100));
+    QTRY_COMPARE(savedSpy.count(), 1);
+
+    QFile file(replayFile);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), gop + requested);
+}
+
+void tst_ReplayBuffer::windowDropsOldData()
+{
+    ReplayBuffer buffer(100);
+
+    int fd = buffer.start();
+    QVERIFY(fd >= 0);
+
+    writeAll(fd, packet(0, true, 'a'));
+    QTest::qSleep(300);
+    writeAll(fd, packet(0, true, 'b'));
+    close(fd);
+    buffer.stop();
+
+    QCOMPARE(buffer.size(), qint64(ReplayBuffer::TS_PACKET_SIZE));
+}
+
+void tst_ReplayBuffer::nothingToSave()
+{
+    ReplayBuffer buffer(1000);
+    QVERIFY(!buffer.saveReplay(replayFile, 1000));
+
+    QSignalSpy failedSpy(&buffer, SIGNAL(replayFailed(QString)));
+    int fd = buffer.start();
+    writeAll(fd, packet(0x100, true, 'a'));
+    close(fd);
+    buffer.stop();
+
+    QVERIFY(buffer.saveReplay(replayFile, 1000));
+    QTRY_COMPARE(failedSpy.count(), 1);
+    QVERIFY(!QFile::exists(replayFile));
+}
+
+QByteArray tst_ReplayBuffer::packet(int pid, bool payloadUnitStart, char fill)
+{
+    QByteArray data(ReplayBuffer::TS_PACKET_SIZE, fill);
+    data[0] = 0x47;
+    data[1] = ((pid >> 8) & 0x1f) | (payloadUnitStart ? 0x40 : 0);
+    data[2] = pid & 0xff;
+    data[3] = 0x10; // payload only
+    return data;
+}
+
+/*!
+ * \brief Returns a program association table pointing at programMapPid and a
+ * program map table with an audio stream followed by an H.264 stream
+ */
+QByteArray tst_ReplayBuffer::programTables()
+{
+    const QByteArray pat("\x00\xb0\x0d\x00\x01\xc1\x00\x00"
+                         "\x00\x01\xe0\x20"
+                         "\x00\x00\x00\x00", 16);
+    const QByteArray pmt("\x02\xb0\x17\x00\x01\xc1\x00\x00\xe1\x00\xf0\x00"
+                         "\x0f\xe1\x01\xf0\x00"
+                         "\x1b\xe1\x00\xf0\x00"
+                         "\x00\x00\x00\x00", 26);
+
+    QByteArray patPacket = packet(0, true, '\xff');
+    patPacket[3] = 0x10;
+    patPacket[4] = 0;
+    patPacket.replace(5, pat.size(), pat);
+
+    QByteArray pmtPacket = packet(programMapPid, true, '\xff');
+    pmtPacket[3] = 0x10;
+    pmtPacket[4] = 0;
+    pmtPacket.replace(5, pmt.size(), pmt);
+
+    return patPacket + pmtPacket;
+}
+
+QByteArray tst_ReplayBuffer::keyFrame(int pid)
+{
+    QByteArray data = packet(pid, true, 'k');
+    data[3] = 0x30;
+    data[4] = 1;
+    data[5] = 0x40; // random_access_indicator
+    return data;
+}
+
+void tst_ReplayBuffer::writeAll(int fd, const QByteArray &data)
+{
+    QCOMPARE(write(fd, data.constData(), data.size()), ssize_t(data.size()));
+    // Give the reader the chance to see each write on its own
+    QTest::qSleep(20);
+}
+
+QTEST_GUILESS_MAIN(tst_ReplayBuffer)
+
+#include "tst_replaybuffer.moc"
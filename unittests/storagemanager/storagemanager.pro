@@ -2,10 +2,10 @@ include(../../coverage.pri)
 
 TARGET = tst_storagemanager
 
-QT += testlib
+QT += testlib concurrent
 
 CONFIG += link_pkgconfig
-PKGCONFIG += exiv2
+PKGCONFIG += exiv2 libturbojpeg
 
 HEADERS += ../../src/storagemanager.h
 
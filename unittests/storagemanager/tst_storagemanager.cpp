@@ -15,10 +15,17 @@
  */
 
 #include <QtTest/QtTest>
+#include <QBuffer>
+#include <QDateTime>
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
 #include <QRegExp>
+#include <QSignalSpy>
+
+#include <exiv2/exiv2.hpp>
 
 #define private public
 #include "storagemanager.h"
@@ -37,6 +44,14 @@ private slots:
     void fileNameGenerator_data();
     void fileNameGenerator();
     void updateEXIF();
+    void writeThroughput();
+    void saveImage();
+    void saveJpegImage();
+    void exifOrientation();
+    void rotateLossless();
+    void cropLossless();
+    void captureMemoryBudget();
+    void saveSpilledJpegImage();
 
 private:
     void removeTestDirectory();
@@ -134,6 +149,272 @@ void tst_StorageManager::updateEXIF()
     QCOMPARE(result, true);
 }
 
+void tst_StorageManager::writeThroughput()
+{
+    StorageManager storage;
+    QCOMPARE(storage.writeThroughput(testPath), qint64(-1));
+
+    storage.measureWriteThroughput(testPath);
+    QTRY_VERIFY_WITH_TIMEOUT(storage.writeThroughput(testPath) > 0, 30000);
+
+    QDir dir(testPath);
+    QCOMPARE(dir.entryList(QDir::Files | QDir::Hidden).count(), 0);
+}
+
+void tst_StorageManager::saveImage()
+{
+    StorageManager storage;
+    QString fileName = testPath + "snapshot.jpg";
+
+    SaveToDiskResult result = storage.saveImage(QImage(), 0, 80, QVariantMap(),
+                                                fileName, QSize(160, 120), 1);
+    QCOMPARE(result.success, false);
+    QVERIFY(!QFile::exists(fileName));
+
+    QImage image(64, 48, QImage::Format_RGB32);
+    image.fill(Qt::red);
+    result = storage.saveImage(image, 90, 80, QVariantMap(), fileName, QSize(160, 120), 2);
+    QCOMPARE(result.success, true);
+    QCOMPARE(result.fileName, fileName);
+
+    QImageReader reader(fileName);
+    QCOMPARE(reader.format(), QByteArray("jpeg"));
+    QCOMPARE(reader.size(), QSize(48, 64));
+}
+
+void tst_StorageManager::saveJpegImage()
+{
+    StorageManager storage;
+    QString fileName = testPath + "halexif.jpg";
+    const QByteArray jpeg((char*)data_validjpeg, data_validjpeg_len);
+
+    QVariantMap metadata;
+    metadata.insert("GPSLatitude", 45.5);
+    metadata.insert("GPSLongitude", -73.5);
+    metadata.insert("GPSTimeStamp", QDateTime::currentDateTime());
+
+    // A JPEG with the EXIF data of the HAL is saved as it is
+    SaveToDiskResult result = storage.saveJpegImage(jpeg, metadata, fileName, QSize(160, 120), 1, false);
+    QCOMPARE(result.success, true);
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), jpeg);
+    file.close();
+    QVERIFY(file.remove());
+
+    result = storage.saveJpegImage(jpeg, metadata, fileName, QSize(160, 120), 2);
+    QCOMPARE(result.success, true);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QVERIFY(file.readAll() != jpeg);
+    file.close();
+    QVERIFY(file.remove());
+}
+
+void tst_StorageManager::exifOrientation()
+{
+    StorageManager storage;
+    QString fileName = testPath + "orientation.jpg";
+
+    QImage image(64, 48, QImage::Format_RGB32);
+    image.fill(Qt::blue);
+    QByteArray jpeg;
+    QBuffer buffer(&jpeg);
+    buffer.open(QIODevice::WriteOnly);
+    QVERIFY(image.save(&buffer, "jpg"));
+
+    QSignalSpy previewSpy(&storage, SIGNAL(previewReady(int, QImage)));
+    QVariantMap metadata;
+    metadata.insert("Orientation", 90);
+    SaveToDiskResult result = storage.saveJpegImage(jpeg, metadata, fileName, QSize(160, 120), 1);
+    QCOMPARE(result.success, true);
+
+    // The pixels are left as they are, the preview is upright
+    QImageReader reader(fileName);
+    QCOMPARE(reader.size(), QSize(64, 48));
+    QCOMPARE(previewSpy.count(), 1);
+    QImage preview = previewSpy.at(0).at(1).value<QImage>();
+    QCOMPARE(preview.size(), QSize(90, 120));
+
+    Exiv2::Image::AutoPtr saved = Exiv2::ImageFactory::open(fileName.toStdString());
+    saved->readMetadata();
+    Exiv2::ExifData exifData = saved->exifData();
+    QCOMPARE(exifData["Exif.Image.Orientation"].toLong(), 6L);
+    QVERIFY(QFile::remove(fileName));
+}
+
+void tst_StorageManager::rotateLossless()
+{
+    StorageManager storage;
+    QString fileName = testPath + "lossless.jpg";
+
+    // Whole MCUs, so that nothing is trimmed off
+    QImage image(64, 48, QImage::Format_RGB32);
+    image.fill(Qt::blue);
+    for (int y = 0; y < image.height(); ++y) {
+        for (int x = 0; x < image.width() / 2; ++x)
+            image.setPixel(x, y, qRgb(255, 0, 0));
+    }
+    QByteArray jpeg;
+    QBuffer buffer(&jpeg);
+    buffer.open(QIODevice::WriteOnly);
+    QVERIFY(image.save(&buffer, "jpg", 95));
+
+    QVariantMap metadata;
+    metadata.insert("Orientation", 90);
+    QVERIFY(storage.saveJpegImage(jpeg, metadata, fileName, QSize(160, 120), 1).success);
+
+    QSignalSpy normalizedSpy(&storage, SIGNAL(imageNormalized(int, QString)));
+    storage.normalizeOrientation(fileName, 1);
+    QTRY_COMPARE(normalizedSpy.count(), 1);
+    QCOMPARE(normalizedSpy.at(0).at(0).toInt(), 1);
+    QCOMPARE(normalizedSpy.at(0).at(1).toString(), fileName);
+
+    // Turned clockwise, the red left half is on top now
+    QImage rotated(fileName);
+    QCOMPARE(rotated.size(), QSize(48, 64));
+    QVERIFY(qRed(rotated.pixel(24, 8)) > 200 && qBlue(rotated.pixel(24, 8)) < 50);
+    QVERIFY(qBlue(rotated.pixel(24, 56)) > 200 && qRed(rotated.pixel(24, 56)) < 50);
+
+    Exiv2::Image::AutoPtr saved = Exiv2::ImageFactory::open(fileName.toStdString());
+    saved->readMetadata();
+    Exiv2::ExifData exifData = saved->exifData();
+    QCOMPARE(exifData["Exif.Image.Orientation"].toLong(), 1L);
+
+    // An upright picture is left alone
+    QVERIFY(storage.rotateLossless(fileName));
+    QCOMPARE(QImage(fileName).size(), QSize(48, 64));
+    QVERIFY(QFile::remove(fileName));
+
+    // Partial MCUs are trimmed off, the EXIF size follows the turned picture
+    QImage uneven(70, 50, QImage::Format_RGB32);
+    uneven.fill(Qt::green);
+    QVERIFY(uneven.save(fileName, "jpg", 95));
+    {
+        Exiv2::Image::AutoPtr original = Exiv2::ImageFactory::open(fileName.toStdString());
+        original->readMetadata();
+        Exiv2::ExifData &ed = original->exifData();
+        ed["Exif.Image.Orientation"] = uint16_t(6);
+        ed["Exif.Photo.PixelXDimension"] = uint32_t(70);
+        ed["Exif.Photo.PixelYDimension"] = uint32_t(50);
+        original->writeMetadata();
+    }
+    QVERIFY(storage.rotateLossless(fileName));
+    rotated = QImage(fileName);
+    QVERIFY(rotated.height() < 70);
+    saved = Exiv2::ImageFactory::open(fileName.toStdString());
+    saved->readMetadata();
+    exifData = saved->exifData();
+    QCOMPARE(exifData["Exif.Photo.PixelXDimension"].toLong(), long(rotated.width()));
+    QCOMPARE(exifData["Exif.Photo.PixelYDimension"].toLong(), long(rotated.height()));
+    QVERIFY(QFile::remove(fileName));
+
+    QVERIFY(!storage.rotateLossless(testPath + "missing.jpg"));
+}
+
+void tst_StorageManager::cropLossless()
+{
+    StorageManager storage;
+
+    // Red on the left and right quarters, which the crop cuts off
+    QImage image(64, 48, QImage::Format_RGB32);
+    image.fill(Qt::red);
+    for (int y = 0; y < image.height(); ++y) {
+        for (int x = 16; x < 48; ++x)
+            image.setPixel(x, y, qRgb(0, 0, 255));
+    }
+    QByteArray jpeg;
+    QBuffer buffer(&jpeg);
+    buffer.open(QIODevice::WriteOnly);
+    QVERIFY(image.save(&buffer, "jpg", 95));
+
+    QByteArray cropped = storage.cropLossless(jpeg, 2.0);
+    QImage croppedImage = QImage::fromData(cropped, "jpg");
+    QCOMPARE(croppedImage.size(), QSize(32, 24));
+    QVERIFY(qBlue(croppedImage.pixel(2, 12)) > 200 && qRed(croppedImage.pixel(2, 12)) < 50);
+    QVERIFY(qBlue(croppedImage.pixel(29, 12)) > 200 && qRed(croppedImage.pixel(29, 12)) < 50);
+
+    // The saved picture keeps the size of the crop
+    QString fileName = testPath + "cropped.jpg";
+    QVERIFY(storage.saveJpegImage(cropped, QVariantMap(), fileName, QSize(160, 120), 1).success);
+    Exiv2::Image::AutoPtr saved = Exiv2::ImageFactory::open(fileName.toStdString());
+    saved->readMetadata();
+    QCOMPARE(saved->pixelWidth(), 32);
+    QCOMPARE(saved->pixelHeight(), 24);
+    QVERIFY(QFile::remove(fileName));
+
+    QCOMPARE(storage.cropLossless(jpeg, 1.0), jpeg);
+    QCOMPARE(storage.cropLossless(QByteArray("not a jpeg"), 2.0), QByteArray("not a jpeg"));
+}
+
+void tst_StorageManager::captureMemoryBudget()
+{
+    StorageManager storage;
+    storage.setCaptureMemoryBudget(1000);
+    QCOMPARE(storage.captureMemoryBudget(), qint64(1000));
+
+    // The first capture fits even if it is bigger than the whole budget
+    QVERIFY(storage.reserveCaptureMemory(1500));
+    QVERIFY(!storage.fitsCaptureMemory(1));
+    QVERIFY(!storage.reserveCaptureMemory(1));
+    QVERIFY(storage.reserveCaptureMemory(100, true));
+    QCOMPARE(storage.captureMemoryInUse(), qint64(1600));
+    storage.releaseCaptureMemory(1600);
+    QCOMPARE(storage.captureMemoryInUse(), qint64(0));
+
+    QVERIFY(storage.reserveCaptureMemory(600));
+    QVERIFY(storage.reserveCaptureMemory(400));
+    QVERIFY(!storage.reserveCaptureMemory(1));
+    storage.releaseCaptureMemory(1000);
+
+    // A spilled JPEG leaves only the preview and the EXIF rewrite in memory
+    const QSize preview(160, 120);
+    const qint64 previewBytes = 160 * 120 * 4;
+    QCOMPARE(storage.captureMemoryCost(4000, preview, false, true), previewBytes);
+    QCOMPARE(storage.captureMemoryCost(4000, preview, true, true), previewBytes + 8000);
+    QVERIFY(storage.captureMemoryCost(4000, preview, false, false) >= previewBytes + 4000);
+    QVERIFY(storage.captureMemoryCost(4000, preview, true, false) >= previewBytes + 8000);
+}
+
+void tst_StorageManager::saveSpilledJpegImage()
+{
+    StorageManager storage;
+    QString fileName = testPath + "spilled.jpg";
+    const QByteArray jpeg((char*)data_validjpeg, data_validjpeg_len);
+
+    QString spillFile = storage.spillJpegImage(jpeg, fileName);
+    QVERIFY(!spillFile.isEmpty());
+    QCOMPARE(QFileInfo(spillFile).absolutePath(), QFileInfo(fileName).absolutePath());
+    QVERIFY(QFileInfo(spillFile).isHidden());
+
+    // Saved as it is, the spilled file is only renamed
+    QSignalSpy previewSpy(&storage, SIGNAL(previewReady(int, QImage)));
+    SaveToDiskResult result = storage.saveSpilledJpegImage(spillFile, QVariantMap(), fileName,
+                                                           QSize(160, 120), 1, false);
+    QCOMPARE(result.success, true);
+    QCOMPARE(result.fileName, fileName);
+    QVERIFY(!QFile::exists(spillFile));
+    QCOMPARE(previewSpy.count(), 1);
+    QVERIFY(!previewSpy.at(0).at(1).value<QImage>().isNull());
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), jpeg);
+    file.close();
+    QVERIFY(file.remove());
+
+    // The EXIF data is rewritten next to it
+    spillFile = storage.spillJpegImage(jpeg, fileName);
+    result = storage.saveSpilledJpegImage(spillFile, QVariantMap(), fileName, QSize(160, 120), 2);
+    QCOMPARE(result.success, true);
+    QVERIFY(!QFile::exists(spillFile));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QVERIFY(file.readAll() != jpeg);
+    file.close();
+    QVERIFY(file.remove());
+
+    QDir dir(testPath);
+    QCOMPARE(dir.entryList(QDir::Files | QDir::Hidden).count(), 0);
+}
+
 QTEST_GUILESS_MAIN(tst_StorageManager);
 
 #include "tst_storagemanager.moc"
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "aalaudioencodersettingscontrol.h"
+#include "aalcameraservice.h"
+
+const QString AalAudioEncoderSettingsControl::DEFAULT_CODEC = QString("AAC");
+const int AalAudioEncoderSettingsControl::DEFAULT_SAMPLE_RATE = 96000;
+const int AalAudioEncoderSettingsControl::DEFAULT_CHANNEL_COUNT = 2;
+
+AalAudioEncoderSettingsControl::AalAudioEncoderSettingsControl(AalCameraService *service, QObject *parent)
+    : QAudioEncoderSettingsControl(parent)
+{
+    Q_UNUSED(service);
+    resetAllSettings();
+}
+
+QAudioEncoderSettings AalAudioEncoderSettingsControl::audioSettings() const
+{
+    return m_settings;
+}
+
+QString AalAudioEncoderSettingsControl::codecDescription(const QString &codecName) const
+{
+    return codecName;
+}
+
+void AalAudioEncoderSettingsControl::setAudioSettings(const QAudioEncoderSettings &settings)
+{
+    Q_UNUSED(settings);
+}
+
+QStringList AalAudioEncoderSettingsControl::supportedAudioCodecs() const
+{
+    QStringList codecs;
+    codecs << DEFAULT_CODEC;
+    return codecs;
+}
+
+QList<int> AalAudioEncoderSettingsControl::supportedSampleRates(const QAudioEncoderSettings &settings, bool *continuous) const
+{
+    Q_UNUSED(settings);
+    Q_UNUSED(continuous);
+    QList<int> sampleRates;
+    sampleRates << DEFAULT_SAMPLE_RATE;
+    return sampleRates;
+}
+
+void AalAudioEncoderSettingsControl::resetAllSettings()
+{
+    m_settings.setCodec(DEFAULT_CODEC);
+    m_settings.setSampleRate(DEFAULT_SAMPLE_RATE);
+    m_settings.setChannelCount(DEFAULT_CHANNEL_COUNT);
+    m_settings.setBitRate(48000);
+}
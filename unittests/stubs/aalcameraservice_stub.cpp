@@ -14,15 +14,15 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "aalaudioencodersettingscontrol.h"
 #include "aalcameraservice.h"
 #include "aalvideoencodersettingscontrol.h"
 #include "storagemanager.h"
 #include "rotationhandler.h"
+#include "haleventqueue.h"
 
 #include "camera_control.h"
 
-AalCameraService *AalCameraService::m_service = 0;
-
 AalCameraService::AalCameraService(QObject *parent) :
     QMediaService(parent),
     m_metadataWriter(0),
@@ -30,6 +30,7 @@ AalCameraService::AalCameraService(QObject *parent) :
     m_androidListener(0)
 {
     m_storageManager = new StorageManager;
+    m_audioEncoderControl = new AalAudioEncoderSettingsControl(this);
     m_videoEncoderControl = new AalVideoEncoderSettingsControl(this);
     m_rotationHandler = new RotationHandler(this);
 }
@@ -38,6 +39,7 @@ AalCameraService::~AalCameraService()
 {
     delete m_storageManager;
     delete m_androidControl;
+    delete m_audioEncoderControl;
     delete m_videoEncoderControl;
     delete m_rotationHandler;
 }
@@ -103,6 +105,16 @@ StorageManager *AalCameraService::storageManager()
     return m_storageManager;
 }
 
+void AalCameraService::postHalEvent(HalEvent *event)
+{
+    delete event;
+}
+
+void AalCameraService::customEvent(QEvent *event)
+{
+    QMediaService::customEvent(event);
+}
+
 RotationHandler *AalCameraService::rotationHandler()
 {
     return m_rotationHandler;
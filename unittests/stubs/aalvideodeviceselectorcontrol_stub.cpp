@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "aalvideodeviceselectorcontrol.h"
+#include "aalcameraservice.h"
+
+AalVideoDeviceSelectorControl::AalVideoDeviceSelectorControl(AalCameraService *service, QObject *parent)
+    :QVideoDeviceSelectorControl(parent),
+      m_service(service),
+      m_currentDevice(0),
+      m_numberOfCameras(2)
+{
+}
+
+int AalVideoDeviceSelectorControl::defaultDevice() const
+{
+    return 0;
+}
+
+int AalVideoDeviceSelectorControl::deviceCount() const
+{
+    return m_numberOfCameras;
+}
+
+QString AalVideoDeviceSelectorControl::deviceDescription(int index) const
+{
+    return QString("Camera %1").arg(index);
+}
+
+QString AalVideoDeviceSelectorControl::deviceName(int index) const
+{
+    return QString::number(index);
+}
+
+int AalVideoDeviceSelectorControl::selectedDevice() const
+{
+    return m_currentDevice;
+}
+
+void AalVideoDeviceSelectorControl::setSelectedDevice(int index)
+{
+    m_currentDevice = index;
+}
@@ -69,6 +69,11 @@ float AalVideoEncoderSettingsControl::getAspectRatio() const
     return 16.0 / 9.0;
 }
 
+VideoEncoder AalVideoEncoderSettingsControl::androidVideoEncoder() const
+{
+    return ANDROID_VIDEO_ENCODER_H264;
+}
+
 void AalVideoEncoderSettingsControl::resetAllSettings()
 {
 }
@@ -20,35 +20,148 @@
 
 #include <hybris/media/media_recorder_layer.h>
 
-AudioCapture::AudioCapture(MediaRecorderWrapper *mediaRecorder)
+AudioSyncStatistics::AudioSyncStatistics()
+    : drift(0),
+      maxDrift(0),
+      gaps(0),
+      excesses(0),
+      silenceInserted(0),
+      audioDropped(0)
+{
+}
+
+AudioCapture::AudioCapture(QObject *parent)
+    : QObject(parent),
+      m_ringBuffer(1),
+      m_pipeWriter(&m_ringBuffer),
+      m_syncCorrection(true),
+      m_syncTolerance(DEFAULT_SYNC_TOLERANCE)
 {
-    Q_UNUSED(mediaRecorder);
 }
 
 AudioCapture::~AudioCapture()
 {
 }
 
-bool AudioCapture::init(RecorderReadAudioCallback cb, void *context)
+bool AudioCapture::init(MediaRecorderWrapper *mediaRecorder, RecorderReadAudioCallback cb, void *context)
 {
+    Q_UNUSED(mediaRecorder);
     Q_UNUSED(cb);
     Q_UNUSED(context);
     return true;
 }
 
+void AudioCapture::detach()
+{
+}
+
+bool AudioCapture::isStreamReady() const
+{
+    return true;
+}
+
+void AudioCapture::connectStream()
+{
+}
+
+void AudioCapture::reconnect()
+{
+}
+
 void AudioCapture::stopCapture()
 {
 }
 
+void AudioCapture::pauseCapture()
+{
+}
+
+void AudioCapture::resumeCapture()
+{
+}
+
 int AudioCapture::setupMicrophoneStream()
 {
+    return 0;
 }
 
-void AudioCapture::run()
+void AudioCapture::setLatency(int latency)
+{
+    Q_UNUSED(latency);
+}
+
+int AudioCapture::latency() const
+{
+    return DEFAULT_LATENCY;
+}
+
+void AudioCapture::setSyncCorrection(bool enabled)
+{
+    m_syncCorrection = enabled;
+}
+
+bool AudioCapture::syncCorrection() const
 {
+    return m_syncCorrection;
 }
 
-int AudioCapture::readMicrophone()
+void AudioCapture::setSyncTolerance(int tolerance)
+{
+    m_syncTolerance = tolerance;
+}
+
+int AudioCapture::syncTolerance() const
+{
+    return m_syncTolerance;
+}
+
+AudioSyncStatistics AudioCapture::syncStatistics() const
+{
+    return m_syncStatistics;
+}
+
+int AudioCapture::overruns() const
+{
+    return 0;
+}
+
+int AudioCapture::underruns() const
+{
+    return 0;
+}
+
+int AudioCapture::bytesInFlight() const
 {
     return 0;
 }
+
+void AudioCapture::setLevelMetering(bool enabled)
+{
+    m_levelMetering.store(enabled ? 1 : 0);
+}
+
+bool AudioCapture::levelMetering() const
+{
+    return m_levelMetering.load();
+}
+
+int AudioCapture::channelCount() const
+{
+    return 1;
+}
+
+AudioLevel AudioCapture::level(int channel) const
+{
+    AudioLevel level;
+    if (channel < 0 || channel >= channelCount())
+        return level;
+
+    const quint32 packed = m_levels[channel].load();
+    level.peak = qreal(packed & 0xffff) / 0xffff;
+    level.rms = qreal(packed >> 16) / 0xffff;
+    return level;
+}
+
+void AudioCapture::run()
+{
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2014 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "replaybuffer.h"
+
+ReplayBuffer::ReplayBuffer(qint64 window, QObject *parent)
+    : QObject(parent),
+      m_window(window),
+      m_readFd(-1),
+      m_readerThread(0),
+      m_size(0)
+{
+}
+
+ReplayBuffer::~ReplayBuffer()
+{
+}
+
+int ReplayBuffer::start()
+{
+    return -1;
+}
+
+void ReplayBuffer::stop()
+{
+}
+
+qint64 ReplayBuffer::window() const
+{
+    return m_window;
+}
+
+qint64 ReplayBuffer::size() const
+{
+    return m_size;
+}
+
+qint64 ReplayBuffer::duration() const
+{
+    return 0;
+}
+
+bool ReplayBuffer::saveReplay(const QString &fileName, qint64 duration)
+{
+    Q_UNUSED(fileName);
+    Q_UNUSED(duration);
+    return false;
+}
@@ -42,6 +42,17 @@ bool StorageManager::checkDirectory(const QString &path) const
     return true;
 }
 
+void StorageManager::measureWriteThroughput(const QString &directory)
+{
+    Q_UNUSED(directory);
+}
+
+qint64 StorageManager::writeThroughput(const QString &directory) const
+{
+    Q_UNUSED(directory);
+    return -1;
+}
+
 QString StorageManager::fileNameGenerator(const QString &base,
                                          const QString& extension)
 {
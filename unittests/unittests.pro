@@ -9,5 +9,17 @@ SUBDIRS += \
     aalcamerazoomcontrol \
     aalmediarecordercontrol \
     aalvideodeviceselectorcontrol \
+    aalvideoencodersettingscontrol \
+    aalvideorenderercontrol \
     aalviewfindersettingscontrol \
+    audiolevelmeter \
+    audiopipewriter \
+    audioringbuffer \
+    bitratepolicy \
+    devicequirks \
+    haleventqueue \
+    halreplay \
+    halsimulation \
+    haltrace \
+    replaybuffer \
     storagemanager